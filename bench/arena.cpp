@@ -0,0 +1,142 @@
+#include "bench.hpp"
+
+#include "../src/fe/lexer.hpp"
+#include "../src/include/file.hpp"
+
+namespace rotate
+{
+namespace bench
+{
+
+constexpr uint ARENA_NODES       = 1u << 20;
+constexpr uint ARENA_SCOPES      = 1u << 16;
+constexpr uint ARENA_SOURCE_SIZE = 16 * 1024 * 1024;
+constexpr uint ARENA_ROUNDS      = 5;
+
+// the shape of a future AST node
+struct Node
+{
+    u32 kind, token;
+    Node *lhs, *rhs;
+};
+
+// a tree built bottom up, every node points at two earlier ones
+template <typename Alloc>
+static u64
+build_tree(Alloc alloc, Node **nodes)
+{
+    u64 seed        = 0x70de;
+    const u64 start = now_ns();
+    for (uint i = 0; i < ARENA_NODES; i++)
+    {
+        const u64 r = rng_next(&seed);
+        Node *node  = alloc();
+        node->kind  = (u32)(r & 0xf);
+        node->token = i;
+        node->lhs   = i ? nodes[r % i] : nullptr;
+        node->rhs   = i ? nodes[(r >> 32) % i] : nullptr;
+        nodes[i]    = node;
+    }
+    return now_ns() - start;
+}
+
+struct NewNode
+{
+    Node *operator()() const { return new Node; }
+};
+
+struct ArenaNode
+{
+    Arena *arena;
+    Node *operator()() const { return arena->make<Node>(); }
+};
+
+u8
+bench_arena()
+{
+    Node **nodes = new Node *[ARENA_NODES];
+
+    // allocation and release of every node
+    u64 best_new = ~0ull, best_arena = ~0ull;
+    for (uint round = 0; round < ARENA_ROUNDS; round++)
+    {
+        u64 elapsed = build_tree(NewNode(), nodes);
+        u64 start   = now_ns();
+        for (uint i = 0; i < ARENA_NODES; i++)
+            delete nodes[i];
+        elapsed += now_ns() - start;
+        if (elapsed < best_new) best_new = elapsed;
+
+        Arena *arena = new Arena();
+        elapsed      = build_tree(ArenaNode{arena}, nodes);
+        start        = now_ns();
+        delete arena;
+        elapsed += now_ns() - start;
+        if (elapsed < best_arena) best_arena = elapsed;
+    }
+    report("tree nodes", "new/delete", (f64)best_new / ARENA_NODES, "node");
+    report("tree nodes", "arena", (f64)best_arena / ARENA_NODES, "node");
+    delete[] nodes;
+
+    // short lived scratch buffers, 16 to 4096 bytes
+    best_new = best_arena = ~0ull;
+    Arena scratch;
+    for (uint round = 0; round < ARENA_ROUNDS; round++)
+    {
+        u64 seed  = 0x5c4a;
+        u64 start = now_ns();
+        for (uint i = 0; i < ARENA_SCOPES; i++)
+        {
+            char *buffer = static_cast<char *>(malloc(16 + rng_next(&seed) % 4081));
+            buffer[0]    = (char)i;
+            keep(buffer[0]);
+            free(buffer);
+        }
+        u64 elapsed = now_ns() - start;
+        if (elapsed < best_new) best_new = elapsed;
+
+        seed  = 0x5c4a;
+        start = now_ns();
+        for (uint i = 0; i < ARENA_SCOPES; i++)
+        {
+            ArenaScope scope(&scratch);
+            char *buffer = static_cast<char *>(scratch.alloc(16 + rng_next(&seed) % 4081));
+            buffer[0]    = (char)i;
+            keep(buffer[0]);
+        }
+        elapsed = now_ns() - start;
+        if (elapsed < best_arena) best_arena = elapsed;
+    }
+    report("scratch buffers", "malloc/free", (f64)best_new / ARENA_SCOPES, "buffer");
+    report("scratch buffers", "arena scope", (f64)best_arena / ARENA_SCOPES, "buffer");
+
+    // the token stream arrays with and without the lexer stage arena
+    char *source = generate_source(0xa4e9, ARENA_SOURCE_SIZE);
+    file_t file("arena.vr", source, ARENA_SOURCE_SIZE, valid::success);
+    for (uint use_arena = 0; use_arena < 2; use_arena++)
+    {
+        u64 best       = ~0ull;
+        usize reserved = 0;
+        for (uint round = 0; round < ARENA_ROUNDS; round++)
+        {
+            const u64 start = now_ns();
+            {
+                Arena arena;
+                {
+                    Lexer lexer(&file, 0, use_arena ? &arena : nullptr);
+                    if (lexer.lex() != SUCCESS) return FAILURE;
+                }
+                reserved = arena.peak();
+            }
+            const u64 elapsed = now_ns() - start;
+            if (elapsed < best) best = elapsed;
+        }
+        const f64 mbs = (f64)ARENA_SOURCE_SIZE / ((f64)best / 1e9) / 1e6;
+        fprintf(stdout, "%-16s %-24s %10.1f MB/s (%llu KiB from the arena)\n", "lex()",
+                use_arena ? "lexer arena" : "malloc", mbs, (usize)(reserved / 1024));
+    }
+    return SUCCESS;
+}
+
+} // namespace bench
+} // namespace rotate
@@ -0,0 +1,144 @@
+#include "bench.hpp"
+
+#include "../src/fe/token.hpp"
+
+namespace rotate
+{
+namespace bench
+{
+
+constexpr uint ARRAY_TOKENS = 4u << 20;
+constexpr uint ARRAY_LISTS  = 1u << 18;
+constexpr uint ARRAY_ROUNDS = 5;
+
+// the Array before move support, growth policies and reference access
+template <typename T>
+class LegacyArray
+{
+    T *m_data        = nullptr;
+    usize m_count    = 0;
+    usize m_capacity = 0;
+
+    public:
+    LegacyArray(usize init_size = 10)
+    {
+        m_capacity = init_size;
+        m_data     = static_cast<T *>(malloc(sizeof(T) * init_size));
+    }
+    ~LegacyArray() { free(static_cast<void *>(m_data)); }
+
+    void append(T element)
+    {
+        if (m_count == m_capacity)
+        {
+            m_capacity <<= 1;
+            m_data = static_cast<T *>(realloc(static_cast<void *>(m_data), m_capacity * sizeof(T)));
+        }
+        m_data[m_count++] = element;
+    }
+    T operator[](const usize index) const { return m_data[index]; }
+    usize count() const { return m_count; }
+};
+
+// fills one array per token field like a lexer does
+template <typename Types, typename Offsets, typename Tokens>
+static u64
+fill_tokens(const usize reserve)
+{
+    const u64 start = now_ns();
+    Types types(reserve);
+    Offsets offsets(reserve);
+    Tokens tokens(reserve);
+    for (uint i = 0; i < ARRAY_TOKENS; i++)
+    {
+        types.append((TknType)(i & 0x3f));
+        offsets.append(i * 3);
+        tokens.append(Token(i * 3, 1 + (i & 7), (TknType)(i & 0x3f)));
+    }
+    keep(types[ARRAY_TOKENS - 1]);
+    keep(offsets[ARRAY_TOKENS / 2]);
+    return now_ns() - start;
+}
+
+static u64
+emplace_tokens()
+{
+    const u64 start = now_ns();
+    Array<TknType> types(10);
+    Array<uint> offsets(10);
+    Array<Token> tokens(10);
+    for (uint i = 0; i < ARRAY_TOKENS; i++)
+    {
+        types.emplace((TknType)(i & 0x3f));
+        offsets.emplace(i * 3);
+        tokens.emplace(i * 3, 1 + (i & 7), (TknType)(i & 0x3f));
+    }
+    keep(types[ARRAY_TOKENS - 1]);
+    keep(offsets[ARRAY_TOKENS / 2]);
+    return now_ns() - start;
+}
+
+// many short lists (call arguments, struct fields...), 0 to 7 elements each
+template <typename List>
+static u64
+fill_lists(u64 seed)
+{
+    u64 sum         = 0;
+    const u64 start = now_ns();
+    for (uint l = 0; l < ARRAY_LISTS; l++)
+    {
+        List list;
+        const uint n = (uint)(rng_next(&seed) & 7);
+        for (uint i = 0; i < n; i++)
+            list.append(l + i);
+        for (uint i = 0; i < list.count(); i++)
+            sum += list[i];
+    }
+    keep(sum);
+    return now_ns() - start;
+}
+
+// heap lists start at 4 elements like the short lists of the parser would
+template <typename T>
+struct HeapList : Array<T>
+{
+    HeapList() : Array<T>(4) {}
+};
+
+static void
+keep_best(u64 *best, const u64 elapsed)
+{
+    if (elapsed < *best) *best = elapsed;
+}
+
+u8
+bench_array()
+{
+    // the variants take turns every round so they see the same heap state
+    u64 best[7] = {~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull, ~0ull};
+    for (uint round = 0; round < ARRAY_ROUNDS; round++)
+    {
+        keep_best(&best[0],
+                  fill_tokens<LegacyArray<TknType>, LegacyArray<uint>, LegacyArray<Token>>(10));
+        keep_best(&best[1], fill_tokens<Array<TknType>, Array<uint>, Array<Token>>(10));
+        keep_best(&best[2], fill_tokens<Array<TknType, GrowHalf>, Array<uint, GrowHalf>,
+                                        Array<Token, GrowHalf>>(10));
+        keep_best(&best[3], fill_tokens<Array<TknType>, Array<uint>, Array<Token>>(ARRAY_TOKENS));
+        keep_best(&best[4], emplace_tokens());
+        keep_best(&best[5], fill_lists<HeapList<u32>>(0xa11));
+        keep_best(&best[6], fill_lists<SmallArray<u32, 8>>(0xa11));
+    }
+
+    const f64 tokens = (f64)ARRAY_TOKENS, lists = (f64)ARRAY_LISTS;
+    report("append tokens", "legacy Array", (f64)best[0] / tokens, "token");
+    report("append tokens", "Array", (f64)best[1] / tokens, "token");
+    report("append tokens", "Array, GrowHalf", (f64)best[2] / tokens, "token");
+    report("append tokens", "Array, reserved", (f64)best[3] / tokens, "token");
+    report("append tokens", "Array, emplace", (f64)best[4] / tokens, "token");
+    report("short lists", "Array", (f64)best[5] / lists, "list");
+    report("short lists", "SmallArray<8>", (f64)best[6] / lists, "list");
+    return SUCCESS;
+}
+
+} // namespace bench
+} // namespace rotate
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "../src/include/common.hpp"
+
+namespace rotate
+{
+
+class TokenStream;
+
+namespace bench
+{
+
+/*
+ *  vr_bench: micro benchmarks for the compiler internals
+ *  usage: vr_bench [name...] [flags] (runs every benchmark when no name is given)
+ *  --save-baseline=FILE   writes the recorded throughputs to FILE
+ *  --baseline=FILE   fails when a recorded throughput is below FILE's by more
+ *                    than --tolerance=PCT percent (default 10)
+ *  --corpus=SIZE[k|m|g] [--seed=N]   writes a generated source to stdout
+ */
+
+struct Benchmark
+{
+    cstr name;
+    cstr about;
+    u8 (*run)();
+};
+
+u64 now_ns() noexcept;
+u64 rng_next(u64 *state) noexcept; // deterministic xorshift64*
+
+// keeps the optimizer from removing the benchmarked work
+template <typename T>
+inline void
+keep(const T &value)
+{
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+void report(cstr name, cstr variant, const f64 ns_per_op, cstr unit);
+// a throughput (higher is better) compared against the baseline
+void record(cstr name, cstr variant, const f64 mb_per_s);
+
+// `size` bytes of generated rotate source followed by EXTRA_NULL_TERMINATORS zeros (new[])
+char *generate_source(u64 seed, const uint size);
+// `size` bytes of generated source in 64 MiB pieces, the first piece is generate_source(seed)
+u8 write_corpus(FILE *output, const u64 seed, const u64 size);
+// same types, offsets, lengths and values (literals, identifier names, strings)
+bool same_tokens(const TokenStream *a, const TokenStream *b);
+// same symbol table, string pool and literal pool, every token with the same payload
+bool same_pools(const TokenStream *a, const TokenStream *b);
+
+u8 bench_keywords();
+u8 bench_parallel();
+u8 bench_streaming();
+u8 bench_relex();
+u8 bench_literals();
+u8 bench_strings();
+u8 bench_array();
+u8 bench_arena();
+u8 bench_file();
+u8 bench_validate();
+u8 bench_throughput();
+u8 bench_log();
+u8 bench_cache();
+u8 bench_modules();
+u8 bench_uring();
+u8 bench_sources();
+
+} // namespace bench
+} // namespace rotate
@@ -0,0 +1,125 @@
+#include "bench.hpp"
+
+#include "../src/fe/lexer.hpp"
+#include "../src/fe/simd.hpp"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace rotate
+{
+namespace bench
+{
+
+/*
+ *  token cache: the content hash per simd level and the digest, then per source
+ *  size a cold compile (key, lex and store) against a warm one (key, lookup and
+ *  load); a key with another digest must miss; the cache lives in a temporary directory
+ */
+
+static const uint CACHE_SIZES[] = {64 * 1024, 4 * 1024 * 1024, 64 * 1024 * 1024};
+constexpr uint CACHE_ROUNDS     = 5;
+
+static void
+remove_cache(cstr dir)
+{
+    char command[TOKEN_CACHE_PATH + 16];
+    snprintf(command, sizeof(command), "rm -rf '%s'", dir);
+    if (system(command) != 0) fprintf(stderr, "cache: could not remove `%s`\n", dir);
+}
+
+// one compile's lexing, like `lex_file` in compile.cpp
+static u8
+cached_lex(const TokenCache *cache, const file_t *source, bool *hit)
+{
+    Lexer lexer(source);
+    const TokenCacheKey key = TokenCache::key(source->contents, source->length);
+    TokenCacheHit cached;
+    *hit = cache->find(&key, &cached) && lexer.lex_cached(&cached) == SUCCESS;
+    if (*hit) return SUCCESS;
+    if (lexer.lex() != SUCCESS) return FAILURE;
+    return cache->store(&key, lexer.get_tokens());
+}
+
+u8
+bench_cache()
+{
+    char dir[] = "/tmp/vr_bench_cache_XXXXXX";
+    if (!mkdtemp(dir)) return FAILURE;
+    const TokenCache cache(true, dir);
+    u8 exit_code = SUCCESS;
+
+    static const SimdLevel LEVELS[] = {SimdLevel::scalar, SimdLevel::sse2, SimdLevel::avx2};
+    const uint size                 = CACHE_SIZES[2];
+    char *text                      = generate_source(0xcac4e, size);
+    for (const SimdLevel level : LEVELS)
+    {
+        if (level > simd_detect()) continue;
+        u64 best = ~0ull, hash = 0;
+        for (uint round = 0; round < CACHE_ROUNDS; round++)
+        {
+            const u64 start = now_ns();
+            hash            = simd_hash(text, size, level);
+            const u64 ns    = now_ns() - start;
+            if (ns < best) best = ns;
+        }
+        keep(hash);
+        if (hash != simd_hash(text, size, SimdLevel::scalar)) exit_code = FAILURE;
+        fprintf(stdout, "%-16s %-24s %10.2f GB/s\n", "cache", simd_level_describe(level),
+                (f64)size / (f64)best);
+    }
+    u64 best = ~0ull;
+    u8 sum[DIGEST_BYTES];
+    for (uint round = 0; round < CACHE_ROUNDS; round++)
+    {
+        const u64 start = now_ns();
+        digest(text, size, sum);
+        const u64 ns = now_ns() - start;
+        if (ns < best) best = ns;
+    }
+    keep(sum[0]);
+    fprintf(stdout, "%-16s %-24s %10.2f GB/s\n", "cache", "blake2b digest", (f64)size / (f64)best);
+    delete[] text;
+
+    for (const uint bytes : CACHE_SIZES)
+    {
+        file_t source("cache.vr", generate_source(0xcac4e, bytes), bytes, valid::success);
+        u64 cold = ~0ull, warm = ~0ull;
+        for (uint round = 0; round < CACHE_ROUNDS; round++)
+        {
+            // every cold round starts from an empty directory
+            remove_cache(dir);
+            bool hit        = false;
+            u64 start       = now_ns();
+            u8 status       = cached_lex(&cache, &source, &hit);
+            const u64 first = now_ns() - start;
+            if (status != SUCCESS || hit) exit_code = FAILURE;
+            start        = now_ns();
+            status       = cached_lex(&cache, &source, &hit);
+            const u64 ns = now_ns() - start;
+            if (status != SUCCESS || !hit) exit_code = FAILURE;
+            if (first < cold) cold = first;
+            if (ns < warm) warm = ns;
+        }
+        // the same hash and length with another digest is a miss
+        TokenCacheKey other = TokenCache::key(source.contents, source.length);
+        other.digest[0] ^= 1;
+        TokenCacheHit collision;
+        if (cache.find(&other, &collision)) exit_code = FAILURE;
+
+        char variant[32];
+        if (bytes >= 1024 * 1024)
+            snprintf(variant, sizeof(variant), "%u MiB", bytes >> 20);
+        else
+            snprintf(variant, sizeof(variant), "%u KiB", bytes >> 10);
+        fprintf(stdout, "%-16s %-24s cold %9.3f ms, warm %9.3f ms (%.1fx)\n", "cache", variant,
+                (f64)cold / 1e6, (f64)warm / 1e6, (f64)cold / (f64)warm);
+        record("cache warm", variant, (f64)bytes / ((f64)warm / 1e9) / 1e6);
+    }
+    remove_cache(dir);
+    if (exit_code != SUCCESS) fprintf(stderr, "cache: a lookup or a hash did not match\n");
+    return exit_code;
+}
+
+} // namespace bench
+} // namespace rotate
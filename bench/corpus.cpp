@@ -0,0 +1,76 @@
+#include "bench.hpp"
+
+namespace rotate
+{
+namespace bench
+{
+
+/*
+ *  synthetic rotate source for the lexer benchmarks
+ *  the constructs of docs/index.org (imports, functions, loops, switch, structs,
+ *  enums, new/defer, literals, strings and comments, block comments and strings
+ *  spanning lines included) picked by a seeded rng, so every run lexes the same
+ *  bytes; only whole snippets are emitted, the rest is padded with spaces, so
+ *  generated pieces can be concatenated into corpora of any size
+ */
+
+static const cstr SNIPPETS[] = {
+    "fn add_%u(x: int, y: int) int {\n    return x + y * %u;\n}\n\n",
+    "fn main_%u() {\n    for i in 0..%u {\n        // do something\n    }\n}\n\n",
+    "value_%u := %u;\nratio_%u :: 3.%u;\nname := \"rotate \\\"lang\\\" %u\";\n",
+    "if x_%u >= %u {\n    print_int(x);\n} else {\n    x += 1;\n}\n",
+    "/* block comment %u\n   spanning lines %u\n*/\n",
+    "text_%u := \"multi\nline string %u\n\";\n",
+    "# hash comment %u %u\nc := '\\n'; d := 'a';\n",
+    "Token_%u :: struct {\n    x: int,\n    y: [%u]float,\n}\n",
+    "while flag_%u {\n    @print(%u);\n    break;\n}\n",
+    "import \"std/io\";\nimport \"std/mod_%u\" as mod_%u;\n\n",
+    "fn sum_%u(items: [%u]int) int {\n    total := 0;\n    for i in 0..%u {\n"
+    "        total += items[i];\n    }\n    return total;\n}\n\n",
+    "switch op_%u {\n    1: { x = 0x%X; }\n    2: { x = %u.5; }\n    else: {}\n}\n",
+    "Kind_%u :: enum {\n    Id,\n    Number,\n    Float_%u,\n}\n",
+    "buf_%u := new [%u]char;\ndefer delete buf_%u;\nif buf_%u == nil {\n"
+    "    io.println(\"Fail alloc %u\");\n    os.exit(1);\n}\n",
+    "d_%u := Token{%u, [1, 2, 3]};\nd_%u.x = '\\t';\nd_%u.y[1] = %u; // set\n",
+};
+static const uint SNIPPETS_COUNT = sizeof(SNIPPETS) / sizeof(SNIPPETS[0]);
+
+char *
+generate_source(u64 seed, const uint size)
+{
+    char *out = new char[size + EXTRA_NULL_TERMINATORS];
+    uint at   = 0;
+    char line[512];
+    for (;;)
+    {
+        const u64 r = rng_next(&seed);
+        const uint a = (uint)(r >> 8) % 100000, b = (uint)(r >> 32) % 1000;
+        const int n  = snprintf(line, sizeof(line), SNIPPETS[r % SNIPPETS_COUNT], a, b, a, b, a);
+        if (at + (uint)n >= size) break; // the last byte is the newline
+        memcpy(out + at, line, (uint)n);
+        at += (uint)n;
+    }
+    memset(out + at, ' ', size - at);
+    out[size - 1] = '\n';
+    memset(out + size, 0, EXTRA_NULL_TERMINATORS);
+    return out;
+}
+
+u8
+write_corpus(FILE *output, const u64 seed, const u64 size)
+{
+    constexpr uint PIECE = 64 * 1024 * 1024;
+    for (u64 at = 0, piece = 0; at < size; piece++)
+    {
+        const uint length = size - at < PIECE ? (uint)(size - at) : PIECE;
+        char *source      = generate_source(seed + piece, length);
+        const bool ok     = fwrite(source, 1, length, output) == length;
+        delete[] source;
+        if (!ok) return FAILURE;
+        at += length;
+    }
+    return SUCCESS;
+}
+
+} // namespace bench
+} // namespace rotate
@@ -0,0 +1,97 @@
+#include "bench.hpp"
+
+#include "../src/fe/lexer.hpp"
+#include "../src/include/file.hpp"
+
+#include <malloc.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace rotate
+{
+namespace bench
+{
+
+/*
+ *  file_read through a read-only mapping vs the buffered copy
+ *  every run is a forked child (like the streaming benchmark) so the peak RSS
+ *  is its own; the page cache is warm for both, only the loading differs
+ */
+
+constexpr uint FILE_SOURCE_SIZE = 64 * 1024 * 1024;
+
+// runs in the child: nanoseconds to the first token and to the end of lex()
+static u8
+run_load(cstr path, const bool map, const bool full, u64 *ns)
+{
+    const u64 start = now_ns();
+    file_t file     = file_read(path, map);
+    if (file.valid_code != valid::success || (map && !file.mapped)) return FAILURE;
+    Lexer lexer(&file);
+    if (full)
+    {
+        if (lexer.lex() != SUCCESS) return FAILURE;
+    }
+    else if (lexer.next_token().type == TknType::EOT) { return FAILURE; }
+    *ns = now_ns() - start;
+    return SUCCESS;
+}
+
+u8
+bench_file()
+{
+    static const cstr NAMES[] = {"buffered, first token", "mmap, first token",
+                                 "buffered, lex()", "mmap, lex()"};
+
+    char path[] = "/tmp/vr_bench_XXXXXX.vr";
+    const int fd = mkstemps(path, 3);
+    if (fd < 0) return FAILURE;
+    char *source = generate_source(0xf11e, FILE_SOURCE_SIZE);
+    const bool written = write(fd, source, FILE_SOURCE_SIZE) == (ssize_t)FILE_SOURCE_SIZE;
+    delete[] source;
+    close(fd);
+    if (!written)
+    {
+        unlink(path);
+        return FAILURE;
+    }
+
+    malloc_trim(0);
+    u8 exit_code = SUCCESS;
+    for (u8 run = 0; run < 4; run++)
+    {
+        int fds[2];
+        if (pipe(fds) != 0) break;
+        const pid_t pid = fork();
+        if (pid < 0) break;
+        if (pid == 0)
+        {
+            u64 ns          = 0;
+            const u8 status = run_load(path, run & 1, run >= 2, &ns);
+            if (write(fds[1], &ns, sizeof(ns)) != sizeof(ns)) _exit(FAILURE);
+            _exit(status);
+        }
+
+        close(fds[1]);
+        u64 ns         = 0;
+        const bool got = read(fds[0], &ns, sizeof(ns)) == sizeof(ns);
+        close(fds[0]);
+        int status = 0;
+        rusage usage;
+        if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != SUCCESS || !got)
+        {
+            fprintf(stderr, "file: `%s` failed\n", NAMES[run]);
+            exit_code = FAILURE;
+            continue;
+        }
+        fprintf(stdout, "%-16s %-24s %10.3f ms %10ld KiB peak rss\n", "file_read", NAMES[run],
+                (f64)ns / 1e6, usage.ru_maxrss);
+    }
+    unlink(path);
+    return exit_code;
+}
+
+} // namespace bench
+} // namespace rotate
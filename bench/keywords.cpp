@@ -0,0 +1,225 @@
+#include "bench.hpp"
+
+#include "../src/fe/keywords.hpp"
+
+namespace rotate
+{
+namespace bench
+{
+
+static inline bool
+match(cstr str, cstr keyword, const uint length)
+{
+    return strncmp(str, keyword, length) == 0;
+}
+
+// the nested switch `Lexer::lex_identifiers` used before the perfect hash table
+static TknType
+legacy_keyword_lookup(cstr str, const uint len)
+{
+    TknType _type = TknType::Identifier;
+    switch (len)
+    {
+        case 2: {
+            switch (str[0])
+            {
+                case 'a':
+                    if (match(str, "as", 2)) _type = TknType::As;
+                    break;
+                case 'f':
+                    if (match(str, "fn", 2)) _type = TknType::Function;
+                    break;
+                case 'i':
+                    if (match(str, "if", 2))
+                        _type = TknType::If;
+                    else if (match(str, "in", 2))
+                        _type = TknType::In;
+                    break;
+                case 'o':
+                    if (match(str, "or", 2)) _type = TknType::Or;
+                    break;
+                default: break;
+            }
+
+            break;
+        }
+        case 3: {
+            switch (str[0])
+            {
+                case 'f':
+                    if (match(str, "for", 3)) _type = TknType::For;
+                    break;
+                case 'p':
+                    if (match(str, "pub", 3)) _type = TknType::Public;
+                    break;
+                case 'i':
+                    if (match(str, "int", 3)) _type = TknType::IntKeyword;
+                    break;
+                case 'r':
+                    if (match(str, "ref", 3)) _type = TknType::Ref;
+                    break;
+                case 'a':
+                    if (match(str, "and", 3)) _type = TknType::And;
+                    break;
+                case 'n':
+                    if (match(str, "nil", 3)) _type = TknType::Nil;
+                    break;
+            }
+            break;
+        }
+        case 4: {
+            switch (str[0])
+            {
+                case 'e': {
+                    if (match(str, "else", 4))
+                        _type = TknType::Else;
+                    else if (match(str, "enum", 4))
+                        _type = TknType::Enum;
+                    break;
+                }
+                case 't':
+                    if (match(str, "true", 4)) _type = TknType::True;
+                    break;
+                case 'c':
+                    if (match(str, "char", 4)) _type = TknType::CharKeyword;
+                    break;
+                case 'b':
+                    if (match(str, "bool", 4)) _type = TknType::BoolKeyword;
+                    break;
+                case 'u':
+                    if (match(str, "uint", 4)) _type = TknType::UintKeyword;
+                    break;
+                case 'v':
+                    if (match(str, "void", 4)) _type = TknType::Void;
+                    break;
+            }
+            break;
+        }
+        case 5: {
+            switch (str[0])
+            {
+                case 'w':
+                    if (match(str, "while", 5)) _type = TknType::While;
+                    break;
+                case 'f': {
+                    if (match(str, "false", 5))
+                        _type = TknType::False;
+                    else if (match(str, "float", 5))
+                        _type = TknType::FloatKeyword;
+                    break;
+                }
+                case 'b':
+                    if (match(str, "break", 5)) _type = TknType::Break;
+                    break;
+            }
+            break;
+        }
+        case 6: {
+            switch (str[0])
+            {
+                case 'r':
+                    if (match(str, "return", 6)) _type = TknType::Return;
+                    break;
+                case 'i':
+                    if (match(str, "import", 6)) _type = TknType::Import;
+                    break;
+                case 'd':
+                    if (match(str, "delete", 6)) _type = TknType::Delete;
+                    break;
+                case 's': {
+                    if (match(str, "struct", 6))
+                        _type = TknType::Struct;
+                    else if (match(str, "switch", 6))
+                        _type = TknType::Switch;
+                    break;
+                }
+            }
+            break;
+        }
+        default: break;
+    }
+    return _type;
+}
+
+struct Word
+{
+    uint index, length;
+};
+
+u8
+bench_keywords()
+{
+    // identifier heavy mix, roughly one in three words is a keyword
+    const uint WORDS  = 1u << 20;
+    const uint ROUNDS = 5;
+    char *text        = new char[(usize)WORDS * 16 + 16];
+    Word *words       = new Word[WORDS];
+    u64 seed          = 0x5eed;
+    uint pos          = 0;
+    for (uint i = 0; i < WORDS; i++)
+    {
+        const u64 r = rng_next(&seed);
+        uint len    = 0;
+        if (r % 3 == 0)
+        {
+            const Keyword &k = KEYWORDS[(r >> 8) % KEYWORDS_COUNT];
+            len              = cstr_len(k.name);
+            memcpy(text + pos, k.name, len);
+        }
+        else
+        {
+            len = 1 + (uint)((r >> 8) % 10);
+            for (uint j = 0; j < len; j++)
+                text[pos + j] = "abcdefghijklmnopqrstuvwxyz_"[rng_next(&seed) % 27];
+        }
+        words[i] = Word{pos, len};
+        pos += len;
+        text[pos++] = ' ';
+    }
+    memset(text + pos, 0, 16);
+
+    for (uint i = 0; i < WORDS; i++)
+    {
+        const Word w = words[i];
+        if (legacy_keyword_lookup(text + w.index, w.length) !=
+            keyword_lookup(text + w.index, w.length, pos + 16 - w.index))
+        {
+            fprintf(stderr, "keyword lookup mismatch for `%.*s`\n", w.length, text + w.index);
+            delete[] text;
+            delete[] words;
+            return FAILURE;
+        }
+    }
+
+    u64 best_legacy = ~0ull, best_hash = ~0ull;
+    for (uint round = 0; round < ROUNDS; round++)
+    {
+        uint hits = 0;
+        u64 start = now_ns();
+        for (uint i = 0; i < WORDS; i++)
+            hits += legacy_keyword_lookup(text + words[i].index, words[i].length) !=
+                    TknType::Identifier;
+        u64 elapsed = now_ns() - start;
+        keep(hits);
+        if (elapsed < best_legacy) best_legacy = elapsed;
+
+        hits  = 0;
+        start = now_ns();
+        for (uint i = 0; i < WORDS; i++)
+            hits += keyword_lookup(text + words[i].index, words[i].length,
+                                   pos + 16 - words[i].index) != TknType::Identifier;
+        elapsed = now_ns() - start;
+        keep(hits);
+        if (elapsed < best_hash) best_hash = elapsed;
+    }
+
+    report("keywords", "switch + strncmp", (f64)best_legacy / WORDS, "lookup");
+    report("keywords", "perfect hash", (f64)best_hash / WORDS, "lookup");
+
+    delete[] text;
+    delete[] words;
+    return SUCCESS;
+}
+
+} // namespace bench
+} // namespace rotate
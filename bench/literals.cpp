@@ -0,0 +1,230 @@
+#include "bench.hpp"
+
+#include "../src/fe/lexer.hpp"
+#include "../src/include/file.hpp"
+
+namespace rotate
+{
+namespace bench
+{
+
+constexpr uint LITERALS_COUNT  = 1u << 20;
+constexpr uint LITERALS_ROUNDS = 5;
+
+enum class LiteralKind : u8
+{
+    decimal,
+    hex,
+    binary,
+    floating,
+};
+
+struct Literal
+{
+    uint index, length; // digits only, without the 0x/0b prefix
+};
+
+// `count` literals of a kind separated by spaces, NUL padded
+static char *
+generate_literals(const LiteralKind kind, u64 seed, Literal *out, uint *size)
+{
+    char *text = new char[(usize)LITERALS_COUNT * 48 + 16];
+    uint pos   = 0;
+    for (uint i = 0; i < LITERALS_COUNT; i++)
+    {
+        const u64 r = rng_next(&seed);
+        int n       = 0;
+        switch (kind)
+        {
+            case LiteralKind::decimal:
+                n = sprintf(text + pos, "%llu", (unsigned long long)(r >> (r % 60)));
+                break;
+            case LiteralKind::hex:
+                n = sprintf(text + pos, "%llx", (unsigned long long)(r >> (r % 60)));
+                break;
+            case LiteralKind::binary:
+                for (uint b = 0; b < 1 + r % 40; b++)
+                    text[pos + n++] = (char)('0' + ((r >> b) & 1));
+                break;
+            case LiteralKind::floating:
+                n = sprintf(text + pos, "%u.%0*u", (uint)(r % 100000), 1 + (int)((r >> 20) % 9),
+                            (uint)((r >> 32) % 1000000000));
+                break;
+        }
+        out[i] = Literal{pos, (uint)n};
+        pos += (uint)n;
+        text[pos++] = ' ';
+    }
+    memset(text + pos, 0, 16);
+    *size = pos;
+    return text;
+}
+
+static u8
+bench_integers(const LiteralKind kind, cstr name, bool (*parse)(cstr, const uint, u64 *),
+               const int base)
+{
+    Literal *literals = new Literal[LITERALS_COUNT];
+    uint size         = 0;
+    char *text        = generate_literals(kind, 0x5eed + (u64)kind, literals, &size);
+
+    u64 best_libc = ~0ull, best_kernel = ~0ull;
+    for (uint round = 0; round < LITERALS_ROUNDS; round++)
+    {
+        u64 sum   = 0;
+        u64 start = now_ns();
+        for (uint i = 0; i < LITERALS_COUNT; i++)
+            sum += strtoull(text + literals[i].index, nullptr, base);
+        u64 elapsed = now_ns() - start;
+        keep(sum);
+        if (elapsed < best_libc) best_libc = elapsed;
+
+        u64 check = 0;
+        start     = now_ns();
+        for (uint i = 0; i < LITERALS_COUNT; i++)
+        {
+            u64 value = 0;
+            parse(text + literals[i].index, literals[i].length, &value);
+            check += value;
+        }
+        elapsed = now_ns() - start;
+        keep(check);
+        if (elapsed < best_kernel) best_kernel = elapsed;
+        if (check != sum)
+        {
+            fprintf(stderr, "literals: %s values differ from strtoull\n", name);
+            return FAILURE;
+        }
+    }
+
+    report(name, "strtoull", (f64)best_libc / LITERALS_COUNT, "literal");
+    report(name, "swar kernel", (f64)best_kernel / LITERALS_COUNT, "literal");
+    delete[] text;
+    delete[] literals;
+    return SUCCESS;
+}
+
+static u8
+bench_floats()
+{
+    Literal *literals = new Literal[LITERALS_COUNT];
+    uint size         = 0;
+    char *text        = generate_literals(LiteralKind::floating, 0xf10a7, literals, &size);
+
+    u64 best_libc = ~0ull, best_kernel = ~0ull;
+    for (uint round = 0; round < LITERALS_ROUNDS; round++)
+    {
+        f64 sum   = 0;
+        u64 start = now_ns();
+        for (uint i = 0; i < LITERALS_COUNT; i++)
+            sum += strtod(text + literals[i].index, nullptr);
+        u64 elapsed = now_ns() - start;
+        keep(sum);
+        if (elapsed < best_libc) best_libc = elapsed;
+
+        f64 check = 0;
+        start     = now_ns();
+        for (uint i = 0; i < LITERALS_COUNT; i++)
+            check += parse_float(text + literals[i].index, literals[i].length);
+        elapsed = now_ns() - start;
+        keep(check);
+        if (elapsed < best_kernel) best_kernel = elapsed;
+        if (check != sum)
+        {
+            fprintf(stderr, "literals: float values differ from strtod\n");
+            return FAILURE;
+        }
+    }
+
+    report("float", "strtod", (f64)best_libc / LITERALS_COUNT, "literal");
+    report("float", "fast path + fallback", (f64)best_kernel / LITERALS_COUNT, "literal");
+    delete[] text;
+    delete[] literals;
+    return SUCCESS;
+}
+
+// the whole lexer on a source made of literal assignments
+static u8
+bench_literal_source()
+{
+    const uint size = 16 * 1024 * 1024;
+    char *source    = new char[size + EXTRA_NULL_TERMINATORS];
+    u64 seed        = 0x11e7a1;
+    uint pos        = 0;
+    while (pos + 64 < size)
+    {
+        const u64 r = rng_next(&seed);
+        const unsigned long long wide = r >> 8;
+        const uint x = (uint)(r >> 40), y = (uint)(r % 99991);
+        switch (r % 5)
+        {
+            case 0: pos += (uint)sprintf(source + pos, "a := %llu;\n", wide >> 12); break;
+            case 1: pos += (uint)sprintf(source + pos, "b := %u.%u;\n", x, y); break;
+            case 2: pos += (uint)sprintf(source + pos, "c := 0x%llX;\n", wide); break;
+            case 3:
+                pos += (uint)sprintf(source + pos, "d := 0b%u%u%u101;\n", (uint)(r & 1),
+                                     (uint)(r >> 1 & 1), (uint)(r >> 2 & 1));
+                break;
+            case 4: pos += (uint)sprintf(source + pos, "e := '%c';\n", 'a' + (char)(r % 26)); break;
+        }
+    }
+    memset(source + pos, ' ', size - pos);
+    memset(source + size, 0, EXTRA_NULL_TERMINATORS);
+    file_t file("literals.vr", source, size, valid::success);
+
+    u64 best = ~0ull;
+    usize count = 0, literals = 0;
+    for (uint round = 0; round < LITERALS_ROUNDS; round++)
+    {
+        Lexer lexer(&file);
+        const u64 start = now_ns();
+        if (lexer.lex() != SUCCESS) return FAILURE;
+        const u64 elapsed = now_ns() - start;
+        if (elapsed < best) best = elapsed;
+        count    = lexer.get_tokens()->count();
+        literals = lexer.get_literals()->count();
+    }
+    report("literal source", "lex() with decoding", (f64)best / (f64)count, "token");
+    fprintf(stdout, "%-16s %-24s %10.1f MB/s (%llu literals)\n", "literal source", "throughput",
+            (f64)size / ((f64)best / 1e9) / 1e6, literals);
+    return SUCCESS;
+}
+
+// a dot only belongs to a number when a digit follows it, `0..2` is a range
+static u8
+check_number_dots()
+{
+    cstr text                = "0..2 1.5 3..4.5";
+    const TknType expected[] = {TknType::Integer, TknType::To,      TknType::Integer,
+                                TknType::Float,   TknType::Integer, TknType::To,
+                                TknType::Float};
+    const uint count         = sizeof(expected) / sizeof(expected[0]);
+    const uint size          = (uint)strlen(text);
+    char *source             = new char[size + EXTRA_NULL_TERMINATORS];
+    memcpy(source, text, size);
+    memset(source + size, 0, EXTRA_NULL_TERMINATORS);
+    file_t file("dots.vr", source, size, valid::success);
+    Lexer lexer(&file);
+    const bool lexed          = lexer.lex() == SUCCESS;
+    const TokenStream *tokens = lexer.get_tokens();
+    bool same = lexed && tokens->count() >= count && lexer.get_literals()->count() == 5;
+    for (uint i = 0; same && i < count; i++)
+        same = tokens->type(i) == expected[i];
+    if (!same) fprintf(stderr, "literals: `0..2 1.5 3..4.5` lexed wrong\n");
+    return same ? SUCCESS : FAILURE;
+}
+
+u8
+bench_literals()
+{
+    u8 status = check_number_dots();
+    if (status == SUCCESS) status = bench_integers(LiteralKind::decimal, "decimal", parse_decimal, 10);
+    if (status == SUCCESS) status = bench_integers(LiteralKind::hex, "hex", parse_hex, 16);
+    if (status == SUCCESS) status = bench_integers(LiteralKind::binary, "binary", parse_binary, 2);
+    if (status == SUCCESS) status = bench_floats();
+    if (status == SUCCESS) status = bench_literal_source();
+    return status;
+}
+
+} // namespace bench
+} // namespace rotate
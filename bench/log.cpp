@@ -0,0 +1,100 @@
+#include "bench.hpp"
+
+#include "../src/fe/lexer.hpp"
+#include "../src/include/log.hpp"
+
+namespace rotate
+{
+namespace bench
+{
+
+/*
+ *  --log output of a large source, written to a temporary file
+ *  the old fprintf per token against the LogWriter formats, and a plain fwrite
+ *  of as many bytes as the org log for the raw write bandwidth
+ */
+
+constexpr uint LOG_SOURCE_SIZE = 64 * 1024 * 1024;
+constexpr uint LOG_ROUNDS      = 3;
+
+enum class LogMode : u8
+{
+    fprintf_tokens,
+    org,
+    json,
+    binary,
+    raw,
+};
+
+static u8
+write_log(const LogMode mode, file_t *source, Lexer *lexer, const usize raw_bytes, FILE *output)
+{
+    switch (mode)
+    {
+        case LogMode::fprintf_tokens: {
+            const TokenStream *tokens = lexer->get_tokens();
+            for (TknIdx i = 0; i < (TknIdx)tokens->count(); i++)
+                log_token(output, tokens, i);
+            return fflush(output) == 0 ? SUCCESS : FAILURE;
+        }
+        case LogMode::org: log_compilation(output, source, lexer, LogFormat::org); break;
+        case LogMode::json: log_compilation(output, source, lexer, LogFormat::json); break;
+        case LogMode::binary: log_compilation(output, source, lexer, LogFormat::binary); break;
+        case LogMode::raw: {
+            static char block[LOG_BUFFER_SIZE];
+            for (usize done = 0; done < raw_bytes; done += LOG_BUFFER_SIZE)
+            {
+                const usize n = raw_bytes - done < LOG_BUFFER_SIZE ? raw_bytes - done
+                                                                   : LOG_BUFFER_SIZE;
+                if (fwrite(block, 1, n, output) != n) return FAILURE;
+            }
+            return fflush(output) == 0 ? SUCCESS : FAILURE;
+        }
+    }
+    return ferror(output) ? FAILURE : SUCCESS;
+}
+
+u8
+bench_log()
+{
+    static const cstr NAMES[] = {"fprintf per token", "org", "json", "binary", "raw fwrite"};
+    file_t source("log.vr", generate_source(0x106, LOG_SOURCE_SIZE), LOG_SOURCE_SIZE,
+                  valid::success);
+    Lexer lexer(&source);
+    if (lexer.lex() != SUCCESS) return FAILURE;
+    const usize tokens = lexer.get_tokens()->count();
+    lexer.get_lines(); // built once, not part of the timings
+
+    // org first, the raw write copies its size
+    static const LogMode MODES[] = {LogMode::org, LogMode::fprintf_tokens, LogMode::json,
+                                    LogMode::binary, LogMode::raw};
+    u8 exit_code    = SUCCESS;
+    usize org_bytes = 0;
+    for (const LogMode mode : MODES)
+    {
+        u64 best    = ~0ull;
+        usize bytes = 0;
+        for (uint round = 0; round < LOG_ROUNDS; round++)
+        {
+            FILE *output = tmpfile();
+            if (!output) return FAILURE;
+            const u64 start = now_ns();
+            const u8 status = write_log(mode, &source, &lexer, org_bytes, output);
+            const u64 ns    = now_ns() - start;
+            bytes           = (usize)ftell(output);
+            fclose(output);
+            if (status != SUCCESS) exit_code = FAILURE;
+            if (ns < best) best = ns;
+        }
+        if (mode == LogMode::org) org_bytes = bytes;
+        const f64 seconds = (f64)best / 1e9;
+        fprintf(stdout, "%-16s %-24s %9.1f MB/s %8.2f ns/tkn %9.1f MiB\n", "log",
+                NAMES[(u8)mode], (f64)bytes / seconds / 1e6, (f64)best / (f64)tokens,
+                (f64)bytes / (1024.0 * 1024.0));
+    }
+    if (exit_code != SUCCESS) fprintf(stderr, "log: a log write failed\n");
+    return exit_code;
+}
+
+} // namespace bench
+} // namespace rotate
@@ -0,0 +1,253 @@
+#include "bench.hpp"
+
+#include "../src/fe/token_stream.hpp"
+#include "../src/include/Array.hpp"
+
+#include <time.h>
+
+namespace rotate
+{
+namespace bench
+{
+
+u64
+now_ns() noexcept
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+u64
+rng_next(u64 *state) noexcept
+{
+    u64 x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+void
+report(cstr name, cstr variant, const f64 ns_per_op, cstr unit)
+{
+    fprintf(stdout, "%-16s %-24s %10.3f ns/%s\n", name, variant, ns_per_op, unit);
+}
+
+struct Result
+{
+    char key[96]; // name<TAB>variant
+    f64 mb_per_s;
+};
+
+static Array<Result> results;
+
+void
+record(cstr name, cstr variant, const f64 mb_per_s)
+{
+    Result result;
+    snprintf(result.key, sizeof(result.key), "%s\t%s", name, variant);
+    result.mb_per_s = mb_per_s;
+    results.append(result);
+}
+
+// decoded value of a literal token as raw bits, 0 for other tokens
+static u64
+literal_bits(const TokenStream *ts, const TknIdx i)
+{
+    const u32 payload = ts->payload(i);
+    switch (ts->type(i))
+    {
+        case TknType::Integer: return ts->literals()->integer(payload);
+        case TknType::Char: return (u8)ts->literals()->character(payload);
+        case TknType::Float: {
+            const f64 value = ts->literals()->floating(payload);
+            u64 bits;
+            memcpy(&bits, &value, sizeof(u64));
+            return bits;
+        }
+        default: return 0;
+    }
+}
+
+bool
+same_tokens(const TokenStream *a, const TokenStream *b)
+{
+    if (a->count() != b->count()) return false;
+    for (TknIdx i = 0; i < a->count(); i++)
+    {
+        if (a->type(i) != b->type(i) || a->offset(i) != b->offset(i) ||
+            a->length(i) != b->length(i) || literal_bits(a, i) != literal_bits(b, i))
+            return false;
+        // symbol ids depend on the order the names were interned in, the names may not
+        if (a->type(i) == TknType::Identifier &&
+            strcmp(a->symbols()->name(a->payload(i)), b->symbols()->name(b->payload(i))) != 0)
+            return false;
+        if (a->type(i) == TknType::String)
+        {
+            const StringView x = a->string(i), y = b->string(i);
+            if (x.length != y.length || memcmp(x.data, y.data, x.length) != 0) return false;
+        }
+    }
+    return true;
+}
+
+bool
+same_pools(const TokenStream *a, const TokenStream *b)
+{
+    if (a->count() != b->count() || a->symbols()->count() != b->symbols()->count() ||
+        a->strings()->count() != b->strings()->count() ||
+        a->literals()->count() != b->literals()->count())
+        return false;
+    for (TknIdx i = 0; i < a->count(); i++)
+        if (a->payload(i) != b->payload(i)) return false;
+    for (u32 id = 0; id < a->symbols()->count(); id++)
+        if (strcmp(a->symbols()->name(id), b->symbols()->name(id)) != 0) return false;
+    for (u32 id = 0; id < a->strings()->count(); id++)
+    {
+        const StringView x = a->strings()->value(id), y = b->strings()->value(id);
+        if (x.length != y.length || memcmp(x.data, y.data, x.length) != 0) return false;
+    }
+    return true;
+}
+
+static const Benchmark BENCHMARKS[] = {
+    {"keywords", "perfect hash keyword lookup vs the old switch", bench_keywords},
+    {"parallel", "chunked lexing of one large file, 1 to N threads", bench_parallel},
+    {"streaming", "batch lex() vs next_token(), time and peak RSS", bench_streaming},
+    {"relex", "incremental re-lexing of single edits vs a full lex", bench_relex},
+    {"literals", "literal decoding kernels vs the C library", bench_literals},
+    {"strings", "closing quote search and escaped string pooling", bench_strings},
+    {"array", "Array growth, emplace and SmallArray vs the old Array", bench_array},
+    {"arena", "arena allocation vs malloc for nodes, scratch buffers and tokens", bench_arena},
+    {"file", "mmap vs buffered file_read, time to first token and peak RSS", bench_file},
+    {"validate", "UTF-8 and forbidden byte validation of a source, per simd level",
+     bench_validate},
+    {"throughput", "MB/s, tokens/s and ns/token of the front end per corpus size",
+     bench_throughput},
+    {"log", "--log formats vs a fprintf per token and the raw write bandwidth", bench_log},
+    {"cache", "token cache: content hash, cold vs warm lexing per source size", bench_cache},
+    {"modules", "parallel loading of a wide import graph, 1 to N threads", bench_modules},
+    {"uring", "io_uring batched reads of many small sources vs file_read", bench_uring},
+    {"sources", "SourceManager location lookups vs a scan of the sources", bench_sources},
+};
+static const uint BENCHMARKS_COUNT = sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]);
+
+static u8
+save_baseline(cstr path)
+{
+    FILE *output = fopen(path, "wb");
+    if (!output) return FAILURE;
+    for (usize i = 0; i < results.count(); i++)
+        fprintf(output, "%s\t%.3f\n", results[i].key, results[i].mb_per_s);
+    return fclose(output) == 0 ? SUCCESS : FAILURE;
+}
+
+// every recorded result that is in the baseline must be within `tolerance` percent of it
+static u8
+compare_baseline(cstr path, const f64 tolerance)
+{
+    FILE *input = fopen(path, "rb");
+    if (!input) return FAILURE;
+    u8 exit_code  = SUCCESS;
+    uint compared = 0, regressed = 0;
+    char line[160];
+    while (fgets(line, sizeof(line), input))
+    {
+        char *value = strrchr(line, '\t');
+        if (!value) continue;
+        *value++         = '\0';
+        const f64 before = strtod(value, nullptr);
+        for (usize i = 0; i < results.count(); i++)
+        {
+            if (strcmp(results[i].key, line) != 0) continue;
+            const f64 change = before > 0 ? 100.0 * (results[i].mb_per_s / before - 1.0) : 0.0;
+            compared++;
+            if (change >= -tolerance) break;
+            regressed++;
+            exit_code = FAILURE;
+            char *tab = strchr(line, '\t');
+            *tab      = ' ';
+            fprintf(stdout, "[%sREGRESSION%s] : %s %.1f -> %.1f MB/s (%+.1f%%)\n", LRED, RESET,
+                    line, before, results[i].mb_per_s, change);
+        }
+    }
+    fclose(input);
+    fprintf(stdout, "[%sBASELINE%s] : %u compared, %u regressed (tolerance %.1f%%)\n",
+            exit_code == SUCCESS ? LGREEN : LRED, RESET, compared, regressed, tolerance);
+    return exit_code;
+}
+
+// SIZE[k|m|g], 0 when invalid
+static u64
+parse_size(cstr text)
+{
+    char *end   = nullptr;
+    const u64 n = strtoull(text, &end, 10);
+    u64 unit    = 1;
+    if (*end == 'k' || *end == 'K') unit = 1024ull;
+    if (*end == 'm' || *end == 'M') unit = 1024ull * 1024;
+    if (*end == 'g' || *end == 'G') unit = 1024ull * 1024 * 1024;
+    return end == text || (unit > 1 ? end[1] : end[0]) ? 0 : n * unit;
+}
+
+} // namespace bench
+} // namespace rotate
+
+int
+main(const int argc, char **const argv)
+{
+    using namespace rotate;
+    using namespace rotate::bench;
+
+    cstr baseline = nullptr, save = nullptr;
+    f64 tolerance = 10.0;
+    u64 corpus    = 0, seed = 0x5eed;
+    uint names    = 0;
+    for (s32 j = 1; j < argc; j++)
+    {
+        cstr arg = argv[j];
+        if (strncmp(arg, "--baseline=", 11) == 0) { baseline = arg + 11; }
+        else if (strncmp(arg, "--save-baseline=", 16) == 0) { save = arg + 16; }
+        else if (strncmp(arg, "--tolerance=", 12) == 0) { tolerance = strtod(arg + 12, nullptr); }
+        else if (strncmp(arg, "--seed=", 7) == 0) { seed = strtoull(arg + 7, nullptr, 0); }
+        else if (strncmp(arg, "--corpus=", 9) == 0)
+        {
+            corpus = parse_size(arg + 9);
+            if (!corpus)
+            {
+                fprintf(stderr, "invalid corpus size: `%s`\n", arg + 9);
+                return FAILURE;
+            }
+        }
+        else if (arg[0] == '-')
+        {
+            fprintf(stderr, "unknown flag: `%s`\n", arg);
+            return FAILURE;
+        }
+        else { names++; }
+    }
+    if (corpus) return write_corpus(stdout, seed, corpus);
+
+    u8 exit_code = SUCCESS;
+    for (uint i = 0; i < BENCHMARKS_COUNT; i++)
+    {
+        bool selected = names == 0;
+        for (s32 j = 1; j < argc && !selected; j++)
+            selected = strcmp(argv[j], BENCHMARKS[i].name) == 0;
+        if (!selected) continue;
+
+        fprintf(stdout, "[%sBENCH%s] : %s (%s)\n", LMAGENTA, RESET, BENCHMARKS[i].name,
+                BENCHMARKS[i].about);
+        if (BENCHMARKS[i].run() != SUCCESS) exit_code = FAILURE;
+    }
+
+    if (save && save_baseline(save) != SUCCESS)
+    {
+        fprintf(stderr, "cannot write the baseline `%s`\n", save);
+        exit_code = FAILURE;
+    }
+    if (baseline && compare_baseline(baseline, tolerance) != SUCCESS) exit_code = FAILURE;
+    return exit_code;
+}
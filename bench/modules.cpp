@@ -0,0 +1,129 @@
+#include "bench.hpp"
+
+#include "../src/include/file.hpp"
+#include "../src/include/modules.hpp"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace rotate
+{
+namespace bench
+{
+
+/*
+ *  module loading of a wide import graph: a main source importing
+ *  MODULES_COUNT generated modules, module i also imports module (i - 1) / 2;
+ *  the graph is read and lexed with 1 to N workers (token cache off)
+ */
+
+constexpr uint MODULES_COUNT = 256;
+constexpr uint MODULES_SIZE  = 256 * 1024;
+constexpr uint MODULES_ROUNDS = 3;
+
+// the generated imports would point nowhere, they are turned into comments
+static void
+comment_imports(char *source, const uint size)
+{
+    for (char *at = source; (at = static_cast<char *>(memmem(at, size - (uint)(at - source),
+                                                            "import \"", 8)));
+         at += 8)
+        if (at == source || at[-1] == '\n') at[0] = '#';
+}
+
+static u8
+write_module(cstr path, cstr imports, char *body, const uint size)
+{
+    FILE *out = fopen(path, "wb");
+    if (!out) return FAILURE;
+    const bool ok = fputs(imports, out) >= 0 && fwrite(body, 1, size, out) == size;
+    return fclose(out) == 0 && ok ? SUCCESS : FAILURE;
+}
+
+static void
+remove_modules(cstr dir)
+{
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf '%s'", dir);
+    if (system(command) != 0) fprintf(stderr, "modules: could not remove `%s`\n", dir);
+}
+
+u8
+bench_modules()
+{
+    char dir[] = "/tmp/vr_bench_modules_XXXXXX";
+    if (!mkdtemp(dir)) return FAILURE;
+
+    char path[96], imports[64];
+    u8 exit_code = SUCCESS;
+    Array<char> main_imports(MODULES_COUNT * 24);
+    for (uint i = 0; i < MODULES_COUNT && exit_code == SUCCESS; i++)
+    {
+        char *body = generate_source(0x30d + i, MODULES_SIZE);
+        comment_imports(body, MODULES_SIZE);
+        if (i) { snprintf(imports, sizeof(imports), "import \"m%u\";\n", (i - 1) / 2); }
+        else { imports[0] = '\0'; }
+        snprintf(path, sizeof(path), "%s/m%u.vr", dir, i);
+        exit_code = write_module(path, imports, body, MODULES_SIZE);
+        delete[] body;
+
+        const int n = snprintf(imports, sizeof(imports), "import \"m%u\";\n", i);
+        for (int k = 0; k < n; k++)
+            main_imports.append(imports[k]);
+    }
+    main_imports.append('\0');
+    char main_body[] = "fn main() {}\n";
+    snprintf(path, sizeof(path), "%s/main.vr", dir);
+    if (exit_code == SUCCESS)
+        exit_code = write_module(path, main_imports.data(), main_body, sizeof(main_body) - 1);
+    if (exit_code != SUCCESS)
+    {
+        remove_modules(dir);
+        return FAILURE;
+    }
+
+    char program[] = "vr", no_cache[] = "--no-cache";
+    char *argv[]   = {program, path, no_cache};
+    const compile_options options(3, argv);
+    file_t main_file = file_read(path);
+    Lexer main_lexer(&main_file);
+    if (main_file.valid_code != valid::success || main_lexer.lex() != SUCCESS)
+    {
+        remove_modules(dir);
+        return FAILURE;
+    }
+
+    u64 single = 0;
+    for (uint workers = 1;; workers *= 2)
+    {
+        if (workers > hardware_threads()) workers = hardware_threads();
+        u64 best    = ~0ull;
+        usize bytes = 0;
+        for (uint round = 0; round < MODULES_ROUNDS; round++)
+        {
+            ModuleGraph graph(&options);
+            const u64 start = now_ns();
+            const u8 status = graph.load_imports(&main_file, &main_lexer, workers);
+            const u64 ns    = now_ns() - start;
+            if (status != SUCCESS || graph.count() != MODULES_COUNT + 1) exit_code = FAILURE;
+            bytes = graph.bytes();
+            if (ns < best) best = ns;
+        }
+        if (workers == 1) single = best;
+
+        char variant[32];
+        snprintf(variant, sizeof(variant), "%u modules, %u threads", MODULES_COUNT, workers);
+        const f64 mb_per_s = (f64)bytes / ((f64)best / 1e9) / 1e6;
+        fprintf(stdout, "%-16s %-24s %10.3f ms %9.1f MB/s  x%.2f\n", "modules", variant,
+                (f64)best / 1e6, mb_per_s, (f64)single / (f64)best);
+        record("modules", variant, mb_per_s);
+        if (workers == hardware_threads()) break;
+    }
+
+    remove_modules(dir);
+    if (exit_code != SUCCESS) fprintf(stderr, "modules: the graph did not load\n");
+    return exit_code;
+}
+
+} // namespace bench
+} // namespace rotate
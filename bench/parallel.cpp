@@ -0,0 +1,52 @@
+#include "bench.hpp"
+
+#include "../src/fe/lexer.hpp"
+#include "../src/include/file.hpp"
+
+namespace rotate
+{
+namespace bench
+{
+
+constexpr uint PARALLEL_SOURCE_SIZE = 64 * 1024 * 1024;
+constexpr uint PARALLEL_RUNS        = 3;
+
+u8
+bench_parallel()
+{
+    file_t file("parallel.vr", generate_source(0x5eed, PARALLEL_SOURCE_SIZE),
+                PARALLEL_SOURCE_SIZE, valid::success);
+
+    Lexer serial(&file);
+    if (serial.lex() != SUCCESS) return FAILURE;
+
+    // at least up to 4 threads, so the stitching is exercised on small machines
+    const uint max_threads = hardware_threads() < 4 ? 4 : hardware_threads();
+    f64 base_ns            = 0;
+    for (uint threads = 1; threads <= max_threads; threads++)
+    {
+        u64 best = ~0ull;
+        for (uint run = 0; run < PARALLEL_RUNS; run++)
+        {
+            Lexer lexer(&file);
+            const u64 start = now_ns();
+            const u8 status = lexer.lex_parallel(threads, false);
+            const u64 ns    = now_ns() - start;
+            if (status != SUCCESS || !same_tokens(serial.get_tokens(), lexer.get_tokens()) ||
+                !same_pools(serial.get_tokens(), lexer.get_tokens()))
+            {
+                fprintf(stderr, "parallel: %u threads differ from the serial lexer\n", threads);
+                return FAILURE;
+            }
+            if (ns < best) best = ns;
+        }
+        if (threads == 1) base_ns = (f64)best;
+        fprintf(stdout, "%-16s %2u threads %10.3f ms %10.1f MB/s %6.2fx\n", "parallel", threads,
+                (f64)best / 1e6, (f64)PARALLEL_SOURCE_SIZE / ((f64)best / 1e9) / 1e6,
+                base_ns / (f64)best);
+    }
+    return SUCCESS;
+}
+
+} // namespace bench
+} // namespace rotate
@@ -0,0 +1,97 @@
+#include "bench.hpp"
+
+#include "../src/fe/lexer.hpp"
+#include "../src/include/file.hpp"
+
+namespace rotate
+{
+namespace bench
+{
+
+constexpr uint RELEX_SOURCE_SIZE = 16 * 1024 * 1024;
+constexpr uint RELEX_EDITS       = 64;
+
+// replacements inserted at a line start, the last one comments out code up to the next `*/`
+static const cstr RELEX_INSERTS[] = {
+    "x := 1;\n",
+    "fn edited(a: int) int {\n    return a;\n}\n",
+    "",
+    "/* ",
+};
+static const uint RELEX_INSERTS_COUNT = sizeof(RELEX_INSERTS) / sizeof(RELEX_INSERTS[0]);
+
+u8
+bench_relex()
+{
+    char *source = generate_source(0xed17, RELEX_SOURCE_SIZE);
+    uint length  = RELEX_SOURCE_SIZE;
+    file_t *file = new file_t("relex.vr", source, length, valid::success);
+    Lexer *lexer = new Lexer(file);
+    if (lexer->lex() != SUCCESS) return FAILURE;
+
+    u64 seed = 0xed17, relex_ns = 0, full_ns = 0;
+    for (uint e = 0; e < RELEX_EDITS; e++)
+    {
+        // an edit at a line start, removing up to the next newline for the empty insert
+        const u64 r   = rng_next(&seed);
+        cstr nl       = static_cast<cstr>(memchr(source + r % (length / 2), '\n', length / 2));
+        const uint at = (uint)(nl - source) + 1;
+        cstr insert   = RELEX_INSERTS[(r >> 32) % RELEX_INSERTS_COUNT];
+        cstr line_end = static_cast<cstr>(memchr(source + at, '\n', length - at));
+        const uint removed  = *insert ? 0 : (uint)(line_end - source) + 1 - at;
+        const uint inserted = (uint)strlen(insert);
+        const TextEdit edit = {at, at + removed, at + inserted};
+
+        const uint edited_length = length - removed + inserted;
+        char *edited             = new char[edited_length + EXTRA_NULL_TERMINATORS];
+        memcpy(edited, source, at);
+        memcpy(edited + at, insert, inserted);
+        memcpy(edited + at + inserted, source + at + removed,
+               length - at - removed + EXTRA_NULL_TERMINATORS);
+        file_t *next_file = new file_t("relex.vr", edited, edited_length, valid::success);
+
+        // the edits that break the source are dropped without their diagnostics
+        Lexer *incremental = new Lexer(next_file);
+        incremental->set_silent(true);
+        u64 start          = now_ns();
+        const u8 status    = incremental->relex(lexer, edit);
+        relex_ns += now_ns() - start;
+
+        Lexer full(next_file);
+        full.set_silent(true);
+        start = now_ns();
+        const u8 full_status = full.lex();
+        full_ns += now_ns() - start;
+
+        // the pools only grow, the values the tokens name are compared instead of the ids
+        if (status != full_status ||
+            (status == SUCCESS && !same_tokens(incremental->get_tokens(), full.get_tokens())))
+        {
+            fprintf(stderr, "relex: edit %u differs from a full lex\n", e);
+            return FAILURE;
+        }
+        if (status != SUCCESS)
+        {
+            // an edit that breaks the source (a removed line opening a string...) is dropped
+            delete incremental;
+            delete next_file;
+            continue;
+        }
+
+        delete lexer;
+        delete file;
+        lexer  = incremental;
+        file   = next_file;
+        source = edited;
+        length = edited_length;
+    }
+    delete lexer;
+    delete file;
+
+    report("relex", "incremental", (f64)relex_ns / RELEX_EDITS, "edit");
+    report("relex", "full lex", (f64)full_ns / RELEX_EDITS, "edit");
+    return SUCCESS;
+}
+
+} // namespace bench
+} // namespace rotate
@@ -0,0 +1,84 @@
+#include "bench.hpp"
+
+#include "../src/include/source_manager.hpp"
+
+namespace rotate
+{
+namespace bench
+{
+
+/*
+ *  source locations: SOURCES_LOOKUPS random global locations are turned back
+ *  into their source, by the SourceManager's range table against a scan of
+ *  every source's range, for a growing number of sources of 1 B to 64 KiB
+ */
+
+static const uint SOURCES_COUNTS[] = {16, 1024, 32 * 1024};
+constexpr uint SOURCES_LOOKUPS     = 1 << 20;
+constexpr uint SOURCES_ROUNDS      = 3;
+
+u8
+bench_sources()
+{
+    u8 exit_code = SUCCESS;
+    for (const uint count : SOURCES_COUNTS)
+    {
+        // only the lengths are looked at, the sources have no contents
+        u64 state      = 0x50c + count;
+        file_t **files = new file_t *[count];
+        SourceManager sources;
+        Array<SrcLoc> ends(count);
+        for (uint i = 0; i < count; i++)
+        {
+            files[i] = new file_t("s.vr", nullptr, (uint)(rng_next(&state) % (64 * 1024)) + 1,
+                                  valid::success);
+            if (sources.add(files[i]) != i) exit_code = FAILURE;
+            ends.append(sources.base(i) + files[i]->length);
+        }
+        const SrcLoc space = ends.last() + 1;
+        SrcLoc *locations  = new SrcLoc[SOURCES_LOOKUPS];
+        for (uint i = 0; i < SOURCES_LOOKUPS; i++)
+            locations[i] = (SrcLoc)(rng_next(&state) % space);
+
+        u64 best_table = ~0ull, best_scan = ~0ull;
+        for (uint round = 0; round < SOURCES_ROUNDS; round++)
+        {
+            u64 sum         = 0;
+            u64 start       = now_ns();
+            for (uint i = 0; i < SOURCES_LOOKUPS; i++)
+                sum += sources.source_of(locations[i]);
+            const u64 table = now_ns() - start;
+
+            u64 scanned = 0;
+            start       = now_ns();
+            for (uint i = 0; i < SOURCES_LOOKUPS; i++)
+            {
+                uint s = 0;
+                while (ends[s] < locations[i])
+                    s++;
+                scanned += s;
+            }
+            const u64 scan = now_ns() - start;
+            keep(scanned);
+            if (sum != scanned) exit_code = FAILURE;
+            if (table < best_table) best_table = table;
+            if (scan < best_scan) best_scan = scan;
+        }
+
+        char variant[32];
+        snprintf(variant, sizeof(variant), "%u sources, table", count);
+        report("source_of", variant, (f64)best_table / SOURCES_LOOKUPS, "lookup");
+        snprintf(variant, sizeof(variant), "%u sources, scan", count);
+        report("source_of", variant, (f64)best_scan / SOURCES_LOOKUPS, "lookup");
+
+        delete[] locations;
+        for (uint i = 0; i < count; i++)
+            delete files[i];
+        delete[] files;
+    }
+    if (exit_code != SUCCESS) fprintf(stderr, "sources: a location was given the wrong source\n");
+    return exit_code;
+}
+
+} // namespace bench
+} // namespace rotate
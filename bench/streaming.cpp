@@ -0,0 +1,112 @@
+#include "bench.hpp"
+
+#include "../src/fe/lexer.hpp"
+#include "../src/include/file.hpp"
+
+#include <malloc.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace rotate
+{
+namespace bench
+{
+
+/*
+ *  batch `lex()` vs the streaming `next_token()` interface
+ *  every mode runs in a forked child, so its peak RSS is not hidden by the
+ *  peak of a previous mode; the source alone is measured as the baseline
+ */
+
+constexpr uint STREAMING_SOURCE_SIZE = 64 * 1024 * 1024;
+
+enum class LexMode : u8
+{
+    source,
+    batch,
+    stream,
+};
+
+// runs in the child, the exit code is the status
+static u8
+run_mode(const LexMode mode, u64 *ns, u64 *count)
+{
+    file_t file("streaming.vr", generate_source(0x5eed, STREAMING_SOURCE_SIZE),
+                STREAMING_SOURCE_SIZE, valid::success);
+    Lexer lexer(&file);
+    const u64 start = now_ns();
+    switch (mode)
+    {
+        case LexMode::source: break;
+        case LexMode::batch: {
+            if (lexer.lex() != SUCCESS) return FAILURE;
+            *count = lexer.get_tokens()->count();
+            break;
+        }
+        case LexMode::stream: {
+            // consume like a parser would, one token with a bit of lookahead
+            u64 kinds = 0;
+            for (;;)
+            {
+                const Token tkn = lexer.next_token();
+                kinds += (u64)lexer.peek_token(1).type;
+                (*count)++;
+                if (tkn.type == TknType::EOT) break;
+            }
+            keep(kinds);
+            if (lexer.failed()) return FAILURE;
+            // the batch stream ends with EXTRA_NULL_TERMINATORS EOT tokens
+            *count += EXTRA_NULL_TERMINATORS - 1;
+            break;
+        }
+    }
+    *ns = now_ns() - start;
+    return SUCCESS;
+}
+
+u8
+bench_streaming()
+{
+    static const cstr NAMES[] = {"source only", "batch lex()", "stream next_token()"};
+    // the children inherit the resident memory of the previous benchmarks otherwise
+    malloc_trim(0);
+    for (u8 mode = 0; mode < 3; mode++)
+    {
+        // the child reports its timing through a pipe
+        int fds[2];
+        if (pipe(fds) != 0) return FAILURE;
+        const pid_t pid = fork();
+        if (pid < 0) return FAILURE;
+        if (pid == 0)
+        {
+            u64 result[2] = {0, 0};
+            const u8 status = run_mode((LexMode)mode, &result[0], &result[1]);
+            if (write(fds[1], result, sizeof(result)) != sizeof(result)) _exit(FAILURE);
+            _exit(status);
+        }
+
+        close(fds[1]);
+        u64 result[2] = {0, 0};
+        const bool got = read(fds[0], result, sizeof(result)) == sizeof(result);
+        close(fds[0]);
+        int status = 0;
+        rusage usage;
+        if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != SUCCESS || !got)
+        {
+            fprintf(stderr, "streaming: `%s` failed\n", NAMES[mode]);
+            return FAILURE;
+        }
+
+        // ru_maxrss is in KiB on linux
+        fprintf(stdout, "%-16s %-24s %10.3f ms %10ld KiB peak rss", "streaming", NAMES[mode],
+                (f64)result[0] / 1e6, usage.ru_maxrss);
+        if (result[1]) fprintf(stdout, " %8.3f ns/token", (f64)result[0] / (f64)result[1]);
+        fprintf(stdout, "\n");
+    }
+    return SUCCESS;
+}
+
+} // namespace bench
+} // namespace rotate
@@ -0,0 +1,108 @@
+#include "bench.hpp"
+
+#include "../src/fe/lexer.hpp"
+#include "../src/include/file.hpp"
+
+namespace rotate
+{
+namespace bench
+{
+
+constexpr uint STRINGS_SOURCE_SIZE = 16 * 1024 * 1024;
+constexpr uint STRINGS_ROUNDS      = 5;
+
+// string literals of 8 to 200 bytes, one in 8 with an escape
+static char *
+generate_strings(u64 seed, const uint size)
+{
+    char *out = new char[size + EXTRA_NULL_TERMINATORS];
+    uint at   = 0;
+    while (at + 256 < size)
+    {
+        const u64 r = rng_next(&seed);
+        at += (uint)sprintf(out + at, "s := \"");
+        const uint body = 8 + (uint)(r % 193);
+        for (uint i = 0; i < body; i++)
+            out[at + i] = (char)('a' + (r >> (i % 48)) % 26);
+        at += body;
+        if (r % 8 == 0) at += (uint)sprintf(out + at, "\\\"\\n");
+        at += (uint)sprintf(out + at, "\";\n");
+    }
+    memset(out + at, ' ', size - at);
+    memset(out + size, 0, EXTRA_NULL_TERMINATORS);
+    return out;
+}
+
+// the scan of the old `lex_strings`, a byte at a time
+static uint
+scan_bytes(cstr src, uint pos)
+{
+    while (src[pos] != '\0' && (src[pos] != '"' || src[pos - 1] == '\\'))
+        pos++;
+    return pos;
+}
+
+u8
+bench_strings()
+{
+    char *source = generate_strings(0x5791, STRINGS_SOURCE_SIZE);
+    file_t file("strings.vr", source, STRINGS_SOURCE_SIZE, valid::success);
+
+    // the closing quote search alone, from every opening quote
+    u64 best_bytes = ~0ull, best_swar = ~0ull;
+    usize strings = 0;
+    for (uint round = 0; round < STRINGS_ROUNDS; round++)
+    {
+        u64 sum   = 0;
+        u64 start = now_ns();
+        for (cstr q = strchr(source, '"'); q; q = strchr(source + sum, '"'))
+            sum = scan_bytes(source, (uint)(q - source) + 1) + 1;
+        u64 elapsed = now_ns() - start;
+        keep(sum);
+        if (elapsed < best_bytes) best_bytes = elapsed;
+
+        u64 check = 0;
+        strings   = 0;
+        start     = now_ns();
+        for (cstr q = strchr(source, '"'); q; q = strchr(source + check, '"'), strings++)
+        {
+            uint pos = scan_string_run(source, (uint)(q - source) + 1, STRINGS_SOURCE_SIZE);
+            while (source[pos] == '\\')
+                pos = scan_string_run(source, pos + 2, STRINGS_SOURCE_SIZE);
+            check = pos + 1;
+        }
+        elapsed = now_ns() - start;
+        keep(check);
+        if (elapsed < best_swar) best_swar = elapsed;
+        if (check != sum)
+        {
+            fprintf(stderr, "strings: the scans disagree\n");
+            return FAILURE;
+        }
+    }
+    report("closing quote", "byte loop", (f64)best_bytes / (f64)strings, "string");
+    report("closing quote", "swar scan", (f64)best_swar / (f64)strings, "string");
+
+    // both engines with the pool
+    for (uint simd = 0; simd < 2; simd++)
+    {
+        u64 best     = ~0ull;
+        usize pooled = 0;
+        for (uint round = 0; round < STRINGS_ROUNDS; round++)
+        {
+            Lexer lexer(&file);
+            const u64 start = now_ns();
+            if ((simd ? lexer.lex_simd() : lexer.lex()) != SUCCESS) return FAILURE;
+            const u64 elapsed = now_ns() - start;
+            if (elapsed < best) best = elapsed;
+            pooled = lexer.get_strings()->count();
+        }
+        fprintf(stdout, "%-16s %-24s %10.1f MB/s (%llu strings, %llu pooled)\n", "string source",
+                simd ? "lex_simd()" : "lex()", (f64)STRINGS_SOURCE_SIZE / ((f64)best / 1e9) / 1e6,
+                strings, pooled);
+    }
+    return SUCCESS;
+}
+
+} // namespace bench
+} // namespace rotate
@@ -0,0 +1,124 @@
+#include "bench.hpp"
+
+#include "../src/fe/lexer.hpp"
+#include "../src/include/file.hpp"
+
+#include <unistd.h>
+
+namespace rotate
+{
+namespace bench
+{
+
+/*
+ *  front end throughput on generated corpora of a few sizes
+ *  MB/s, tokens/s and ns per token of lex(), lex_simd(), next_token() and of
+ *  file_read (validation included) followed by lex(), the stages a compile runs
+ *  today; every result is recorded for `--baseline`
+ */
+
+static const uint THROUGHPUT_SIZES[] = {16 * 1024, 1024 * 1024, 32 * 1024 * 1024};
+constexpr u64 THROUGHPUT_MIN_NS      = 200 * 1000 * 1000; // per variant and size
+constexpr uint THROUGHPUT_MIN_ROUNDS = 3;
+
+enum class FrontEnd : u8
+{
+    lex,
+    lex_simd,
+    next_token,
+    read_lex,
+};
+
+// one run, the tokens lexed in `*tokens`
+static u8
+run_front_end(const FrontEnd mode, const file_t *source, cstr path, usize *tokens)
+{
+    switch (mode)
+    {
+        case FrontEnd::lex:
+        case FrontEnd::lex_simd: {
+            Lexer lexer(source);
+            if ((mode == FrontEnd::lex ? lexer.lex() : lexer.lex_simd()) != SUCCESS)
+                return FAILURE;
+            *tokens = lexer.get_tokens()->count();
+            return SUCCESS;
+        }
+        case FrontEnd::next_token: {
+            Lexer lexer(source);
+            usize count = 0;
+            while (lexer.next_token().type != TknType::EOT)
+                count++;
+            *tokens = count + 1;
+            return lexer.failed() ? FAILURE : SUCCESS;
+        }
+        case FrontEnd::read_lex: {
+            file_t file = file_read(path);
+            if (file.valid_code != valid::success) return FAILURE;
+            Lexer lexer(&file);
+            if (lexer.lex() != SUCCESS) return FAILURE;
+            *tokens = lexer.get_tokens()->count();
+            return SUCCESS;
+        }
+    }
+    return FAILURE;
+}
+
+u8
+bench_throughput()
+{
+    static const cstr NAMES[] = {"lex()", "lex_simd()", "next_token()", "file_read + lex()"};
+
+    u8 exit_code = SUCCESS;
+    for (const uint size : THROUGHPUT_SIZES)
+    {
+        char path[] = "/tmp/vr_bench_XXXXXX.vr";
+        const int fd = mkstemps(path, 3);
+        if (fd < 0) return FAILURE;
+        file_t source("throughput.vr", generate_source(0x7a3d, size), size, valid::success);
+        const bool written = write(fd, source.contents, size) == (ssize_t)size;
+        close(fd);
+        if (!written)
+        {
+            unlink(path);
+            return FAILURE;
+        }
+
+        for (u8 mode = 0; mode < 4; mode++)
+        {
+            u64 best = ~0ull, total = 0;
+            usize tokens = 0;
+            uint rounds  = 0;
+            for (; rounds < THROUGHPUT_MIN_ROUNDS || total < THROUGHPUT_MIN_NS; rounds++)
+            {
+                const u64 start = now_ns();
+                const u8 status = run_front_end((FrontEnd)mode, &source, path, &tokens);
+                const u64 ns    = now_ns() - start;
+                if (status != SUCCESS) break;
+                total += ns;
+                if (ns < best) best = ns;
+            }
+            if (rounds < THROUGHPUT_MIN_ROUNDS)
+            {
+                fprintf(stderr, "throughput: `%s` failed\n", NAMES[mode]);
+                exit_code = FAILURE;
+                continue;
+            }
+
+            char variant[48];
+            if (size >= 1024 * 1024)
+                snprintf(variant, sizeof(variant), "%s, %u MiB", NAMES[mode], size >> 20);
+            else
+                snprintf(variant, sizeof(variant), "%s, %u KiB", NAMES[mode], size >> 10);
+            const f64 seconds  = (f64)best / 1e9;
+            const f64 mb_per_s = (f64)size / seconds / 1e6;
+            fprintf(stdout, "%-16s %-26s %9.1f MB/s %9.2f Mtok/s %8.2f ns/tkn\n", "throughput",
+                    variant, mb_per_s, (f64)tokens / seconds / 1e6, (f64)best / (f64)tokens);
+            record("throughput", variant, mb_per_s);
+        }
+        unlink(path);
+    }
+    return exit_code;
+}
+
+} // namespace bench
+} // namespace rotate
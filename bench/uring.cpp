@@ -0,0 +1,110 @@
+#include "bench.hpp"
+
+#include "../src/include/file.hpp"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace rotate
+{
+namespace bench
+{
+
+/*
+ *  batched source reads: URING_FILES generated sources per size read one by
+ *  one with `file_read` against `file_read_batch` (io_uring, a few syscalls
+ *  for the whole batch); the files stay in the page cache, so this is the
+ *  syscall cost, not the disk's
+ */
+
+constexpr uint URING_FILES     = 4096;
+static const uint URING_SIZES[] = {512, 4 * 1024, 32 * 1024};
+constexpr uint URING_ROUNDS    = 5;
+
+struct UringRead
+{
+    usize bytes;
+    uint failed;
+};
+
+static void
+count_read(void *arg, const uint, file_t *file)
+{
+    UringRead *read = static_cast<UringRead *>(arg);
+    if (file->valid_code == valid::success) { read->bytes += file->length; }
+    else { read->failed++; }
+    delete file;
+}
+
+static void
+remove_sources(cstr dir)
+{
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf '%s'", dir);
+    if (system(command) != 0) fprintf(stderr, "uring: could not remove `%s`\n", dir);
+}
+
+u8
+bench_uring()
+{
+    char dir[] = "/tmp/vr_bench_uring_XXXXXX";
+    if (!mkdtemp(dir)) return FAILURE;
+    const bool uring = file_uring_supported();
+    if (!uring) fprintf(stdout, "%-16s io_uring is not available, both read one by one\n", "uring");
+
+    u8 exit_code = SUCCESS;
+    char **names = new char *[URING_FILES];
+    for (uint i = 0; i < URING_FILES; i++)
+    {
+        names[i] = new char[64];
+        snprintf(names[i], 64, "%s/s%u.vr", dir, i);
+    }
+
+    for (const uint size : URING_SIZES)
+    {
+        char *body = generate_source(0x5e4d + size, size);
+        for (uint i = 0; i < URING_FILES && exit_code == SUCCESS; i++)
+        {
+            FILE *out = fopen(names[i], "wb");
+            if (!out || fwrite(body, 1, size, out) != size) exit_code = FAILURE;
+            if (out && fclose(out) != 0) exit_code = FAILURE;
+        }
+        delete[] body;
+        if (exit_code != SUCCESS) break;
+
+        u64 one_by_one = ~0ull, batched = ~0ull;
+        for (uint round = 0; round < URING_ROUNDS; round++)
+        {
+            UringRead read = {0, 0};
+            u64 start      = now_ns();
+            for (uint i = 0; i < URING_FILES; i++)
+                count_read(&read, i, new file_t(file_read(names[i], false)));
+            const u64 single = now_ns() - start;
+
+            start = now_ns();
+            file_read_batch(names, URING_FILES, count_read, &read, false);
+            const u64 ns = now_ns() - start;
+            if (read.failed || read.bytes != 2ull * URING_FILES * size) exit_code = FAILURE;
+            if (single < one_by_one) one_by_one = single;
+            if (ns < batched) batched = ns;
+        }
+
+        char variant[32];
+        snprintf(variant, sizeof(variant), "%u x %u B", URING_FILES, size);
+        const f64 bytes = (f64)URING_FILES * size;
+        fprintf(stdout, "%-16s %-24s file_read %8.3f ms, batch %8.3f ms (%.2fx), %.2f us/file\n",
+                "uring", variant, (f64)one_by_one / 1e6, (f64)batched / 1e6,
+                (f64)one_by_one / (f64)batched, (f64)batched / 1e3 / URING_FILES);
+        record("uring", variant, bytes / ((f64)batched / 1e9) / 1e6);
+    }
+
+    for (uint i = 0; i < URING_FILES; i++)
+        delete[] names[i];
+    delete[] names;
+    remove_sources(dir);
+    if (exit_code != SUCCESS) fprintf(stderr, "uring: a source was not read\n");
+    return exit_code;
+}
+
+} // namespace bench
+} // namespace rotate
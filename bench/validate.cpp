@@ -0,0 +1,76 @@
+#include "bench.hpp"
+
+#include "../src/fe/simd.hpp"
+
+namespace rotate
+{
+namespace bench
+{
+
+constexpr uint VALIDATE_SOURCE_SIZE = 64 * 1024 * 1024;
+constexpr uint VALIDATE_ROUNDS      = 5;
+
+// the generated source with a comment of two and three byte UTF-8 characters on every 8th line
+static char *
+utf8_source(const u64 seed)
+{
+    static const char COMMENT[] = "# ünïcödé tëxt — © ✓\n";
+    char *ascii = generate_source(seed, VALIDATE_SOURCE_SIZE);
+    char *out   = new char[VALIDATE_SOURCE_SIZE + EXTRA_NULL_TERMINATORS];
+    uint at = 0, lines = 0;
+    for (uint i = 0; at < VALIDATE_SOURCE_SIZE; i++)
+    {
+        out[at++] = ascii[i];
+        if (ascii[i] != '\n' || ++lines % 8) continue;
+        const uint take = VALIDATE_SOURCE_SIZE - at < sizeof(COMMENT) - 1
+                              ? VALIDATE_SOURCE_SIZE - at
+                              : (uint)sizeof(COMMENT) - 1;
+        memcpy(out + at, COMMENT, take);
+        at += take;
+    }
+    // never end inside a character
+    memset(out + VALIDATE_SOURCE_SIZE - 64, ' ', 63);
+    out[VALIDATE_SOURCE_SIZE - 1] = '\n';
+    memset(out + VALIDATE_SOURCE_SIZE, 0, EXTRA_NULL_TERMINATORS);
+    delete[] ascii;
+    return out;
+}
+
+u8
+bench_validate()
+{
+    static const SimdLevel LEVELS[] = {SimdLevel::scalar, SimdLevel::sse2, SimdLevel::avx2};
+    const SimdLevel best_level      = simd_detect();
+    char *sources[2] = {generate_source(0xa5c1, VALIDATE_SOURCE_SIZE), utf8_source(0xa5c1)};
+    static const cstr NAMES[] = {"ascii", "utf-8"};
+
+    u8 exit_code = SUCCESS;
+    for (uint s = 0; s < 2; s++)
+    {
+        for (const SimdLevel level : LEVELS)
+        {
+            if (level > best_level) continue;
+            u64 best = ~0ull;
+            for (uint round = 0; round < VALIDATE_ROUNDS; round++)
+            {
+                const u64 start = now_ns();
+                const uint at =
+                    simd_validate_source(sources[s], VALIDATE_SOURCE_SIZE, false, level);
+                const u64 ns = now_ns() - start;
+                if (at != VALIDATE_SOURCE_SIZE) exit_code = FAILURE;
+                if (ns < best) best = ns;
+            }
+            char variant[32];
+            snprintf(variant, sizeof(variant), "%s, %s", NAMES[s], simd_level_describe(level));
+            fprintf(stdout, "%-16s %-24s %10.2f GB/s\n", "validate", variant,
+                    (f64)VALIDATE_SOURCE_SIZE / (f64)best);
+        }
+    }
+    if (exit_code != SUCCESS) fprintf(stderr, "validate: a generated source was rejected\n");
+    delete[] sources[0];
+    delete[] sources[1];
+    return exit_code;
+}
+
+} // namespace bench
+} // namespace rotate
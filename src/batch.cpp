@@ -0,0 +1,277 @@
+#include "include/common.hpp"
+#include "include/compile.hpp"
+#include "include/file.hpp"
+#include "include/log.hpp"
+#include "include/thread_pool.hpp"
+#include "include/timer.hpp"
+
+namespace rotate
+{
+
+/*
+ *  batch compilation: many sources in one process
+ *  - the inputs are the command line files and the lines of `--batch=FILE`
+ *  - every worker takes the next input from a shared cursor, so a large file
+ *    does not hold back the files queued behind it
+ *  - a worker keeps its stage arenas between files, recycled instead of freed
+ *  - with io_uring the main thread reads every source ahead of the workers
+ *    (`file_read_batch`), inputs are then taken in the order their reads complete
+ *  - diagnostics are printed as files fail, the timings in input order at the end
+ */
+
+struct BatchFile
+{
+    cstr name;
+    u8 exit;
+    Stage st;
+    uint bytes;
+    usize tokens;
+    u64 ns;
+};
+
+struct BatchWorker;
+
+struct Batch
+{
+    const compile_options *options;
+    BatchFile *files;
+    uint count;
+    uint next; // the next input to compile, or the next of `ready`
+    // read ahead: the sources by input, the inputs in read order
+    file_t **sources;
+    uint *ready;
+    uint ready_count;
+    bool reading;
+    pthread_mutex_t lock;
+    pthread_cond_t has_ready;
+    BatchWorker *reader_worker; // compiles in the reading thread (one worker)
+};
+
+struct BatchWorker
+{
+    Batch *batch;
+    StageArenas *arenas;
+};
+
+static void
+compile_input(BatchWorker *worker, const uint i, file_t *source)
+{
+    char log_path[40];
+    BatchFile *file         = &worker->batch->files[i];
+    compile_options options = *worker->batch->options;
+    options.filename        = file->name;
+    options.stats           = false; // printed once for the whole batch
+    snprintf(log_path, sizeof(log_path), "output-%u.%s", i,
+             log_format_extension(options.log_format));
+    options.log_path = log_path;
+
+    TimeScope scope("compile", "batch", file->name);
+    const u64 start = time_ns();
+    file->exit      = compile(&options, worker->arenas, source);
+    file->ns        = time_ns() - start;
+    file->st        = options.st;
+    file->bytes     = options.source_bytes;
+    file->tokens    = options.token_count;
+    worker->arenas->recycle();
+    delete source;
+}
+
+// the next input read ahead, UINT_MAX once every one was taken
+static uint
+take_ready(Batch *batch)
+{
+    pthread_mutex_lock(&batch->lock);
+    while (batch->next == batch->ready_count && batch->reading)
+        pthread_cond_wait(&batch->has_ready, &batch->lock);
+    const uint i = batch->next < batch->ready_count ? batch->ready[batch->next++] : UINT_MAX;
+    pthread_mutex_unlock(&batch->lock);
+    return i;
+}
+
+static void
+run_worker(void *arg)
+{
+    BatchWorker *worker = static_cast<BatchWorker *>(arg);
+    Batch *batch        = worker->batch;
+    for (;;)
+    {
+        uint i = 0;
+        if (batch->sources)
+        {
+            i = take_ready(batch);
+            if (i == UINT_MAX) break;
+        }
+        else
+        {
+            i = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED);
+            if (i >= batch->count) break;
+        }
+        compile_input(worker, i, batch->sources ? batch->sources[i] : nullptr);
+    }
+}
+
+static void
+source_read(void *arg, const uint i, file_t *source)
+{
+    Batch *batch = static_cast<Batch *>(arg);
+    if (batch->reader_worker) return compile_input(batch->reader_worker, i, source);
+
+    pthread_mutex_lock(&batch->lock);
+    batch->sources[i]                  = source;
+    batch->ready[batch->ready_count++] = i;
+    pthread_cond_signal(&batch->has_ready);
+    pthread_mutex_unlock(&batch->lock);
+}
+
+// reads every input on the calling thread, handing them to the workers as they are read
+static void
+read_ahead(Batch *batch, cstr const *names)
+{
+    TimeScope scope("read sources", "batch");
+    const Stage stage = mem_stage();
+    mem_set_stage(Stage::file);
+    file_read_batch(names, batch->count, source_read, batch, batch->options->map_file,
+                    batch->options->ascii_only);
+    mem_set_stage(stage);
+
+    pthread_mutex_lock(&batch->lock);
+    batch->reading = false;
+    pthread_cond_broadcast(&batch->has_ready);
+    pthread_mutex_unlock(&batch->lock);
+}
+
+// every non empty line of `path` is an input, the lines are split in place in `*text`
+static u8
+read_list(cstr path, char **text, Array<cstr> *names)
+{
+    FILE *list = fopen(path, "rb");
+    if (!list)
+    {
+        log_error("Batch list does not exist");
+        return FAILURE;
+    }
+    fseek(list, 0, SEEK_END);
+    const long length = ftell(list);
+    rewind(list);
+    *text = new char[length < 0 ? 1 : length + 1];
+    if (length < 0 || fread(*text, 1, (usize)length, list) != (usize)length)
+    {
+        log_error("Batch list read error");
+        fclose(list);
+        return FAILURE;
+    }
+    fclose(list);
+    (*text)[length] = '\0';
+
+    for (char *line = *text; *line;)
+    {
+        char *end  = strchr(line, '\n');
+        char *next = end ? end + 1 : line + strlen(line);
+        if (!end) end = next;
+        while (end > line && isspace((u8)end[-1]))
+            end--;
+        *end = '\0';
+        if (end > line) names->append(line);
+        line = next;
+    }
+    return SUCCESS;
+}
+
+u8
+compile_batch(compile_options *options) noexcept
+{
+    Array<cstr> names;
+    for (s32 i = 1; i < options->argc; i++)
+        if (compile_options::is_input(options->argv[i])) names.append(options->argv[i]);
+    char *list = nullptr;
+    if (options->batch_list && read_list(options->batch_list, &list, &names) != SUCCESS)
+    {
+        delete[] list;
+        return FAILURE;
+    }
+
+    const uint count = (uint)names.count();
+    BatchFile *files = new BatchFile[count ? count : 1];
+    for (uint i = 0; i < count; i++)
+        files[i] = BatchFile{names[i], FAILURE, Stage::unknown, 0, 0, 0};
+
+    uint workers = options->workers ? options->workers : hardware_threads();
+    if (workers > count) workers = count ? count : 1;
+    Batch batch = {options, files, count, 0, nullptr, nullptr, 0, true, {}, {}, nullptr};
+    StageArenas *arenas       = new StageArenas[workers];
+    BatchWorker *pool_workers = new BatchWorker[workers];
+    for (uint w = 0; w < workers; w++)
+        pool_workers[w] = BatchWorker{&batch, &arenas[w]};
+    // a kernel without io_uring would only serialize the reads the workers make
+    if (options->uring && count > 1 && file_uring_supported())
+    {
+        batch.sources = new file_t *[count];
+        batch.ready   = new uint[count];
+        pthread_mutex_init(&batch.lock, nullptr);
+        pthread_cond_init(&batch.has_ready, nullptr);
+    }
+
+    const u64 start = time_ns();
+    if (batch.sources && workers == 1)
+    {
+        batch.reader_worker = &pool_workers[0];
+        read_ahead(&batch, names.data());
+    }
+    else
+    {
+        ThreadPool pool(workers);
+        for (uint w = 0; w < workers; w++)
+            pool.submit(run_worker, &pool_workers[w]);
+        if (batch.sources) read_ahead(&batch, names.data());
+        pool.wait();
+    }
+    const u64 wall = time_ns() - start;
+
+    // per file timings, in input order
+    uint failed = 0;
+    u64 busy    = 0, bytes = 0, tokens = 0;
+    fprintf(stdout, "[%sBATCH%s] : %u files, %u workers" NEWLINE, LGREEN, RESET, count, workers);
+    for (uint i = 0; i < count; i++)
+    {
+        const BatchFile *file = &files[i];
+        busy += file->ns;
+        bytes += file->bytes;
+        tokens += file->tokens;
+        if (file->exit == FAILURE)
+        {
+            failed++;
+            fprintf(stdout, "  %sFAILED%s %-12s %10.3f ms  %s" NEWLINE, LRED, RESET,
+                    stage_describe(file->st), (f64)file->ns / 1e6, file->name);
+            continue;
+        }
+        fprintf(stdout, "  ok     %9u B %8llu tkn %10.3f ms  %s" NEWLINE, file->bytes,
+                file->tokens, (f64)file->ns / 1e6, file->name);
+    }
+
+    // totals, `busy` adds up the time of every file so busy / wall is the speedup
+    options->token_count = tokens;
+    const f64 seconds = (f64)wall / 1e9;
+    fprintf(stdout,
+            "[%sBATCH%s] : %u ok, %u failed in %.3f ms (%.3f ms compiling, x%.2f), "
+            "%.1f MB/s, %.2f Mtokens/s" NEWLINE,
+            failed ? LRED : LGREEN, RESET, count - failed, failed, (f64)wall / 1e6,
+            (f64)busy / 1e6, wall ? (f64)busy / (f64)wall : 0.0,
+            seconds > 0 ? (f64)bytes / seconds / 1e6 : 0.0,
+            seconds > 0 ? (f64)tokens / seconds / 1e6 : 0.0);
+    if (options->stats) log_memory(stdout, arenas, workers);
+
+    if (batch.sources)
+    {
+        pthread_cond_destroy(&batch.has_ready);
+        pthread_mutex_destroy(&batch.lock);
+        delete[] batch.ready;
+        delete[] batch.sources;
+    }
+    delete[] pool_workers;
+    delete[] arenas;
+    delete[] files;
+    delete[] list;
+    return failed ? FAILURE : SUCCESS;
+}
+
+} // namespace rotate
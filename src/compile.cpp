@@ -2,6 +2,9 @@
 #include "include/common.hpp"
 #include "include/file.hpp"
 #include "include/log.hpp"
+#include "include/mem_stats.hpp"
+#include "include/modules.hpp"
+#include "include/timer.hpp"
 
 namespace rotate
 {
@@ -13,27 +16,82 @@ handle_err(u8 exit, cstr err_string)
     return exit;
 }
 
+// allocations and time from here on are charged to `stage`
+static void
+enter_stage(compile_options *options, StageTimer *timer, const Stage stage)
+{
+    options->st = stage;
+    mem_set_stage(stage);
+    timer->enter(stage);
+}
+
+u8
+lex_file(const compile_options *options, const file_t *file, Lexer *lexer)
+{
+    const TokenCache cache(options->cache, options->cache_dir);
+    TokenCacheKey key = {};
+    if (cache.enabled())
+    {
+        key = TokenCache::key(file->contents, file->length);
+        TokenCacheHit hit;
+        if (cache.find(&key, &hit) && lexer->lex_cached(&hit) == SUCCESS) return SUCCESS;
+    }
+
+    u8 exit = SUCCESS;
+    if (options->jobs > 1) { exit = lexer->lex_parallel(options->jobs, options->simd_lexer); }
+    else { exit = options->simd_lexer ? lexer->lex_simd() : lexer->lex(); }
+    // a failed store only costs the next compilation a lex
+    if (exit == SUCCESS && cache.enabled()) cache.store(&key, lexer->get_tokens());
+    return exit;
+}
+
 u8
-compile(compile_options *options) noexcept
+compile(compile_options *options, StageArenas *reused, file_t *source) noexcept
 {
     // Parser *parser;
     u8 exit = 0;
+    // NOTE: declared first so every stage's allocations outlive the stages
+    StageArenas own;
+    StageArenas &arenas = reused ? *reused : own;
+    StageTimer timer(options->filename);
 
-    // Read file
-    options->st = Stage::file;
-    file_t file = file_read(options->filename);
+    // Read file, unless it was read already
+    enter_stage(options, &timer, Stage::file);
+    file_t read = source ? file_t(nullptr, nullptr, 0, valid::failure)
+                         : file_read(options->filename, options->map_file, options->ascii_only);
+    file_t &file = source ? *source : read;
     ASSERT_RET_FAIL(file.valid_code == valid::success, "file read error");
+    options->source_bytes = file.length;
 
     /*
      *
      * LEXICAL ANALYSIS
      *
      * */
-    options->st = Stage::lexer;
-    Lexer lexer = Lexer(&file);
-    exit        = lexer.lex();
-    if (lexer.get_tokens()->count() < 2u) log_error("file is empty");
-    if (exit == FAILURE) return FAILURE;
+    enter_stage(options, &timer, Stage::lexer);
+    Lexer lexer          = Lexer(&file, 0, arenas.of(Stage::lexer));
+    exit                 = lex_file(options, &file, &lexer);
+    options->token_count = lexer.get_tokens()->count();
+    if (options->token_count < 2u) log_error("file is empty");
+    if (exit == FAILURE)
+    {
+        if (options->stats) log_stats(stdout, &file, &lexer, &arenas);
+        return FAILURE;
+    }
+
+    // the imported modules are read and lexed in parallel, still part of the lexer stage
+    ModuleGraph modules(options);
+    if (options->imports)
+    {
+        // a batch already keeps every cpu busy with its own files
+        uint workers = options->workers ? options->workers : hardware_threads();
+        if (options->batch()) workers = 1;
+        exit                  = modules.load_imports(&file, &lexer, workers);
+        options->modules      = (uint)modules.count();
+        options->token_count  = modules.tokens();
+        options->source_bytes = (uint)modules.bytes();
+        if (exit == FAILURE) return FAILURE;
+    }
     // parse lexed tokens to Abstract Syntax tree
 
     /*
@@ -47,15 +105,21 @@ compile(compile_options *options) noexcept
     if (options->debug_info)
     {
         // LOGS ONLY DURING SUCCESS OF THE PREVIOUS STAGES
-        options->st = Stage::logger;
-        if (FILE *output = fopen("output.org", "wb"))
+        enter_stage(options, &timer, Stage::logger);
+        if (FILE *output = fopen(options->log_path, "wb"))
         {
-            log_compilation(output, &file, &lexer);
+            if (log_compilation(output, &file, &lexer, options->log_format) == SUCCESS)
+                log_info("Logging complete");
             fclose(output);
         }
         else { log_error("Log failed"); }
     }
 
+    if (options->stats)
+    {
+        log_stats(stdout, &file, &lexer, &arenas);
+        if (modules.count() > 1) log_modules(stdout, &modules);
+    }
     return exit;
 }
 
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "../include/meta.hpp"
+
+namespace rotate
+{
+
+/*
+ *  Locale independent character classes
+ *  a 256 entry table replaces <ctype.h> in the lexer, and identifier/digit
+ *  runs are consumed 8 bytes at a time with SWAR (simd within a register)
+ */
+
+enum CharClass : u8
+{
+    CC_NONE    = 0,
+    CC_DIGIT   = 1 << 0, // [0-9]
+    CC_ALPHA   = 1 << 1, // [a-zA-Z]
+    CC_IDENT   = 1 << 2, // [0-9a-zA-Z_]
+    CC_HEX     = 1 << 3, // [0-9a-fA-F]
+    CC_SPACE   = 1 << 4, // ' '
+    CC_NEWLINE = 1 << 5, // '\n'
+};
+
+// what kind of token a byte starts, used by `lex_director`
+enum class CharStart : u8
+{
+    Symbol = 0, // punctuators, comments, EOF and invalid chars
+    Number,
+    Ident,
+    String,
+    Char,
+    Builtin,
+};
+
+namespace cc
+{
+
+constexpr bool
+in(const uint c, const char lo, const char hi)
+{
+    return c >= (uint)lo && c <= (uint)hi;
+}
+
+constexpr u8
+classify(const uint c)
+{
+    return (u8)((in(c, '0', '9') ? CC_DIGIT | CC_IDENT | CC_HEX : 0) |
+                (in(c, 'a', 'z') || in(c, 'A', 'Z') ? CC_ALPHA | CC_IDENT : 0) |
+                (in(c, 'a', 'f') || in(c, 'A', 'F') ? CC_HEX : 0) | (c == '_' ? CC_IDENT : 0) |
+                (c == ' ' ? CC_SPACE : 0) | (c == '\n' ? CC_NEWLINE : 0));
+}
+
+constexpr CharStart
+start(const uint c)
+{
+    return in(c, '0', '9')                                     ? CharStart::Number
+           : in(c, 'a', 'z') || in(c, 'A', 'Z') || c == '_' ? CharStart::Ident
+           : c == '"'                                          ? CharStart::String
+           : c == '\''                                         ? CharStart::Char
+           : c == '@'                                          ? CharStart::Builtin
+                                                               : CharStart::Symbol;
+}
+
+struct Table
+{
+    u8 cls[256];
+    CharStart start[256];
+};
+
+template <uint... Is>
+constexpr Table
+make_table(index_seq<Is...>)
+{
+    return Table{{classify(Is)...}, {start(Is)...}};
+}
+
+constexpr Table TABLE = make_table(make_index_seq<256>::type());
+
+// SWAR constants, one value per byte lane
+constexpr u64 ONES = 0x0101010101010101ull;
+constexpr u64 HIGH = 0x8080808080808080ull;
+constexpr u64 LOW7 = 0x7f7f7f7f7f7f7f7full;
+
+// high bit of each lane set where lo <= byte <= hi, `x` must have the high bits cleared
+constexpr u64
+swar_range(const u64 x, const u8 lo, const u8 hi)
+{
+    return (x + ONES * (u64)(0x80 - lo)) & ~(x + ONES * (u64)(0x7f - hi)) & HIGH;
+}
+
+constexpr u64
+swar_eq(const u64 x, const u8 c)
+{
+    return ~((((x ^ (ONES * c)) & LOW7) + LOW7) | (x ^ (ONES * c))) & HIGH;
+}
+
+} // namespace cc
+
+inline u8
+char_class(const char c)
+{
+    return cc::TABLE.cls[(u8)c];
+}
+
+inline bool
+char_is(const char c, const u8 cls)
+{
+    return (cc::TABLE.cls[(u8)c] & cls) != 0;
+}
+
+inline CharStart
+char_start(const char c)
+{
+    return cc::TABLE.start[(u8)c];
+}
+
+// high bit of each lane set where the byte is [0-9]
+inline u64
+swar_digits(const u64 w)
+{
+    return cc::swar_range(w & cc::LOW7, '0', '9') & ~w;
+}
+
+// high bit of each lane set where the byte is [0-9a-zA-Z_]
+inline u64
+swar_ident(const u64 w)
+{
+    const u64 x = w & cc::LOW7;
+    return (cc::swar_range(x, '0', '9') | cc::swar_range(x | (cc::ONES * 0x20), 'a', 'z') |
+            cc::swar_eq(x, '_')) &
+           ~w;
+}
+
+/*
+ *  run scanners: return the first position >= pos whose byte is not in the run
+ *  `readable` is the number of bytes that can be read from `src`,
+ *  the run must end before it (the source is NUL terminated)
+ */
+
+template <u64 (*lanes)(u64), u8 cls>
+inline uint
+scan_run(cstr src, uint pos, const uint readable)
+{
+    static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "SWAR runs assume little endian");
+    while (pos + sizeof(u64) <= readable)
+    {
+        u64 w;
+        memcpy(&w, src + pos, sizeof(u64));
+        const u64 stop = ~lanes(w) & cc::HIGH;
+        if (stop) return pos + ((uint)__builtin_ctzll(stop) >> 3);
+        pos += sizeof(u64);
+    }
+    while (char_is(src[pos], cls))
+        pos++;
+    return pos;
+}
+
+inline uint
+scan_ident_run(cstr src, const uint pos, const uint readable)
+{
+    return scan_run<swar_ident, CC_IDENT>(src, pos, readable);
+}
+
+inline uint
+scan_digit_run(cstr src, const uint pos, const uint readable)
+{
+    return scan_run<swar_digits, CC_DIGIT>(src, pos, readable);
+}
+
+// high bit of each lane set where the byte ends a string scan: '"', '\\' or NUL
+inline u64
+swar_string_stop(const u64 w)
+{
+    return cc::swar_eq(w, '"') | cc::swar_eq(w, '\\') | cc::swar_eq(w, '\0');
+}
+
+// first position >= pos holding '"', '\\' or NUL
+inline uint
+scan_string_run(cstr src, uint pos, const uint readable)
+{
+    while (pos + sizeof(u64) <= readable)
+    {
+        u64 w;
+        memcpy(&w, src + pos, sizeof(u64));
+        const u64 stop = swar_string_stop(w);
+        if (stop) return pos + ((uint)__builtin_ctzll(stop) >> 3);
+        pos += sizeof(u64);
+    }
+    while (src[pos] != '"' && src[pos] != '\\' && src[pos] != '\0')
+        pos++;
+    return pos;
+}
+
+} // namespace rotate
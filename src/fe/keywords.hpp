@@ -0,0 +1,198 @@
+#pragma once
+
+#include "../include/meta.hpp"
+#include "token.hpp"
+
+namespace rotate
+{
+
+/*
+ *  Keyword recognition
+ *  the table below is the single source of keywords, a collision free
+ *  (perfect) hash over (first byte, last byte, length) is searched for at
+ *  compile time and a lookup is one hash plus one 8 byte compare.
+ *  NOTE: adding a keyword only requires adding it to `KEYWORDS`, as long as it
+ *  is at most 7 bytes long: the compare packs the keyword and a length mask in
+ *  one u64, a longer keyword fails the static_assert below
+ */
+
+struct Keyword
+{
+    cstr name;
+    TknType type;
+};
+
+// every name is 1 to 7 bytes, see KEYWORD_MAX_LEN
+constexpr Keyword KEYWORDS[] = {
+    {"as", TknType::As},
+    {"fn", TknType::Function},
+    {"if", TknType::If},
+    {"in", TknType::In},
+    {"or", TknType::Or},
+    {"for", TknType::For},
+    {"pub", TknType::Public},
+    {"int", TknType::IntKeyword},
+    {"ref", TknType::Ref},
+    {"and", TknType::And},
+    {"nil", TknType::Nil},
+    {"else", TknType::Else},
+    {"enum", TknType::Enum},
+    {"true", TknType::True},
+    {"char", TknType::CharKeyword},
+    {"bool", TknType::BoolKeyword},
+    {"uint", TknType::UintKeyword},
+    {"void", TknType::Void},
+    {"while", TknType::While},
+    {"false", TknType::False},
+    {"float", TknType::FloatKeyword},
+    {"break", TknType::Break},
+    {"return", TknType::Return},
+    {"import", TknType::Import},
+    {"delete", TknType::Delete},
+    {"struct", TknType::Struct},
+    {"switch", TknType::Switch},
+};
+
+constexpr uint KEYWORDS_COUNT = sizeof(KEYWORDS) / sizeof(KEYWORDS[0]);
+
+struct KeywordSlot
+{
+    u64 word; // keyword bytes packed little endian, 0 for an empty slot
+    TknType type;
+};
+
+namespace kw
+{
+
+constexpr uint
+min_len(const uint i = 0, const uint m = 0xff)
+{
+    return i == KEYWORDS_COUNT ? m
+                               : min_len(i + 1, cstr_len(KEYWORDS[i].name) < m
+                                                    ? cstr_len(KEYWORDS[i].name)
+                                                    : m);
+}
+
+constexpr uint
+max_len(const uint i = 0, const uint m = 0)
+{
+    return i == KEYWORDS_COUNT ? m
+                               : max_len(i + 1, cstr_len(KEYWORDS[i].name) > m
+                                                    ? cstr_len(KEYWORDS[i].name)
+                                                    : m);
+}
+
+constexpr uint TABLE_SIZE = next_pow2(KEYWORDS_COUNT * 2);
+constexpr uint TABLE_BITS = log2_pow2(TABLE_SIZE);
+constexpr uint NO_SEED    = 0xffffffff;
+constexpr uint MAX_SEED   = 0x10000;
+
+constexpr uint
+hash(const uint seed, const u8 first, const u8 last, const uint len)
+{
+    return (uint)((((u64)first | (u64)last << 8 | (u64)len << 16) ^ seed) * 0x9E3779B97F4A7C15ull >>
+                  (64 - TABLE_BITS));
+}
+
+constexpr uint
+hash_of(const uint seed, const uint i)
+{
+    return hash(seed, (u8)KEYWORDS[i].name[0],
+                (u8)KEYWORDS[i].name[cstr_len(KEYWORDS[i].name) - 1],
+                cstr_len(KEYWORDS[i].name));
+}
+
+constexpr u64
+pack(cstr str, const uint len, const uint i = 0)
+{
+    return i == len ? 0 : ((u64)(u8)str[i] << (8 * i)) | pack(str, len, i + 1);
+}
+
+// true if no keyword after `j` shares the slot of keyword `i`
+constexpr bool
+unique_after(const uint seed, const uint i, const uint j)
+{
+    return j == KEYWORDS_COUNT ? true
+                               : hash_of(seed, i) != hash_of(seed, j) && unique_after(seed, i, j + 1);
+}
+
+constexpr bool
+is_perfect(const uint seed, const uint i = 0)
+{
+    return i == KEYWORDS_COUNT ? true
+                               : unique_after(seed, i, i + 1) && is_perfect(seed, i + 1);
+}
+
+// first perfect seed in [lo, hi), bisected to keep the recursion depth low
+constexpr uint
+first_seed(const uint lo, const uint hi);
+
+constexpr uint
+first_seed_or(const uint found, const uint mid, const uint hi)
+{
+    return found != NO_SEED ? found : first_seed(mid, hi);
+}
+
+constexpr uint
+first_seed(const uint lo, const uint hi)
+{
+    return hi - lo == 1 ? (is_perfect(lo) ? lo : NO_SEED)
+                        : first_seed_or(first_seed(lo, lo + (hi - lo) / 2), lo + (hi - lo) / 2, hi);
+}
+
+constexpr uint SEED = first_seed(0, MAX_SEED);
+
+constexpr KeywordSlot
+slot(const uint s, const uint i = 0)
+{
+    return i == KEYWORDS_COUNT ? KeywordSlot{0, TknType::Identifier}
+           : hash_of(SEED, i) == s
+               ? KeywordSlot{pack(KEYWORDS[i].name, cstr_len(KEYWORDS[i].name)), KEYWORDS[i].type}
+               : slot(s, i + 1);
+}
+
+struct Table
+{
+    KeywordSlot slots[TABLE_SIZE];
+};
+
+template <uint... Is>
+constexpr Table
+make_table(index_seq<Is...>)
+{
+    return Table{{slot(Is)...}};
+}
+
+constexpr Table TABLE = make_table(make_index_seq<TABLE_SIZE>::type());
+
+} // namespace kw
+
+constexpr uint KEYWORD_MIN_LEN = kw::min_len();
+constexpr uint KEYWORD_MAX_LEN = kw::max_len();
+
+static_assert(kw::SEED != kw::NO_SEED, "no perfect keyword hash found, increase kw::MAX_SEED");
+// the mask `(1 << 8 * len) - 1` of `keyword_lookup` needs len < 8
+static_assert(KEYWORD_MAX_LEN < sizeof(u64), "keywords are at most 7 bytes, see keyword_lookup");
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "keyword packing assumes little endian");
+
+// `readable` is the number of bytes that can be read starting at `str`
+inline TknType
+keyword_lookup(cstr str, const uint len, const uint readable) noexcept
+{
+    if (len < KEYWORD_MIN_LEN || len > KEYWORD_MAX_LEN) return TknType::Identifier;
+    const KeywordSlot &s = kw::TABLE.slots[kw::hash(kw::SEED, (u8)str[0], (u8)str[len - 1], len)];
+
+    u64 word = 0;
+    if (readable >= sizeof(u64)) { memcpy(&word, str, sizeof(u64)); }
+    else
+    {
+        for (uint i = 0; i < len; i++)
+            word |= (u64)(u8)str[i] << (8 * i);
+    }
+    word &= ((u64)1 << (8 * len)) - 1;
+
+    // NOTE: identifiers never contain a NUL byte so they can not match an empty slot
+    return s.word == word ? s.type : TknType::Identifier;
+}
+
+} // namespace rotate
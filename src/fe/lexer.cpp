@@ -1,40 +1,164 @@
 #include "lexer.hpp"
+#include "charclass.hpp"
+#include "keywords.hpp"
+
+#include "../include/log_writer.hpp"
 
 namespace rotate
 {
 
 // file must not be null and lexer owns the file ptr
-Lexer::Lexer(const file_t *_file)
+Lexer::Lexer(const file_t *_file, const usize token_capacity, Arena *arena) : arena(arena)
 {
     ASSERT_NULL(_file, "Lexer File passed is a null pointer");
     index       = 0;
     len         = 0;
-    line        = 1;
     file        = _file;
     file_length = _file->length;
     error       = LexErr::UNKNOWN;
-    tokens      = new Array<Token>(file->length >> 2);
-    ASSERT_NULL(tokens, "Lexer vec of tokens passed is a null pointer");
+    // NOTE: the stream is only allocated when lexing in batch, see `init_tokens`
+    this->token_capacity = token_capacity;
 }
 
 Lexer::~Lexer() noexcept
 {
     delete tokens;
+    delete lines;
+    delete own_literals;
+    delete own_symbols;
+    delete own_strings;
+    free(ring);
+}
+
+// tokens expected in `bytes` of source, with 1/8 headroom for denser parts
+usize
+Lexer::expected_tokens(const uint bytes, const f64 density)
+{
+    return (usize)((f64)bytes * density * 1.125) + EXTRA_NULL_TERMINATORS;
+}
+
+// lexes the start of the file with a silent streaming lexer and counts its tokens
+f64
+Lexer::sample_density()
+{
+    if (density > 0) return density;
+    const uint limit = file_length < TKN_DENSITY_SAMPLE ? file_length : TKN_DENSITY_SAMPLE;
+    Lexer sample(file, TKN_MIN_CAPACITY);
+    sample.silent = true;
+    usize count   = 0;
+    Token tkn     = sample.next_token();
+    for (; tkn.type != TknType::EOT && tkn.index < limit; tkn = sample.next_token())
+        count++;
+
+    // a lexing error ends the sample where it happened
+    const uint scanned = tkn.type == TknType::EOT && !sample.failed() ? file_length : tkn.index;
+    density            = scanned && count ? (f64)count / (f64)scanned : TKN_DEFAULT_DENSITY;
+    return density;
+}
+
+void
+Lexer::init_tokens()
+{
+    if (tokens) return;
+    if (!token_capacity) token_capacity = expected_tokens(file_length, sample_density());
+    tokens = new TokenStream(file->contents, token_capacity, arena);
+    ASSERT_NULL(tokens, "Lexer vec of tokens passed is a null pointer");
+    literals = tokens->literals();
+    symbols  = tokens->symbols();
+    strings  = tokens->strings();
+}
+
+const LineIndex *
+Lexer::get_lines()
+{
+    // built on demand, only diagnostics and logs need lines
+    if (!lines) lines = new LineIndex(file->contents, file_length);
+    return lines;
 }
 
+uint
+Lexer::get_num_of_lines()
+{
+    return get_lines()->count();
+}
+
+// same lines as `log_token`, through one buffer instead of a fprintf per token
 void
 Lexer::save_log(FILE *output)
 {
+    LogWriter out(output);
+    cstr source = tokens->source();
     for (uint i = 0; i < tokens->count(); i++)
     {
-        log_token(output, tokens->at(i), file->contents);
+        const uint offset = tokens->offset(i), length = tokens->length(i);
+        out.put("[TOKEN]: idx: ");
+        out.put_uint(offset);
+        out.put(", len: ");
+        out.put_uint(length);
+        out.put(", type: ");
+        out.put(tkn_type_describe(tokens->type(i)));
+        out.put(", val: `");
+        out.put(source + offset, length);
+        out.put("`\n");
     }
+    if (out.flush() != SUCCESS) log_error("Log write failed");
+}
+
+u8
+Lexer::lex_cached(const TokenCacheHit *hit)
+{
+    if (!token_capacity) token_capacity = hit->tokens;
+    init_tokens();
+    cached = tokens->read_image(hit->image, hit->bytes, file->length);
+    return cached ? SUCCESS : FAILURE;
 }
 
 u8
 Lexer::lex()
 {
-    for (;;)
+    init_tokens();
+    while (fill(0))
+    {
+        const Token tkn = next_token();
+        tokens->push(tkn.type, tkn.index, tkn.length, tkn.payload);
+    }
+    return stream_state == DONE ? SUCCESS : FAILURE;
+}
+
+/*
+ *  Streaming
+ *  `fill` runs the director until k + 1 tokens wait in the ring, a single
+ *  director call may emit several tokens (a run of newlines), so the ring
+ *  grows past TKN_LOOKAHEAD when needed
+ */
+
+void
+Lexer::ring_push(const Token tkn)
+{
+    if (ring_count == ring_capacity)
+    {
+        const uint capacity = ring_capacity ? ring_capacity * 2 : TKN_LOOKAHEAD;
+        Token *bigger       = static_cast<Token *>(malloc(sizeof(Token) * capacity));
+        ASSERT_NULL(bigger, "Lexer token ring allocation failure");
+        for (uint i = 0; i < ring_count; i++)
+            bigger[i] = ring[(ring_head + i) & (ring_capacity - 1)];
+        free(ring);
+        ring          = bigger;
+        ring_head     = 0;
+        ring_capacity = capacity;
+    }
+    ring[(ring_head + ring_count) & (ring_capacity - 1)] = tkn;
+    ring_count++;
+}
+
+bool
+Lexer::fill(const uint k)
+{
+    streaming = true;
+    if (!literals) literals = own_literals = new LiteralPool();
+    if (!symbols) symbols = own_symbols = new SymbolTable();
+    if (!strings) strings = own_strings = new StringPool();
+    while (ring_count <= k && stream_state == SUCCESS)
     {
         switch (lex_director())
         {
@@ -43,14 +167,20 @@ Lexer::lex()
                 len = 0;
                 for (u8 i = 0; i < EXTRA_NULL_TERMINATORS; ++i)
                     add_token(TknType::EOT);
-                return SUCCESS;
+                stream_state = DONE;
+                break;
+            }
+            case FAILURE: {
+                if (!silent) report_error();
+                stream_state = FAILURE;
+                break;
             }
-            case FAILURE: return report_error();
         }
     }
-    return FAILURE;
+    return ring_count > k;
 }
 
+
 inline void
 Lexer::skip_whitespace() noexcept
 {
@@ -60,9 +190,9 @@ Lexer::skip_whitespace() noexcept
         if (c == ' ') { index++; }
         else if (c == '\n')
         {
+            // NOTE: add_token advances by `len`, it must not be the length of the previous token
+            len = 1;
             add_token(TknType::Terminator);
-            index++;
-            line++;
         }
         else { break; }
     }
@@ -72,25 +202,25 @@ u8
 Lexer::lex_director()
 {
     skip_whitespace();
-    len = 0, begin_tok_line = line;
+    len = 0;
     save_state();
-    const char c = current();
-    // ints and floats
-    if (isdigit(c)) return lex_numbers();
-
-    // chars, and strings
-    // TODO: Multiline string
-    if (c == '\'') return lex_chars();
-    if (c == '"') return lex_strings();
-
-    // NOTE: Idenitifiers, keywords and builtin functions
-    if (c == '_' || isalpha(c)) return lex_identifiers();
-    if (c == '@') return lex_builtin_funcs();
-    // Symbols
+    switch (char_start(current()))
+    {
+        // ints and floats
+        case CharStart::Number: return lex_numbers();
+        // chars, and strings
+        case CharStart::Char: return lex_chars();
+        case CharStart::String: return lex_strings();
+        // NOTE: Idenitifiers, keywords and builtin functions
+        case CharStart::Ident: return lex_identifiers();
+        case CharStart::Builtin: return lex_builtin_funcs();
+        // Symbols
+        case CharStart::Symbol: break;
+    }
     return lex_symbols();
 }
 
-Array<Token> *
+TokenStream *
 Lexer::get_tokens() const
 {
     return tokens;
@@ -99,135 +229,10 @@ Lexer::get_tokens() const
 u8
 Lexer::lex_identifiers()
 {
-    advance_len_inc();
-    while (isalnum(current()) || current() == '_')
-    {
-        advance_len_inc();
-    }
-    index -= len;
-    TknType _type = TknType::Identifier;
-
-    // TODO: optimize searching for matching keywords
-    switch (len)
-    {
-        case 2: {
-            switch (current())
-            {
-                case 'a':
-                    if (keyword_match("as", 2)) _type = TknType::As;
-                    break;
-                case 'f':
-                    if (keyword_match("fn", 2)) _type = TknType::Function;
-                    break;
-                case 'i':
-                    if (keyword_match("if", 2))
-                        _type = TknType::If;
-                    else if (keyword_match("in", 2))
-                        _type = TknType::In;
-                    break;
-                case 'o':
-                    if (keyword_match("or", 2)) _type = TknType::Or;
-                    break;
-                default: break;
-            }
-
-            break;
-        }
-        case 3: {
-            switch (current())
-            {
-                case 'f':
-                    if (keyword_match("for", 3)) _type = TknType::For;
-                    break;
-                case 'p':
-                    if (keyword_match("pub", 3)) _type = TknType::Public;
-                    break;
-                case 'i':
-                    if (keyword_match("int", 3)) _type = TknType::IntKeyword;
-                    break;
-                case 'r':
-                    if (keyword_match("ref", 3)) _type = TknType::Ref;
-                    break;
-                case 'a':
-                    if (keyword_match("and", 3)) _type = TknType::And;
-                    break;
-                case 'n':
-                    if (keyword_match("nil", 3)) _type = TknType::Nil;
-                    break;
-            }
-            break;
-        }
-        case 4: {
-            switch (current())
-            {
-                case 'e': {
-                    if (keyword_match("else", 4))
-                        _type = TknType::Else;
-                    else if (keyword_match("enum", 4))
-                        _type = TknType::Enum;
-                    break;
-                }
-                case 't':
-                    if (keyword_match("true", 4)) _type = TknType::True;
-                    break;
-                case 'c':
-                    if (keyword_match("char", 4)) _type = TknType::CharKeyword;
-                    break;
-                case 'b':
-                    if (keyword_match("bool", 4)) _type = TknType::BoolKeyword;
-                    break;
-                case 'u':
-                    if (keyword_match("uint", 4)) _type = TknType::UintKeyword;
-                    break;
-                case 'v':
-                    if (keyword_match("void", 4)) _type = TknType::Void;
-                    break;
-            }
-            break;
-        }
-        case 5: {
-            switch (current())
-            {
-                case 'w':
-                    if (keyword_match("while", 5)) _type = TknType::While;
-                    break;
-                case 'f': {
-                    if (keyword_match("false", 5))
-                        _type = TknType::False;
-                    else if (keyword_match("float", 5))
-                        _type = TknType::FloatKeyword;
-                    break;
-                }
-                case 'b':
-                    if (keyword_match("break", 5)) _type = TknType::Break;
-                    break;
-            }
-            break;
-        }
-        case 6: {
-            switch (current())
-            {
-                case 'r':
-                    if (keyword_match("return", 6)) _type = TknType::Return;
-                    break;
-                case 'i':
-                    if (keyword_match("import", 6)) _type = TknType::Import;
-                    break;
-                case 'd':
-                    if (keyword_match("delete", 6)) _type = TknType::Delete;
-                    break;
-                case 's': {
-                    if (keyword_match("struct", 6))
-                        _type = TknType::Struct;
-                    else if (keyword_match("switch", 6))
-                        _type = TknType::Switch;
-                    break;
-                }
-            }
-            break;
-        }
-        default: break;
-    }
+    // the identifier is hashed while its end is searched
+    u64 hash            = 0;
+    len                 = scan_ident_hashed(file->contents, index, readable(), &hash) - index;
+    const TknType _type = identifier_type();
 
     if (len > 100)
     {
@@ -237,7 +242,15 @@ Lexer::lex_identifiers()
         return FAILURE;
     }
 
-    return add_token(_type);
+    if (_type != TknType::Identifier) return add_token(_type);
+    return add_token(_type, symbols->intern(file->contents + index, len, hash));
+}
+
+TknType
+Lexer::identifier_type()
+{
+    // NOTE: index is at the beginning of the identifier and len is its length
+    return keyword_lookup(file->contents + index, len, readable() - index);
 }
 
 u8
@@ -258,15 +271,17 @@ Lexer::lex_numbers()
         }
     }
 
+    // digits with at most one dot, the digit runs are consumed a word at a time;
+    // a dot is only taken before a digit, `0..2` is Integer To Integer
     bool reached_dot = false;
-    while (isdigit(current()) || current() == '.')
+    for (;;)
     {
+        const uint end = scan_digit_run(file->contents, index, readable());
+        len += end - index;
+        index = end;
+        if (current() != '.' || reached_dot || !char_is(peek(), CC_DIGIT)) break;
+        reached_dot = true;
         advance_len_inc();
-        if (current() == '.')
-        {
-            if (reached_dot) break;
-            reached_dot = true;
-        }
     }
 
     if (len > 100)
@@ -276,7 +291,7 @@ Lexer::lex_numbers()
         return FAILURE;
     }
     index -= len;
-    return add_token(reached_dot ? TknType::Integer : TknType::Float);
+    return add_literal(reached_dot ? TknType::Float : TknType::Integer);
 }
 
 u8
@@ -285,7 +300,7 @@ Lexer::lex_hex_numbers()
     // skip '0x'
     advance_len_inc();
     advance_len_inc();
-    while (isxdigit(current()))
+    while (char_is(current(), CC_HEX))
     {
         advance_len_inc();
     }
@@ -297,7 +312,7 @@ Lexer::lex_hex_numbers()
         return FAILURE;
     }
     index -= len;
-    return add_token(TknType::Integer);
+    return add_literal(TknType::Integer);
 }
 
 u8
@@ -318,36 +333,74 @@ Lexer::lex_binary_numbers()
         return FAILURE;
     }
     index -= len;
-    return add_token(TknType::Integer);
+    return add_literal(TknType::Integer);
+}
+
+/*
+ *  strings: "..." and """...""" (multi-line, may hold unescaped quotes)
+ *  the body is searched for the next quote or backslash a word at a time
+ *  (or with the stage 1 masks in the simd engine), an escape skips the byte
+ *  after its backslash so `"\\"` ends at the second quote
+ */
+
+// first position >= pos holding '"', '\\' or NUL
+inline uint
+Lexer::next_string_stop(const uint pos)
+{
+    if (structural) return structural->next_set(&BlockMasks::quote, pos);
+    return scan_string_run(file->contents, pos, readable());
 }
 
 u8
 Lexer::lex_strings()
 {
-    advance_len_inc();
+    if (peek() == '"' && file->contents[index + 2] == '"') return lex_multiline_strings();
+    return lex_string_body(1);
+}
+
+u8
+Lexer::lex_multiline_strings()
+{
+    return lex_string_body(3);
+}
+
+u8
+Lexer::lex_string_body(const uint quotes)
+{
+    cstr const src   = file->contents;
+    const uint start = index;
+    uint pos         = index + quotes;
+    bool escaped     = false;
     for (;;)
     {
-        if (current() == '\0')
+        pos = next_string_stop(pos);
+        if (src[pos] == '\\')
+        {
+            // the same escapes as in chars, a trailing backslash is an unclosed string
+            if (src[pos + 1] != '\0' && !valid_escape(src[pos + 1]))
+            {
+                len = pos + 2 - start;
+                restore_state_for_err();
+                error = LexErr::NOT_VALID_ESCAPE_CHAR;
+                return FAILURE;
+            }
+            escaped = true;
+            pos += src[pos + 1] != '\0' ? 2 : 1;
+            continue;
+        }
+        if (src[pos] == '\0')
         {
+            len = pos - start;
             restore_state_for_err();
             error = LexErr::NOT_CLOSED_STRING;
             return FAILURE;
         }
-
-        if (current() == '"')
-        {
-            if (past() == '\\')
-            {
-                advance_len_inc();
-                continue;
-            }
-            else
-                break;
-        }
-        advance_len_inc();
+        if (quotes == 1 || (src[pos + 1] == '"' && src[pos + 2] == '"')) break;
+        pos++;
     }
-    advance_len_inc();
+    pos += quotes;
 
+    len = pos - start;
     if (len > (UINT_MAX / 2))
     {
         restore_state_for_err();
@@ -355,8 +408,10 @@ Lexer::lex_strings()
         error = LexErr::TOO_LONG_STRING;
         return FAILURE;
     }
-    index -= len;
-    return add_token(TknType::String);
+    // strings without escapes stay views into the source
+    if (!escaped) return add_token(TknType::String, STRING_VIEW);
+    const u32 id = strings->add_escaped(src + start + quotes, len - 2 * quotes);
+    return add_token(TknType::String, id);
 }
 
 u8
@@ -368,30 +423,23 @@ Lexer::lex_chars()
         advance_len_inc();
         advance_len_inc();
         index -= len;
-        return add_token(TknType::Char);
+        return add_literal(TknType::Char);
     }
     else if (current() == '\\')
     {
         advance_len_inc();
-        switch (current())
+        if (!valid_escape(current()))
         {
-            case 'n':
-            case 't':
-            case 'r':
-            case 'b':
-            case 'f':
-            case '\\':
-            case '\'': advance_len_inc(); break;
-            default:
-                error = LexErr::NOT_VALID_ESCAPE_CHAR;
-                restore_state_for_err();
-                return FAILURE;
+            error = LexErr::NOT_VALID_ESCAPE_CHAR;
+            restore_state_for_err();
+            return FAILURE;
         }
+        advance_len_inc();
         if (current() == '\'')
         {
             advance_len_inc();
             index -= len;
-            return add_token(TknType::Char);
+            return add_literal(TknType::Char);
         }
         else
         {
@@ -530,21 +578,10 @@ Lexer::lex_symbols()
             return SUCCESS;
         }
         default: {
-            switch (c)
-            {
-                case '\0': return DONE;
-                case '\t': {
-                    this->error = LexErr::TABS;
-                    break;
-                }
-                case '\r': {
-                    advance();
-                    return SUCCESS;
-                }
-                default: {
-                    this->error = LexErr::LEXER_INVALID_CHAR;
-                }
-            }
+            // NOTE: file_read rejects tabs, '\r' and NUL in the source,
+            // a NUL here is the first terminator
+            if (c == '\0') return DONE;
+            this->error = LexErr::LEXER_INVALID_CHAR;
         }
     }
     return FAILURE;
@@ -556,7 +593,7 @@ Lexer::lex_builtin_funcs()
     advance(); // skip '@'
 
     // NOTE(5717): ONLY ALPHABET CHARS ARE ALLOWED
-    while (isalpha(current()))
+    while (char_is(current(), CC_ALPHA))
     {
         advance_len_inc();
     }
@@ -568,9 +605,7 @@ Lexer::lex_builtin_funcs()
 inline void
 Lexer::advance()
 {
-    const char c = current();
     index++;
-    line += (c == '\n');
 }
 
 inline void
@@ -582,75 +617,34 @@ Lexer::advance_len_times()
 inline void
 Lexer::advance_len_inc()
 {
-    const char c = current();
     index++;
     len++;
-    line += (c == '\n');
-}
-
-inline char
-Lexer::peek() const
-{
-    return file->contents[index + 1];
-}
-
-inline char
-Lexer::current() const
-{
-    return file->contents[index];
-}
-
-inline char
-Lexer::past() const
-{
-    return file->contents[index - 1];
-}
-
-inline bool
-Lexer::is_not_eof() const
-{
-    return index < file_length;
-}
-
-inline bool
-Lexer::keyword_match(const char *string, uint length)
-{
-    return strncmp(file->contents + index, string, length) == 0;
 }
 
 void
 Lexer::save_state()
 {
     save_index = index;
-    save_line  = line;
 }
 
 void
 Lexer::restore_state_for_err()
 {
     index = save_index;
-    line  = save_line;
 }
 
 u8
 Lexer::report_error()
 {
-    //
-    uint low = index, col = 0;
-    while (file->contents[low] != '\n' && low > 0)
-    {
-        low--;
-        col++;
-    }
-    low = low > 1 ? low + 1 : 0;
-
-    //
-    uint _length = index;
-    while (file->contents[_length] != '\n' && _length + 1 < file->length)
-        _length++;
-
-    _length -= low;
-
+    // line and column are looked up only when an error is reported
+    const LineIndex *lines = get_lines();
+    const uint line        = lines->line_of(index);
+    const uint low         = lines->line_start(line);
+    const uint col         = index - low + 1;
+    const uint _length     = lines->line_end(line) - low;
+
+    // NOTE: kept in one piece when several files are compiled at once
+    flockfile(stderr);
     // error msg
     fprintf(stderr, " > %s%s%s:%u:%u: %serror: %s%s%s\n", BOLD, WHITE, file->name, line, col, LRED,
             LBLUE, lexer_err_msg(error), RESET);
@@ -680,18 +674,48 @@ Lexer::report_error()
     }
     // error lexer_err_advice
     fprintf(stderr, " > Advice: %s%s\n", RESET, lexer_err_advice(error));
+    funlockfile(stderr);
     return FAILURE;
 }
 
 u8
-Lexer::add_token(const TknType type)
+Lexer::add_token(const TknType type, const u32 payload)
 {
-    // index at the end of the token
-    // NOTE(Airbus5717): emplace_back constructs the token in the vector
-    auto tkn = Token(index, len, begin_tok_line, type);
-    tokens->append(tkn);
+    // index at the beginning of the token
+    if (streaming) { ring_push(Token(index, len, type, payload)); }
+    else { tokens->push(type, index, len, payload); }
     advance_len_times(); // TODO: Test optimization
     return SUCCESS;
 }
 
+u8
+Lexer::add_literal(const TknType type)
+{
+    // index at the beginning of the literal, its bytes are still in cache
+    cstr text   = file->contents + index;
+    u32 payload = 0;
+    switch (type)
+    {
+        case TknType::Float: payload = literals->add_float(parse_float(text, len)); break;
+        case TknType::Char: payload = literals->add_char(decode_char(text, len)); break;
+        default: {
+            u64 value = 0;
+            bool fits = false;
+            const char prefix = len > 1 && text[0] == '0' ? text[1] : '\0';
+            if (prefix == 'x') { fits = parse_hex(text + 2, len - 2, &value); }
+            else if (prefix == 'b') { fits = parse_binary(text + 2, len - 2, &value); }
+            else { fits = parse_decimal(text, len, &value); }
+
+            if (!fits)
+            {
+                error = LexErr::NUMBER_OUT_OF_RANGE;
+                restore_state_for_err();
+                return FAILURE;
+            }
+            payload = literals->add_integer(value);
+        }
+    }
+    return add_token(type, payload);
+}
+
 } // namespace rotate
@@ -1,18 +1,55 @@
 #pragma once
 
-#include "token.hpp"
+#include "lines.hpp"
+#include "simd.hpp"
+#include "token_cache.hpp"
+#include "token_stream.hpp"
 
 namespace rotate
 {
 
+constexpr uint TKN_LOOKAHEAD       = 16; // initial ring capacity of the streaming lexer, power of 2
+constexpr uint TKN_DENSITY_SAMPLE  = 16 * 1024; // bytes lexed up front to size the token stream
+constexpr f64 TKN_DEFAULT_DENSITY = 0.25;       // tokens per byte when the sample tells nothing
+
+// an edit of the source: bytes [start, old_end) were replaced by [start, new_end)
+struct TextEdit
+{
+    uint start, old_end, new_end;
+};
+
 class Lexer
 {
     // lexer state variables
-    uint index, len, line, begin_tok_line, file_length;
+    uint index, len, file_length;
     const file_t *file; // not owned by the lexer
     LexErr error    = LexErr::UNKNOWN;
-    uint save_index = 0, save_line = 0;
-    Array<Token> *tokens;
+    uint save_index = 0;
+    usize token_capacity;   // 0 until estimated from the density, see `init_tokens`
+    f64 density  = 0;       // tokens per byte of the first TKN_DENSITY_SAMPLE bytes
+    bool silent  = false;   // errors are not reported (density samples)
+    bool cached  = false;   // the tokens were loaded from a TokenCache
+    Arena *arena = nullptr; // storage of the token stream, not owned by the lexer
+    LiteralPool *literals       = nullptr; // the stream's pool, or `own_literals` when streaming
+    LiteralPool *own_literals   = nullptr;
+    SymbolTable *symbols        = nullptr; // the stream's table, or `own_symbols` when streaming
+    SymbolTable *own_symbols    = nullptr;
+    StringPool *strings         = nullptr; // the stream's pool, or `own_strings` when streaming
+    StringPool *own_strings     = nullptr;
+    TokenStream *tokens         = nullptr; // only allocated by the batch entry points
+    LineIndex *lines            = nullptr; // built on demand
+    StructuralIndex *structural = nullptr; // only alive during `lex_simd`
+
+    // streaming state, tokens wait in a ring until `next_token` takes them
+    Token *ring        = nullptr;
+    uint ring_capacity = 0, ring_head = 0, ring_count = 0;
+    u8 stream_state    = SUCCESS; // DONE or FAILURE once the lexer stopped
+    bool streaming     = false;
+    bool fill(const uint k);
+    void ring_push(const Token);
+    void init_tokens();
+    f64 sample_density();
+    static usize expected_tokens(const uint bytes, const f64 density);
 
     //
     u8 lex_director();
@@ -20,11 +57,32 @@ class Lexer
     u8 lex_numbers();
     u8 lex_strings();
     u8 lex_multiline_strings();
+    u8 lex_string_body(const uint quotes);
+    uint next_string_stop(const uint pos);
     u8 lex_binary_numbers();
     u8 lex_hex_numbers();
     u8 lex_symbols();
     u8 lex_builtin_funcs();
     u8 lex_identifiers();
+    TknType identifier_type();
+
+    // simd engine (stage 2), see lexer_simd.cpp
+    u8 lex_director_simd();
+    u8 lex_identifiers_simd();
+    u8 lex_comments_simd();
+
+    // parallel lexing of chunks, see lexer_parallel.cpp
+    struct ChunkEnd
+    {
+        u8 status;        // SUCCESS: stopped at `stop`, DONE: reached EOF, FAILURE: lexing error
+        TknIdx stop;      // first token at or after the chunk end, or the resync token
+        TknIdx resync_at; // index of `stop` in the resync stream, UINT_MAX if none
+    };
+    struct ChunkJob;
+    static void run_chunk(void *job);
+    // tokens at or after `resync_from` are looked up in `resync` moved back by `shift`
+    ChunkEnd lex_chunk(const uint begin, const uint end, const bool simd, const TokenStream *resync,
+                       const uint resync_from = 0, const s64 shift = 0);
 
     //
     u8 report_error();
@@ -32,7 +90,8 @@ class Lexer
     void restore_state_for_err();
 
     //
-    u8 add_token(const TknType);
+    u8 add_token(const TknType, const u32 payload = 0);
+    u8 add_literal(const TknType); // decodes the literal at [index, index + len)
 
     //
     void advance();
@@ -42,19 +101,93 @@ class Lexer
     char past() const;
     char current() const;
     bool is_not_eof() const;
+    uint readable() const;
     void skip_whitespace() noexcept;
-    bool keyword_match(cstr, uint);
 
     public:
     //
-    Lexer(const file_t *);
+    Lexer(const file_t *, const usize token_capacity = 0, Arena *arena = nullptr);
     ~Lexer() noexcept;
-    Array<Token> *get_tokens() const;
+    TokenStream *get_tokens() const;
+    const LineIndex *get_lines();
     uint get_num_of_lines();
     u8 lex();
+    u8 lex_simd();
+    u8 lex_parallel(const uint jobs, const bool simd);
+    // the tokens of a cache hit instead of lexing, FAILURE if its image is malformed
+    u8 lex_cached(const TokenCacheHit *hit);
+    bool from_cache() const { return cached; }
+    // no error is printed, the status alone tells a failure
+    void set_silent(const bool quiet) { silent = quiet; }
+
+    // streaming (pull) interface, tokens are lexed on demand and are never
+    // stored in the TokenStream; EOT is returned forever once the lexer stopped
+    Token next_token();
+    Token peek_token(const uint k); // k tokens ahead of `next_token`
+    bool failed() const { return stream_state == FAILURE; }
+    usize get_token_capacity() const { return token_capacity; }
+    f64 get_density() const { return density; }
+    const LiteralPool *get_literals() const { return literals; }
+    const SymbolTable *get_symbols() const { return symbols; }
+    const StringPool *get_strings() const { return strings; }
+
+    // incremental lexing, the lexer's file is the edited source and `previous`
+    // the lexer of the source before `edit`, see lexer_incremental.cpp; on SUCCESS
+    // its tokens are taken and edited in place, on FAILURE `previous` is untouched
+    u8 relex(Lexer *previous, const TextEdit edit);
     void save_log(FILE *);
 }; // class Lexer
 
-void log_token(FILE *, const Token, cstr);
+// NOTE: shared by the scalar and simd engines
+inline char
+Lexer::peek() const
+{
+    return file->contents[index + 1];
+}
+
+inline char
+Lexer::current() const
+{
+    return file->contents[index];
+}
+
+inline char
+Lexer::past() const
+{
+    return file->contents[index - 1];
+}
+
+inline bool
+Lexer::is_not_eof() const
+{
+    return index < file_length;
+}
+
+// NOTE: the ring is only refilled when it runs dry, the common path stays inline
+inline Token
+Lexer::next_token()
+{
+    if (ring_count == 0 && !fill(0)) return Token(index, 0, TknType::EOT);
+    const Token tkn = ring[ring_head];
+    ring_head       = (ring_head + 1) & (ring_capacity - 1);
+    ring_count--;
+    return tkn;
+}
+
+inline Token
+Lexer::peek_token(const uint k)
+{
+    if (ring_count <= k && !fill(k)) return Token(index, 0, TknType::EOT);
+    return ring[(ring_head + k) & (ring_capacity - 1)];
+}
+
+// number of bytes of `contents` that are safe to read, including the NUL padding
+inline uint
+Lexer::readable() const
+{
+    return file_length + EXTRA_NULL_TERMINATORS;
+}
+
+void log_token(FILE *, const TokenStream *, const TknIdx);
 
 } // namespace rotate
@@ -0,0 +1,64 @@
+#include "lexer.hpp"
+
+namespace rotate
+{
+
+/*
+ *  Incremental lexing of an edited source
+ *  - restart: the lexer state only depends on the position, so lexing can
+ *    resume after any token that (with the byte after it, read as lookahead)
+ *    lies before the edit
+ *  - resync: once a new token past the edit matches an old token moved by
+ *    the size difference of the edit, every following token matches as well
+ *  - splice: the old stream is edited in place, the tokens between the
+ *    restart and the resync point are replaced by the re-lexed ones and the
+ *    offsets after them are moved (see TokenStream::splice)
+ *  the lexing work scales with the edit (and the tokens it disturbs), the
+ *  splice moves the tails of the arrays once, the pools are never rebuilt
+ */
+
+u8
+Lexer::relex(Lexer *previous, const TextEdit edit)
+{
+    ASSERT_NULL(previous, "Lexer previous lexer is a null pointer");
+    ASSERT_NULL(previous->tokens, "Lexer previous tokens is a null pointer");
+    ASSERT(edit.start <= edit.old_end && edit.start <= edit.new_end &&
+               edit.new_end <= file_length,
+           "Lexer invalid edit range");
+    TokenStream *old = previous->tokens;
+    const s64 shift  = (s64)edit.new_end - (s64)edit.old_end;
+
+    // last old token that ends before the edit
+    TknIdx restart = old->find(edit.start);
+    while (restart > 0 && old->offset(restart - 1) + old->length(restart - 1) >= edit.start)
+        restart--;
+    const uint begin = restart > 0 ? old->offset(restart - 1) + old->length(restart - 1) : 0;
+
+    Lexer *fresh        = new Lexer(file, TKN_MIN_CAPACITY);
+    const ChunkEnd at   = fresh->lex_chunk(begin, UINT_MAX, false, old, edit.new_end, shift);
+    const bool resynced = at.status == SUCCESS && at.resync_at != UINT_MAX;
+    if (at.status == FAILURE)
+    {
+        delete fresh;
+        // the serial run reports the error with the exact lexer state
+        return lex();
+    }
+
+    // the stream changes hands and is edited in place
+    previous->tokens   = nullptr;
+    previous->literals = nullptr;
+    previous->symbols  = nullptr;
+    previous->strings  = nullptr;
+    delete tokens;
+    tokens = old;
+    tokens->splice(file->contents, restart, resynced ? at.resync_at : (TknIdx)old->count(),
+                   fresh->tokens, resynced ? at.stop : (TknIdx)fresh->tokens->count(), shift);
+    literals       = tokens->literals();
+    symbols        = tokens->symbols();
+    strings        = tokens->strings();
+    token_capacity = tokens->count();
+    delete fresh;
+    return SUCCESS;
+}
+
+} // namespace rotate
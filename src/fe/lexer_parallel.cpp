@@ -0,0 +1,211 @@
+#include "lexer.hpp"
+
+#include "../include/timer.hpp"
+
+namespace rotate
+{
+
+/*
+ *  Parallel lexing of a single file
+ *  - the file is split after newlines into one chunk per job, every chunk is
+ *    lexed speculatively (as if it started in the normal state) on a thread
+ *  - a chunk run continues past its end until it emits a token at or after
+ *    it, that token is where the next chunk has to pick up
+ *  - resolution (serial): the next chunk is accepted from the token matching
+ *    that position, if there is none (the chunk starts inside a string or a
+ *    block comment) it is re-lexed from the real position until it meets a
+ *    token of the speculative run again
+ *  - the accepted token ranges are stitched together with prefix sums
+ *  the lexer state only depends on the position, so two runs that emit the
+ *  same token produce the same tokens after it
+ */
+
+constexpr uint PARALLEL_MIN_CHUNK = 64 * 1024; // smaller chunks are not worth a thread
+
+struct Lexer::ChunkJob
+{
+    Lexer *lexer;
+    uint begin, end;
+    bool simd;
+    ChunkEnd result;
+};
+
+void
+Lexer::run_chunk(void *ptr)
+{
+    ChunkJob *job = static_cast<ChunkJob *>(ptr);
+    TimeScope scope("lex chunk", "lexer");
+    job->result = job->lexer->lex_chunk(job->begin, job->end, job->simd, nullptr);
+}
+
+// token i of `a` is token j of `b` moved by `shift` bytes
+static bool
+same_token(const TokenStream *a, const TknIdx i, const TokenStream *b, const TknIdx j,
+           const s64 shift = 0)
+{
+    return j < b->count() && (s64)a->offset(i) == (s64)b->offset(j) + shift &&
+           a->type(i) == b->type(j) && a->length(i) == b->length(j);
+}
+
+Lexer::ChunkEnd
+Lexer::lex_chunk(const uint begin, const uint end, const bool simd, const TokenStream *resync,
+                 const uint resync_from, const s64 shift)
+{
+    init_tokens();
+    ChunkEnd result = {FAILURE, 0, UINT_MAX};
+    StructuralIndex *si =
+        simd ? new StructuralIndex(file->contents, file_length, simd_detect()) : nullptr;
+    structural = si;
+    index      = begin;
+
+    TknIdx checked = 0;
+    for (;;)
+    {
+        const u8 status = simd ? lex_director_simd() : lex_director();
+        if (status == FAILURE) break;
+        if (status == DONE)
+        {
+            len = 0;
+            for (u8 i = 0; i < EXTRA_NULL_TERMINATORS; ++i)
+                add_token(TknType::EOT);
+            result.status = DONE;
+            break;
+        }
+
+        for (; checked < tokens->count(); checked++)
+        {
+            if (tokens->offset(checked) >= end) break;
+            if (resync && tokens->offset(checked) >= resync_from)
+            {
+                const TknIdx j = resync->find((uint)((s64)tokens->offset(checked) - shift));
+                if (same_token(tokens, checked, resync, j, shift))
+                {
+                    result.resync_at = j;
+                    break;
+                }
+            }
+        }
+        if (checked < tokens->count())
+        {
+            result.status = SUCCESS;
+            result.stop   = checked;
+            break;
+        }
+    }
+
+    structural = nullptr;
+    delete si;
+    return result;
+}
+
+// appends tokens [first, last) of `ts`, `resume` is moved after the last one
+static void
+accept(Array<TokenRange> *ranges, uint *resume, const TokenStream *ts, const TknIdx first,
+       const TknIdx last)
+{
+    if (last <= first) return;
+    ranges->append(TokenRange{ts, first, last, 0});
+    *resume = ts->offset(last - 1) + ts->length(last - 1);
+}
+
+u8
+Lexer::lex_parallel(const uint jobs, const bool simd)
+{
+    uint chunks = file_length / PARALLEL_MIN_CHUNK;
+    if (chunks > jobs) chunks = jobs;
+    if (chunks < 2) return simd ? lex_simd() : lex();
+
+    // chunk boundaries, right after a newline
+    Array<uint> bounds(chunks + 1);
+    bounds.append(0);
+    for (uint k = 1; k < chunks; k++)
+    {
+        const uint at = (uint)((u64)file_length * k / chunks);
+        if (at < bounds[bounds.count() - 1]) continue;
+        cstr nl = static_cast<cstr>(memchr(file->contents + at, '\n', file_length - at));
+        if (!nl || (uint)(nl - file->contents) + 1 >= file_length) break;
+        bounds.append((uint)(nl - file->contents) + 1);
+    }
+    bounds.append(file_length);
+    chunks = (uint)bounds.count() - 1;
+
+    ThreadPool pool(jobs);
+    Array<ChunkJob> parts(chunks);
+    const f64 tokens_per_byte = sample_density();
+    for (uint k = 0; k < chunks; k++)
+    {
+        // the last chunk runs to the end of the file
+        const uint end = k + 1 == chunks ? UINT_MAX : bounds[k + 1];
+        Lexer *lexer =
+            new Lexer(file, expected_tokens(bounds[k + 1] - bounds[k], tokens_per_byte));
+        parts.append(ChunkJob{lexer, bounds[k], end, simd, ChunkEnd{FAILURE, 0, UINT_MAX}});
+    }
+    for (uint k = 0; k < chunks; k++)
+        pool.submit(run_chunk, &parts[k]);
+    pool.wait();
+
+    // resolution, starting from the first chunk (the only one lexed from a known state)
+    Array<Lexer *> resolved(chunks);
+    Array<TokenRange> ranges(chunks * 2);
+    const u64 resolve_start = time_ns();
+    uint resume             = 0;
+    Lexer *current          = parts[0].lexer;
+    TknIdx first            = 0;
+    ChunkEnd at             = parts[0].result;
+    for (uint k = 0;;)
+    {
+        if (at.status == FAILURE) break;
+        const TokenStream *ts = current->tokens;
+        if (at.status == SUCCESS && at.resync_at != UINT_MAX)
+        {
+            // the re-lexed tokens met the speculative run of chunk k
+            accept(&ranges, &resume, ts, first, at.stop);
+            current = parts[k].lexer;
+            first   = at.resync_at;
+            at      = parts[k].result;
+            continue;
+        }
+
+        accept(&ranges, &resume, ts, first, at.status == DONE ? (TknIdx)ts->count() : at.stop);
+        if (at.status == DONE) break;
+        k++;
+        ASSERT(k < chunks, "the last chunk must reach the end of the file");
+
+        const TokenStream *spec = parts[k].lexer->tokens;
+        const TknIdx next       = spec->find(ts->offset(at.stop));
+        if (same_token(ts, at.stop, spec, next))
+        {
+            current = parts[k].lexer;
+            first   = next;
+            at      = parts[k].result;
+            continue;
+        }
+
+        // chunk k started inside a token (string, comment...), lex it again from the real state
+        current = new Lexer(file, expected_tokens(bounds[k + 1] - bounds[k], tokens_per_byte));
+        resolved.append(current);
+        first = 0;
+        at    = current->lex_chunk(resume, parts[k].end, simd, spec);
+    }
+
+    trace_event("resolve", "lexer", nullptr, resolve_start, time_ns());
+
+    const bool failed = at.status == FAILURE;
+    if (!failed)
+    {
+        TimeScope scope("stitch", "lexer");
+        init_tokens();
+        tokens->assign(ranges.data(), (uint)ranges.count(), &pool);
+    }
+
+    for (uint k = 0; k < chunks; k++)
+        delete parts[k].lexer;
+    for (usize i = 0; i < resolved.count(); i++)
+        delete resolved[i];
+
+    // the serial run reports the error with the exact lexer state
+    if (failed) return simd ? lex_simd() : lex();
+    return SUCCESS;
+}
+
+} // namespace rotate
@@ -0,0 +1,127 @@
+#include "lexer.hpp"
+
+namespace rotate
+{
+
+/*
+ *  Stage 2 of the simd lexer
+ *  the stage 1 bitmasks (see simd.hpp) are walked directly: a run of spaces and
+ *  the end of an identifier are one tzcnt each in the block at hand, strings and
+ *  comments jump to the next quote or newline bit; strings, numbers, chars and
+ *  punctuators share the scalar routines so both engines produce identical token
+ *  streams; it only beats `lex` while stage 2 stays this thin, check
+ *  `vr_bench throughput` before adding work per token here
+ */
+
+u8
+Lexer::lex_simd()
+{
+    init_tokens();
+    StructuralIndex si(file->contents, file_length, simd_detect());
+    structural = &si;
+    for (;;)
+    {
+        switch (lex_director_simd())
+        {
+            case SUCCESS: break;
+            case DONE: {
+                structural = nullptr;
+                len        = 0;
+                for (u8 i = 0; i < EXTRA_NULL_TERMINATORS; ++i)
+                    add_token(TknType::EOT);
+                return SUCCESS;
+            }
+            case FAILURE: {
+                structural = nullptr;
+                if (!silent) report_error();
+                return FAILURE;
+            }
+        }
+    }
+    return FAILURE;
+}
+
+u8
+Lexer::lex_director_simd()
+{
+    // a run of spaces costs one tzcnt, each newline is a terminator
+    for (;;)
+    {
+        index = structural->skip(&BlockMasks::whitespace, index);
+        if (current() != '\n') break;
+        len = 1;
+        add_token(TknType::Terminator);
+    }
+
+    len = 0;
+    save_state();
+    switch (char_start(current()))
+    {
+        case CharStart::Number: return lex_numbers();
+        case CharStart::Char: return lex_chars();
+        case CharStart::String: return lex_strings();
+        case CharStart::Ident: return lex_identifiers_simd();
+        case CharStart::Builtin: return lex_builtin_funcs();
+        case CharStart::Symbol: break;
+    }
+    const char c = current();
+    const char p = peek();
+    if (c == '#' || (c == '/' && (p == '/' || p == '*'))) return lex_comments_simd();
+    return lex_symbols();
+}
+
+u8
+Lexer::lex_identifiers_simd()
+{
+    // the end of the identifier is one more tzcnt in the same block
+    len                 = structural->skip(&BlockMasks::ident, index + 1) - index;
+    const TknType _type = identifier_type();
+
+    if (len > 100)
+    {
+        error = LexErr::TOO_LONG_IDENTIFIER;
+        restore_state_for_err();
+        return FAILURE;
+    }
+
+    if (_type != TknType::Identifier) return add_token(_type);
+    cstr const name = file->contents + index;
+    const u64 hash  = symbol_hash_readable(name, len, readable() - index);
+    return add_token(_type, symbols->intern(name, len, hash));
+}
+
+u8
+Lexer::lex_comments_simd()
+{
+    if (current() == '#')
+    {
+        // the newline ending the comment is consumed as well
+        index = structural->next_set(&BlockMasks::newline, index) + 1;
+        return SUCCESS;
+    }
+
+    if (peek() == '/')
+    {
+        index = structural->next_set(&BlockMasks::newline, index);
+        return SUCCESS;
+    }
+
+    // block comments end at `*/` or at the end of the file
+    cstr it        = file->contents + index + 2;
+    cstr const end = file->contents + file_length;
+    index          = file_length;
+    while (it < end)
+    {
+        it = static_cast<cstr>(memchr(it, '*', (usize)(end - it)));
+        if (!it) break;
+        if (it[1] == '/')
+        {
+            index = (uint)(it - file->contents) + 2;
+            break;
+        }
+        it++;
+    }
+    return SUCCESS;
+}
+
+} // namespace rotate
@@ -0,0 +1,47 @@
+#include "lines.hpp"
+#include "simd.hpp"
+
+namespace rotate
+{
+
+LineIndex::LineIndex(cstr src, const uint length) : newlines(length / 32 + 16), length(length)
+{
+    ASSERT_NULL(src, "LineIndex source is a null pointer");
+    simd_find_newlines(src, length, &newlines, simd_detect());
+}
+
+uint
+LineIndex::line_of(const uint offset) const
+{
+    // number of newlines before the offset
+    usize lo = 0, hi = newlines.count();
+    while (lo < hi)
+    {
+        const usize mid = (lo + hi) / 2;
+        if (newlines[mid] < offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (uint)lo + 1;
+}
+
+uint
+LineIndex::column_of(const uint offset) const
+{
+    return offset - line_start(line_of(offset)) + 1;
+}
+
+uint
+LineIndex::line_start(const uint line) const
+{
+    return line < 2 ? 0 : newlines[line - 2] + 1;
+}
+
+uint
+LineIndex::line_end(const uint line) const
+{
+    return line - 1 < newlines.count() ? newlines[line - 1] : length;
+}
+
+} // namespace rotate
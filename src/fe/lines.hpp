@@ -0,0 +1,34 @@
+#pragma once
+
+#include "../include/common.hpp"
+
+namespace rotate
+{
+
+/*
+ *  LineIndex: offsets of every newline of a source, built once with a
+ *  vectorized scan; lines and columns of any byte offset are then found
+ *  with a binary search instead of being tracked by the lexer per byte
+ */
+
+class LineIndex
+{
+    Array<uint> newlines;
+    uint length;
+
+    public:
+    LineIndex(cstr src, const uint length);
+    ~LineIndex() = default;
+
+    // 1-based line of a byte offset
+    uint line_of(const uint offset) const;
+    // 1-based column of a byte offset
+    uint column_of(const uint offset) const;
+    // offset of the first byte of a line
+    uint line_start(const uint line) const;
+    // offset of the '\n' ending a line (or the source length for the last line)
+    uint line_end(const uint line) const;
+    uint count() const { return (uint)newlines.count() + 1; }
+};
+
+} // namespace rotate
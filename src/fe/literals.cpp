@@ -0,0 +1,369 @@
+#include "literals.hpp"
+
+namespace rotate
+{
+
+void
+LiteralPool::clear()
+{
+    ints.resize(0);
+    floats.resize(0);
+    chars.resize(0);
+}
+
+/*
+ *  integer kernels, 8 digits are converted at once with SWAR when available
+ *  NOTE: the words are read in little endian order, the first digit is the lowest byte
+ */
+
+static inline u64
+load_word(cstr text)
+{
+    u64 w;
+    memcpy(&w, text, sizeof(u64));
+    return w;
+}
+
+// "12345678" -> 12345678
+static inline u64
+eight_decimal_digits(cstr text)
+{
+    u64 w = load_word(text) - 0x3030303030303030ull;
+    w     = (w * 10) + (w >> 8); // pairs of digits
+    return (((w & 0x000000FF000000FFull) * 0x000F424000000064ull) +
+            (((w >> 16) & 0x000000FF000000FFull) * 0x0000271000000001ull)) >>
+           32;
+}
+
+// "89abCDef" -> 0x89abcdef
+static inline u64
+eight_hex_digits(cstr text)
+{
+    const u64 w = load_word(text);
+    // '0'-'9' keep their low nibble, letters have bit 6 set and need 9 more
+    u64 v = (w & 0x0F0F0F0F0F0F0F0Full) + 9 * ((w >> 6) & 0x0101010101010101ull);
+    v     = ((v & 0x00FF00FF00FF00FFull) << 4) | ((v >> 8) & 0x00FF00FF00FF00FFull);
+    v     = ((v & 0x0000FFFF0000FFFFull) << 8) | ((v >> 16) & 0x0000FFFF0000FFFFull);
+    return ((v & 0xFFFFFFFFull) << 16) | (v >> 32);
+}
+
+// "10110011" -> 0b10110011
+static inline u64
+eight_binary_digits(cstr text)
+{
+    const u64 w = load_word(text) & 0x0101010101010101ull;
+    return (w * 0x8040201008040201ull) >> 56;
+}
+
+static inline u8
+hex_value(const char c)
+{
+    return (u8)((c & 0xF) + 9 * (c >> 6));
+}
+
+static uint
+skip_zeros(cstr text, const uint len)
+{
+    uint i = 0;
+    while (i < len && text[i] == '0')
+        i++;
+    return i;
+}
+
+bool
+parse_decimal(cstr text, const uint len, u64 *out) noexcept
+{
+    static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "SWAR digits assume little endian");
+    uint i = skip_zeros(text, len);
+    // UINT64_MAX has 20 digits, only 20 digit numbers may overflow
+    if (len - i > 20) return false;
+
+    u64 value = 0;
+    if (len - i < 20)
+    {
+        for (; i + 8 <= len; i += 8)
+            value = value * 100000000 + eight_decimal_digits(text + i);
+    }
+    for (; i < len; i++)
+    {
+        if (__builtin_mul_overflow(value, 10, &value) ||
+            __builtin_add_overflow(value, (u64)(text[i] - '0'), &value))
+            return false;
+    }
+    *out = value;
+    return true;
+}
+
+bool
+parse_hex(cstr text, const uint len, u64 *out) noexcept
+{
+    uint i = skip_zeros(text, len);
+    if (len - i > 16) return false;
+
+    u64 value = 0;
+    for (; i + 8 <= len; i += 8)
+        value = (value << 32) | eight_hex_digits(text + i);
+    for (; i < len; i++)
+        value = (value << 4) | hex_value(text[i]);
+    *out = value;
+    return true;
+}
+
+bool
+parse_binary(cstr text, const uint len, u64 *out) noexcept
+{
+    uint i = skip_zeros(text, len);
+    if (len - i > 64) return false;
+
+    u64 value = 0;
+    for (; i + 8 <= len; i += 8)
+        value = (value << 8) | eight_binary_digits(text + i);
+    for (; i < len; i++)
+        value = (value << 1) | (u64)(text[i] - '0');
+    *out = value;
+    return true;
+}
+
+/*
+ *  floats: w * 10^q with w the digits without the dot and q = -(fraction digits)
+ *  1. Clinger's fast path: w and 10^-q are exact doubles, one division rounds correctly
+ *  2. Eisel-Lemire: w times a 128 bit truncated 10^q, rejects the rare ambiguous cases
+ *  3. exact fallback: strtod (more than 19 significant digits or an ambiguous case)
+ */
+
+constexpr int FLOAT_POW10_MIN = -100;
+
+// 10^q normalized to [2^127, 2^128) and rounded down, {high, low} words
+static const u64 FLOAT_POW10[][2] = {
+    {0xDFF9772470297EBDULL, 0x59787E2B93BC56F7ULL}, // 1e-100
+    {0x8BFBEA76C619EF36ULL, 0x57EB4EDB3C55B65AULL}, // 1e-99
+    {0xAEFAE51477A06B03ULL, 0xEDE622920B6B23F1ULL}, // 1e-98
+    {0xDAB99E59958885C4ULL, 0xE95FAB368E45ECEDULL}, // 1e-97
+    {0x88B402F7FD75539BULL, 0x11DBCB0218EBB414ULL}, // 1e-96
+    {0xAAE103B5FCD2A881ULL, 0xD652BDC29F26A119ULL}, // 1e-95
+    {0xD59944A37C0752A2ULL, 0x4BE76D3346F0495FULL}, // 1e-94
+    {0x857FCAE62D8493A5ULL, 0x6F70A4400C562DDBULL}, // 1e-93
+    {0xA6DFBD9FB8E5B88EULL, 0xCB4CCD500F6BB952ULL}, // 1e-92
+    {0xD097AD07A71F26B2ULL, 0x7E2000A41346A7A7ULL}, // 1e-91
+    {0x825ECC24C873782FULL, 0x8ED400668C0C28C8ULL}, // 1e-90
+    {0xA2F67F2DFA90563BULL, 0x728900802F0F32FAULL}, // 1e-89
+    {0xCBB41EF979346BCAULL, 0x4F2B40A03AD2FFB9ULL}, // 1e-88
+    {0xFEA126B7D78186BCULL, 0xE2F610C84987BFA8ULL}, // 1e-87
+    {0x9F24B832E6B0F436ULL, 0x0DD9CA7D2DF4D7C9ULL}, // 1e-86
+    {0xC6EDE63FA05D3143ULL, 0x91503D1C79720DBBULL}, // 1e-85
+    {0xF8A95FCF88747D94ULL, 0x75A44C6397CE912AULL}, // 1e-84
+    {0x9B69DBE1B548CE7CULL, 0xC986AFBE3EE11ABAULL}, // 1e-83
+    {0xC24452DA229B021BULL, 0xFBE85BADCE996168ULL}, // 1e-82
+    {0xF2D56790AB41C2A2ULL, 0xFAE27299423FB9C3ULL}, // 1e-81
+    {0x97C560BA6B0919A5ULL, 0xDCCD879FC967D41AULL}, // 1e-80
+    {0xBDB6B8E905CB600FULL, 0x5400E987BBC1C920ULL}, // 1e-79
+    {0xED246723473E3813ULL, 0x290123E9AAB23B68ULL}, // 1e-78
+    {0x9436C0760C86E30BULL, 0xF9A0B6720AAF6521ULL}, // 1e-77
+    {0xB94470938FA89BCEULL, 0xF808E40E8D5B3E69ULL}, // 1e-76
+    {0xE7958CB87392C2C2ULL, 0xB60B1D1230B20E04ULL}, // 1e-75
+    {0x90BD77F3483BB9B9ULL, 0xB1C6F22B5E6F48C2ULL}, // 1e-74
+    {0xB4ECD5F01A4AA828ULL, 0x1E38AEB6360B1AF3ULL}, // 1e-73
+    {0xE2280B6C20DD5232ULL, 0x25C6DA63C38DE1B0ULL}, // 1e-72
+    {0x8D590723948A535FULL, 0x579C487E5A38AD0EULL}, // 1e-71
+    {0xB0AF48EC79ACE837ULL, 0x2D835A9DF0C6D851ULL}, // 1e-70
+    {0xDCDB1B2798182244ULL, 0xF8E431456CF88E65ULL}, // 1e-69
+    {0x8A08F0F8BF0F156BULL, 0x1B8E9ECB641B58FFULL}, // 1e-68
+    {0xAC8B2D36EED2DAC5ULL, 0xE272467E3D222F3FULL}, // 1e-67
+    {0xD7ADF884AA879177ULL, 0x5B0ED81DCC6ABB0FULL}, // 1e-66
+    {0x86CCBB52EA94BAEAULL, 0x98E947129FC2B4E9ULL}, // 1e-65
+    {0xA87FEA27A539E9A5ULL, 0x3F2398D747B36224ULL}, // 1e-64
+    {0xD29FE4B18E88640EULL, 0x8EEC7F0D19A03AADULL}, // 1e-63
+    {0x83A3EEEEF9153E89ULL, 0x1953CF68300424ACULL}, // 1e-62
+    {0xA48CEAAAB75A8E2BULL, 0x5FA8C3423C052DD7ULL}, // 1e-61
+    {0xCDB02555653131B6ULL, 0x3792F412CB06794DULL}, // 1e-60
+    {0x808E17555F3EBF11ULL, 0xE2BBD88BBEE40BD0ULL}, // 1e-59
+    {0xA0B19D2AB70E6ED6ULL, 0x5B6ACEAEAE9D0EC4ULL}, // 1e-58
+    {0xC8DE047564D20A8BULL, 0xF245825A5A445275ULL}, // 1e-57
+    {0xFB158592BE068D2EULL, 0xEED6E2F0F0D56712ULL}, // 1e-56
+    {0x9CED737BB6C4183DULL, 0x55464DD69685606BULL}, // 1e-55
+    {0xC428D05AA4751E4CULL, 0xAA97E14C3C26B886ULL}, // 1e-54
+    {0xF53304714D9265DFULL, 0xD53DD99F4B3066A8ULL}, // 1e-53
+    {0x993FE2C6D07B7FABULL, 0xE546A8038EFE4029ULL}, // 1e-52
+    {0xBF8FDB78849A5F96ULL, 0xDE98520472BDD033ULL}, // 1e-51
+    {0xEF73D256A5C0F77CULL, 0x963E66858F6D4440ULL}, // 1e-50
+    {0x95A8637627989AADULL, 0xDDE7001379A44AA8ULL}, // 1e-49
+    {0xBB127C53B17EC159ULL, 0x5560C018580D5D52ULL}, // 1e-48
+    {0xE9D71B689DDE71AFULL, 0xAAB8F01E6E10B4A6ULL}, // 1e-47
+    {0x9226712162AB070DULL, 0xCAB3961304CA70E8ULL}, // 1e-46
+    {0xB6B00D69BB55C8D1ULL, 0x3D607B97C5FD0D22ULL}, // 1e-45
+    {0xE45C10C42A2B3B05ULL, 0x8CB89A7DB77C506AULL}, // 1e-44
+    {0x8EB98A7A9A5B04E3ULL, 0x77F3608E92ADB242ULL}, // 1e-43
+    {0xB267ED1940F1C61CULL, 0x55F038B237591ED3ULL}, // 1e-42
+    {0xDF01E85F912E37A3ULL, 0x6B6C46DEC52F6688ULL}, // 1e-41
+    {0x8B61313BBABCE2C6ULL, 0x2323AC4B3B3DA015ULL}, // 1e-40
+    {0xAE397D8AA96C1B77ULL, 0xABEC975E0A0D081AULL}, // 1e-39
+    {0xD9C7DCED53C72255ULL, 0x96E7BD358C904A21ULL}, // 1e-38
+    {0x881CEA14545C7575ULL, 0x7E50D64177DA2E54ULL}, // 1e-37
+    {0xAA242499697392D2ULL, 0xDDE50BD1D5D0B9E9ULL}, // 1e-36
+    {0xD4AD2DBFC3D07787ULL, 0x955E4EC64B44E864ULL}, // 1e-35
+    {0x84EC3C97DA624AB4ULL, 0xBD5AF13BEF0B113EULL}, // 1e-34
+    {0xA6274BBDD0FADD61ULL, 0xECB1AD8AEACDD58EULL}, // 1e-33
+    {0xCFB11EAD453994BAULL, 0x67DE18EDA5814AF2ULL}, // 1e-32
+    {0x81CEB32C4B43FCF4ULL, 0x80EACF948770CED7ULL}, // 1e-31
+    {0xA2425FF75E14FC31ULL, 0xA1258379A94D028DULL}, // 1e-30
+    {0xCAD2F7F5359A3B3EULL, 0x096EE45813A04330ULL}, // 1e-29
+    {0xFD87B5F28300CA0DULL, 0x8BCA9D6E188853FCULL}, // 1e-28
+    {0x9E74D1B791E07E48ULL, 0x775EA264CF55347DULL}, // 1e-27
+    {0xC612062576589DDAULL, 0x95364AFE032A819DULL}, // 1e-26
+    {0xF79687AED3EEC551ULL, 0x3A83DDBD83F52204ULL}, // 1e-25
+    {0x9ABE14CD44753B52ULL, 0xC4926A9672793542ULL}, // 1e-24
+    {0xC16D9A0095928A27ULL, 0x75B7053C0F178293ULL}, // 1e-23
+    {0xF1C90080BAF72CB1ULL, 0x5324C68B12DD6338ULL}, // 1e-22
+    {0x971DA05074DA7BEEULL, 0xD3F6FC16EBCA5E03ULL}, // 1e-21
+    {0xBCE5086492111AEAULL, 0x88F4BB1CA6BCF584ULL}, // 1e-20
+    {0xEC1E4A7DB69561A5ULL, 0x2B31E9E3D06C32E5ULL}, // 1e-19
+    {0x9392EE8E921D5D07ULL, 0x3AFF322E62439FCFULL}, // 1e-18
+    {0xB877AA3236A4B449ULL, 0x09BEFEB9FAD487C2ULL}, // 1e-17
+    {0xE69594BEC44DE15BULL, 0x4C2EBE687989A9B3ULL}, // 1e-16
+    {0x901D7CF73AB0ACD9ULL, 0x0F9D37014BF60A10ULL}, // 1e-15
+    {0xB424DC35095CD80FULL, 0x538484C19EF38C94ULL}, // 1e-14
+    {0xE12E13424BB40E13ULL, 0x2865A5F206B06FB9ULL}, // 1e-13
+    {0x8CBCCC096F5088CBULL, 0xF93F87B7442E45D3ULL}, // 1e-12
+    {0xAFEBFF0BCB24AAFEULL, 0xF78F69A51539D748ULL}, // 1e-11
+    {0xDBE6FECEBDEDD5BEULL, 0xB573440E5A884D1BULL}, // 1e-10
+    {0x89705F4136B4A597ULL, 0x31680A88F8953030ULL}, // 1e-9
+    {0xABCC77118461CEFCULL, 0xFDC20D2B36BA7C3DULL}, // 1e-8
+    {0xD6BF94D5E57A42BCULL, 0x3D32907604691B4CULL}, // 1e-7
+    {0x8637BD05AF6C69B5ULL, 0xA63F9A49C2C1B10FULL}, // 1e-6
+    {0xA7C5AC471B478423ULL, 0x0FCF80DC33721D53ULL}, // 1e-5
+    {0xD1B71758E219652BULL, 0xD3C36113404EA4A8ULL}, // 1e-4
+    {0x83126E978D4FDF3BULL, 0x645A1CAC083126E9ULL}, // 1e-3
+    {0xA3D70A3D70A3D70AULL, 0x3D70A3D70A3D70A3ULL}, // 1e-2
+    {0xCCCCCCCCCCCCCCCCULL, 0xCCCCCCCCCCCCCCCCULL}, // 1e-1
+    {0x8000000000000000ULL, 0x0000000000000000ULL}, // 1e0
+};
+static_assert(sizeof(FLOAT_POW10) / sizeof(FLOAT_POW10[0]) == 1 - FLOAT_POW10_MIN,
+              "FLOAT_POW10 covers [FLOAT_POW10_MIN, 0]");
+
+static const f64 EXACT_POW10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                  1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                  1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static bool
+eisel_lemire(u64 w, const int q, f64 *out)
+{
+    if (q < FLOAT_POW10_MIN || q > 0) return false;
+    const u64 *pow10 = FLOAT_POW10[q - FLOAT_POW10_MIN];
+
+    // normalize and estimate the binary exponent (217706 / 2^16 ~ log2(10))
+    const int clz = __builtin_clzll(w);
+    w <<= clz;
+    u64 exp2 = (u64)(((217706 * q) >> 16) + 64 + 1023) - (u64)clz;
+
+    u128 x = (u128)w * pow10[0];
+    u64 hi = (u64)(x >> 64), lo = (u64)x;
+    if ((hi & 0x1FF) == 0x1FF && lo + w < w)
+    {
+        // the truncated low word of 10^q may change the result, widen
+        const u128 y   = (u128)w * pow10[1];
+        const u64 y_hi = (u64)(y >> 64), y_lo = (u64)y;
+        u64 merged_lo  = lo + y_hi;
+        u64 merged_hi  = hi + (merged_lo < lo);
+        if ((merged_hi & 0x1FF) == 0x1FF && merged_lo + 1 == 0 && y_lo + w < w) return false;
+        hi = merged_hi;
+        lo = merged_lo;
+    }
+
+    const u64 msb = hi >> 63;
+    u64 mantissa  = hi >> (msb + 9);
+    exp2 -= 1 ^ msb;
+
+    // halfway between two floats, the truncation hides the right rounding
+    if (lo == 0 && (hi & 0x1FF) == 0 && (mantissa & 3) == 1) return false;
+
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >> 53)
+    {
+        mantissa >>= 1;
+        exp2++;
+    }
+    if (exp2 - 1 >= 0x7FF - 1) return false; // subnormal or infinite
+
+    const u64 bits = exp2 << 52 | (mantissa & 0x000FFFFFFFFFFFFFull);
+    memcpy(out, &bits, sizeof(f64));
+    return true;
+}
+
+f64
+parse_float(cstr text, const uint len) noexcept
+{
+    // w without the dot, up to 19 significant digits fit in a u64
+    u64 w = 0;
+    uint digits = 0, fraction = 0;
+    bool dot = false;
+    for (uint i = 0; i < len; i++)
+    {
+        if (text[i] == '.')
+        {
+            dot = true;
+            continue;
+        }
+        if (dot) fraction++;
+        if (digits == 0 && text[i] == '0') continue;
+        w = w * 10 + (u64)(text[i] - '0');
+        digits++;
+        if (digits > 19) break;
+    }
+
+    if (digits <= 19)
+    {
+        const int q = -(int)fraction;
+        if (w == 0) return 0.0;
+        if (w <= (1ull << 53) && fraction <= 22) return (f64)w / EXACT_POW10[fraction];
+        f64 value;
+        if (eisel_lemire(w, q, &value)) return value;
+    }
+
+    // NOTE: numbers are at most 100 chars long (see `lex_numbers`)
+    char buffer[128];
+    const uint n = len < sizeof(buffer) - 1 ? len : (uint)sizeof(buffer) - 1;
+    memcpy(buffer, text, n);
+    buffer[n] = '\0';
+    return strtod(buffer, nullptr);
+}
+
+bool
+valid_escape(const char c) noexcept
+{
+    switch (c)
+    {
+        case 'n':
+        case 't':
+        case 'r':
+        case 'b':
+        case 'f':
+        case '\\':
+        case '\'':
+        case '"': return true;
+        default: return false;
+    }
+}
+
+char
+decode_escape(const char c) noexcept
+{
+    switch (c)
+    {
+        case 'n': return '\n';
+        case 't': return '\t';
+        case 'r': return '\r';
+        case 'b': return '\b';
+        case 'f': return '\f';
+        default: return c; // '\\', '\'' and '"'
+    }
+}
+
+char
+decode_char(cstr text, const uint len) noexcept
+{
+    if (len < 4 || text[1] != '\\') return text[1];
+    return decode_escape(text[2]);
+}
+
+} // namespace rotate
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "../include/common.hpp"
+
+namespace rotate
+{
+
+/*
+ *  LiteralPool: values of the literal tokens, decoded by the lexer while
+ *  their bytes are still in cache
+ *  - integers (decimal, hex and binary) as u64, floats as f64 and chars as
+ *    the byte they stand for
+ *  - a literal token's payload is its index in the pool of its type
+ */
+
+class LiteralPool
+{
+    Array<u64> ints;
+    Array<f64> floats;
+    Array<char> chars;
+    friend class TokenStream; // copies the values in and out of stream images
+
+    public:
+    // a payload per literal type
+    struct Base
+    {
+        u32 ints, floats, chars;
+    };
+
+    LiteralPool() = default;
+    ~LiteralPool() = default;
+
+    u32 add_integer(const u64 value)
+    {
+        ints.append(value);
+        return (u32)ints.count() - 1;
+    }
+    u32 add_float(const f64 value)
+    {
+        floats.append(value);
+        return (u32)floats.count() - 1;
+    }
+    u32 add_char(const char value)
+    {
+        chars.append(value);
+        return (u32)chars.count() - 1;
+    }
+
+    u64 integer(const u32 i) const { return ints[i]; }
+    f64 floating(const u32 i) const { return floats[i]; }
+    char character(const u32 i) const { return chars[i]; }
+
+    usize count() const { return ints.count() + floats.count() + chars.count(); }
+    usize memory() const
+    {
+        return ints.count() * sizeof(u64) + floats.count() * sizeof(f64) + chars.count();
+    }
+
+    void clear();
+};
+
+/*
+ *  decoding kernels, `text` holds only the digits (no 0x/0b prefix)
+ *  integers return false when the value does not fit in 64 bits
+ */
+
+bool parse_decimal(cstr text, const uint len, u64 *out) noexcept;
+bool parse_hex(cstr text, const uint len, u64 *out) noexcept;
+bool parse_binary(cstr text, const uint len, u64 *out) noexcept;
+// digits with one dot, correctly rounded
+f64 parse_float(cstr text, const uint len) noexcept;
+// the whole literal including the quotes: 'a' or '\n'
+char decode_char(cstr text, const uint len) noexcept;
+// whether `\c` is an escape of chars and strings: \n \t \r \b \f \\ \' and \"
+bool valid_escape(const char c) noexcept;
+// the byte an escape sequence stands for, `c` is the char after the backslash
+char decode_escape(const char c) noexcept;
+
+} // namespace rotate
@@ -0,0 +1,587 @@
+#include "simd.hpp"
+#include "charclass.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RT_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define RT_SIMD_X86 0
+#endif
+
+namespace rotate
+{
+
+SimdLevel
+simd_detect() noexcept
+{
+#if RT_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::avx2;
+    if (__builtin_cpu_supports("sse2")) return SimdLevel::sse2;
+#endif
+    return SimdLevel::scalar;
+}
+
+cstr
+simd_level_describe(const SimdLevel level) noexcept
+{
+    switch (level)
+    {
+        case SimdLevel::scalar: return "scalar";
+        case SimdLevel::sse2: return "sse2";
+        case SimdLevel::avx2: return "avx2";
+    }
+    return "UNKNOWN";
+}
+
+static void
+classify_scalar(cstr src, BlockMasks *out) noexcept
+{
+    BlockMasks m = {0, 0, 0, 0};
+    for (uint i = 0; i < SIMD_BLOCK_SIZE; i++)
+    {
+        const char c  = src[i];
+        const u8 cls  = char_class(c);
+        const u64 bit = (u64)1 << i;
+        if (cls & CC_SPACE) m.whitespace |= bit;
+        if (cls & CC_NEWLINE) m.newline |= bit;
+        if (c == '"' || c == '\\' || c == '\0') m.quote |= bit;
+        if (cls & CC_IDENT) m.ident |= bit;
+    }
+    *out = m;
+}
+
+#if RT_SIMD_X86
+
+static inline void
+classify_sse2_16(const __m128i v, u64 *ws, u64 *nl, u64 *q, u64 *id, const uint shift) noexcept
+{
+    const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                        _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), v));
+    const __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                        _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), lower));
+    const __m128i ident =
+        _mm_or_si128(_mm_or_si128(digit, alpha), _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    const __m128i quote =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                  _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+                     _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+
+    *ws |= (u64)(u16)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(' '))) << shift;
+    *nl |= (u64)(u16)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))) << shift;
+    *q |= (u64)(u16)_mm_movemask_epi8(quote) << shift;
+    *id |= (u64)(u16)_mm_movemask_epi8(ident) << shift;
+}
+
+static void
+classify_sse2(cstr src, BlockMasks *out) noexcept
+{
+    BlockMasks m = {0, 0, 0, 0};
+    for (uint i = 0; i < SIMD_BLOCK_SIZE; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        classify_sse2_16(v, &m.whitespace, &m.newline, &m.quote, &m.ident, i);
+    }
+    *out = m;
+}
+
+__attribute__((target("avx2"))) static inline u64
+avx2_mask(const __m256i v) noexcept
+{
+    return (u64)(u32)_mm256_movemask_epi8(v);
+}
+
+__attribute__((target("avx2"))) static void
+classify_avx2(cstr src, BlockMasks *out) noexcept
+{
+    BlockMasks m = {0, 0, 0, 0};
+    for (uint i = 0; i < SIMD_BLOCK_SIZE; i += 32)
+    {
+        const __m256i v     = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        const __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        const __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+                                               _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+        const __m256i alpha =
+            _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                             _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+        const __m256i ident = _mm256_or_si256(_mm256_or_si256(digit, alpha),
+                                              _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+        const __m256i quote =
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+                                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))),
+                            _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+
+        m.whitespace |= avx2_mask(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '))) << i;
+        m.newline |= avx2_mask(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))) << i;
+        m.quote |= avx2_mask(quote) << i;
+        m.ident |= avx2_mask(ident) << i;
+    }
+    *out = m;
+}
+
+#endif // RT_SIMD_X86
+
+void
+simd_classify(cstr src, const uint blocks, BlockMasks *out, const SimdLevel level) noexcept
+{
+    switch (level)
+    {
+#if RT_SIMD_X86
+        case SimdLevel::avx2:
+            for (uint b = 0; b < blocks; b++)
+                classify_avx2(src + b * SIMD_BLOCK_SIZE, out + b);
+            return;
+        case SimdLevel::sse2:
+            for (uint b = 0; b < blocks; b++)
+                classify_sse2(src + b * SIMD_BLOCK_SIZE, out + b);
+            return;
+#endif
+        default:
+            for (uint b = 0; b < blocks; b++)
+                classify_scalar(src + b * SIMD_BLOCK_SIZE, out + b);
+            return;
+    }
+}
+
+static inline void
+append_bits(u64 bits, const uint base, Array<uint> *out) noexcept
+{
+    while (bits)
+    {
+        out->append(base + (uint)__builtin_ctzll(bits));
+        bits &= bits - 1;
+    }
+}
+
+#if RT_SIMD_X86
+
+static u64
+newlines_sse2(cstr src) noexcept
+{
+    const __m128i nl = _mm_set1_epi8('\n');
+    u64 bits         = 0;
+    for (uint i = 0; i < SIMD_BLOCK_SIZE; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        bits |= (u64)(u16)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)) << i;
+    }
+    return bits;
+}
+
+__attribute__((target("avx2"))) static u64
+newlines_avx2(cstr src) noexcept
+{
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+    const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 32));
+    return avx2_mask(_mm256_cmpeq_epi8(lo, nl)) | avx2_mask(_mm256_cmpeq_epi8(hi, nl)) << 32;
+}
+
+#endif // RT_SIMD_X86
+
+static u64
+newlines_scalar(cstr src) noexcept
+{
+    u64 bits = 0;
+    for (uint i = 0; i < SIMD_BLOCK_SIZE; i++)
+        bits |= (u64)(src[i] == '\n') << i;
+    return bits;
+}
+
+static inline u64
+newlines_block(cstr src, const SimdLevel level) noexcept
+{
+    switch (level)
+    {
+#if RT_SIMD_X86
+        case SimdLevel::avx2: return newlines_avx2(src);
+        case SimdLevel::sse2: return newlines_sse2(src);
+#endif
+        default: return newlines_scalar(src);
+    }
+}
+
+void
+simd_find_newlines(cstr src, const uint length, Array<uint> *out, const SimdLevel level) noexcept
+{
+    uint pos = 0;
+    for (; (usize)pos + SIMD_BLOCK_SIZE <= length; pos += SIMD_BLOCK_SIZE)
+        append_bits(newlines_block(src + pos, level), pos, out);
+
+    if (pos < length)
+    {
+        char tail[SIMD_BLOCK_SIZE];
+        memset(tail, 0, SIMD_BLOCK_SIZE);
+        memcpy(tail, src + pos, length - pos);
+        append_bits(newlines_block(tail, level), pos, out);
+    }
+}
+
+/*
+ *  source validation
+ *  a block is checked for bytes below 0x20 (except '\n'), DEL and bytes above
+ *  0x7f at once, with signed compares 0x80..0xff are below 0x20 too; the rare
+ *  blocks with such bytes are then walked byte by byte, UTF-8 sequences are
+ *  decoded there, so ASCII sources never leave the vector loop
+ */
+
+#if RT_SIMD_X86
+
+static u64
+suspects_sse2(cstr src) noexcept
+{
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i nl    = _mm_set1_epi8('\n');
+    const __m128i del   = _mm_set1_epi8(0x7f);
+    u64 bits            = 0;
+    for (uint i = 0; i < SIMD_BLOCK_SIZE; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        const __m128i bad =
+            _mm_or_si128(_mm_andnot_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpgt_epi8(space, v)),
+                         _mm_cmpeq_epi8(v, del));
+        bits |= (u64)(u16)_mm_movemask_epi8(bad) << i;
+    }
+    return bits;
+}
+
+__attribute__((target("avx2"))) static u64
+suspects_avx2(cstr src) noexcept
+{
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i nl    = _mm256_set1_epi8('\n');
+    const __m256i del   = _mm256_set1_epi8(0x7f);
+    u64 bits            = 0;
+    for (uint i = 0; i < SIMD_BLOCK_SIZE; i += 32)
+    {
+        const __m256i v   = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        const __m256i bad = _mm256_or_si256(
+            _mm256_andnot_si256(_mm256_cmpeq_epi8(v, nl), _mm256_cmpgt_epi8(space, v)),
+            _mm256_cmpeq_epi8(v, del));
+        bits |= avx2_mask(bad) << i;
+    }
+    return bits;
+}
+
+#endif // RT_SIMD_X86
+
+static u64
+suspects_scalar(cstr src) noexcept
+{
+    u64 bits = 0;
+    for (uint i = 0; i < SIMD_BLOCK_SIZE; i++)
+    {
+        const u8 c = (u8)src[i];
+        bits |= (u64)((c < ' ' && c != '\n') || c >= 0x7f) << i;
+    }
+    return bits;
+}
+
+static inline u64
+suspects_block(cstr src, const SimdLevel level) noexcept
+{
+    switch (level)
+    {
+#if RT_SIMD_X86
+        case SimdLevel::avx2: return suspects_avx2(src);
+        case SimdLevel::sse2: return suspects_sse2(src);
+#endif
+        default: return suspects_scalar(src);
+    }
+}
+
+// length of the UTF-8 sequence at `s`, 0 if it is invalid (overlong forms,
+// surrogates, code points above U+10FFFF or a sequence cut by the end)
+static uint
+utf8_sequence(cstr s, const uint available) noexcept
+{
+    const u8 *p = reinterpret_cast<const u8 *>(s);
+    uint n      = 0;
+    if (p[0] >= 0xc2 && p[0] <= 0xdf) { n = 2; }
+    else if ((p[0] & 0xf0) == 0xe0) { n = 3; }
+    else if (p[0] >= 0xf0 && p[0] <= 0xf4) { n = 4; }
+    else { return 0; }
+    if (n > available) return 0;
+    for (uint i = 1; i < n; i++)
+        if ((p[i] & 0xc0) != 0x80) return 0;
+    if ((p[0] == 0xe0 && p[1] < 0xa0) || (p[0] == 0xf0 && p[1] < 0x90)) return 0;
+    if ((p[0] == 0xed && p[1] > 0x9f) || (p[0] == 0xf4 && p[1] > 0x8f)) return 0;
+    return n;
+}
+
+// clears the bits of the bytes of a block before `next`
+static inline u64
+from(const u64 bits, const uint base, const uint next) noexcept
+{
+    if (next <= base) return bits;
+    return next - base >= SIMD_BLOCK_SIZE ? 0 : bits & (~0ull << (next - base));
+}
+
+uint
+simd_validate_source(cstr src, const uint length, const bool ascii_only,
+                     const SimdLevel level) noexcept
+{
+    uint next = 0; // the bytes of the last decoded sequence end here
+    for (uint base = 0; base < length; base += SIMD_BLOCK_SIZE)
+    {
+        u64 bits = 0;
+        if ((usize)base + SIMD_BLOCK_SIZE <= length) { bits = suspects_block(src + base, level); }
+        else
+        {
+            char tail[SIMD_BLOCK_SIZE];
+            memset(tail, 0, SIMD_BLOCK_SIZE);
+            memcpy(tail, src + base, length - base);
+            bits = suspects_block(tail, level) & ((1ull << (length - base)) - 1);
+        }
+
+        for (bits = from(bits, base, next); bits; bits = from(bits, base, next))
+        {
+            const uint pos = base + (uint)__builtin_ctzll(bits);
+            if ((u8)src[pos] < 0x80 || ascii_only) return pos;
+            const uint n = utf8_sequence(src + pos, length - pos);
+            if (!n) return pos;
+            next = pos + n;
+        }
+    }
+    return length;
+}
+
+/*
+ *  content hash
+ *  the source is read in 64 byte stripes of 8 u64 lanes, each lane keeps its
+ *  own accumulator: the word is added to the neighbouring lane and the
+ *  product of the two halves of (word ^ key) to its own, a 32x32 bit multiply
+ *  every vector width has; the keys slide by one word per stripe and the
+ *  accumulators are scrambled after every HASH_BLOCK_STRIPES stripes, then
+ *  folded pairwise with a 128 bit multiply. The lanes are independent, so the
+ *  scalar, sse2 and avx2 kernels give the same hash
+ */
+
+constexpr uint HASH_STRIPE        = 64;
+constexpr uint HASH_BLOCK_STRIPES = 16;
+constexpr u64 HASH_PRIME32        = 0x9e3779b1ull;
+constexpr u64 HASH_PRIME64        = 0x9e3779b185ebca87ull;
+
+static const u64 HASH_KEYS[HASH_BLOCK_STRIPES + 7] = {
+    0x6a340db50def66d8ull, 0x9c2bfeeea8b2a683ull, 0xbfd15346a5fec89aull, 0x39547cc371266ca8ull,
+    0x4d36f147715aaec4ull, 0xa4512db9d30ec2d6ull, 0x9c0cead5bc28891full, 0x9ece422824cdea60ull,
+    0x5bc4ed5397988a83ull, 0x501e78cc1f9b4bc2ull, 0x1b3824fa35a5da2full, 0x941e2fcf579d9472ull,
+    0x4918c0301d0a2529ull, 0x4e8efc1922e4d20full, 0xd2f4a53fa092248eull, 0x6ea3efbeda92fa4bull,
+    0xaa9cf02b9f231441ull, 0x273a76c96afff9e1ull, 0xbae1ae620d7740cbull, 0x96ce7ecfd2779d65ull,
+    0x47c72a3875e2fe71ull, 0x42c558a541fd3b8full, 0x1fef5b08ccebb210ull,
+};
+static const u64 HASH_SCRAMBLE[8] = {
+    0xfac3a006c206fa76ull, 0x251abc399e7ab5d0ull, 0xb5bc1f4097b4d91bull, 0x260c9df3acb3814bull,
+    0x3fc076348fe39914ull, 0x82ffcd23ee78a3deull, 0x23542004305501c5ull, 0xd45ee91498dc8bdeull,
+};
+
+// stripes [first, first + stripes) of the source, `src` is the first of them
+static void
+hash_stripes_scalar(u64 *acc, cstr src, const usize first, const usize stripes) noexcept
+{
+    for (usize s = first; s < first + stripes; s++, src += HASH_STRIPE)
+    {
+        const u64 *key = HASH_KEYS + s % HASH_BLOCK_STRIPES;
+        for (uint i = 0; i < 8; i++)
+        {
+            u64 word;
+            memcpy(&word, src + i * sizeof(u64), sizeof(u64));
+            const u64 mixed = word ^ key[i];
+            acc[i ^ 1] += word;
+            acc[i] += (mixed & 0xffffffffull) * (mixed >> 32);
+        }
+        if (s % HASH_BLOCK_STRIPES != HASH_BLOCK_STRIPES - 1) continue;
+        for (uint i = 0; i < 8; i++)
+            acc[i] = (acc[i] ^ (acc[i] >> 47) ^ HASH_SCRAMBLE[i]) * HASH_PRIME32;
+    }
+}
+
+#if RT_SIMD_X86
+
+static void
+hash_stripes_sse2(u64 *acc, cstr src, const usize first, const usize stripes) noexcept
+{
+    __m128i a[4];
+    for (uint j = 0; j < 4; j++)
+        a[j] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc) + j);
+    const __m128i prime = _mm_set1_epi32((int)HASH_PRIME32);
+    for (usize s = first; s < first + stripes; s++, src += HASH_STRIPE)
+    {
+        const __m128i *key = reinterpret_cast<const __m128i *>(HASH_KEYS + s % HASH_BLOCK_STRIPES);
+        for (uint j = 0; j < 4; j++)
+        {
+            const __m128i word  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src) + j);
+            const __m128i mixed = _mm_xor_si128(word, _mm_loadu_si128(key + j));
+            const __m128i product = _mm_mul_epu32(mixed, _mm_srli_epi64(mixed, 32));
+            const __m128i swapped = _mm_shuffle_epi32(word, _MM_SHUFFLE(1, 0, 3, 2));
+            a[j] = _mm_add_epi64(a[j], _mm_add_epi64(product, swapped));
+        }
+        if (s % HASH_BLOCK_STRIPES != HASH_BLOCK_STRIPES - 1) continue;
+        for (uint j = 0; j < 4; j++)
+        {
+            const __m128i scramble =
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(HASH_SCRAMBLE) + j);
+            const __m128i x =
+                _mm_xor_si128(_mm_xor_si128(a[j], _mm_srli_epi64(a[j], 47)), scramble);
+            const __m128i low  = _mm_mul_epu32(x, prime);
+            const __m128i high = _mm_mul_epu32(_mm_srli_epi64(x, 32), prime);
+            a[j]               = _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+        }
+    }
+    for (uint j = 0; j < 4; j++)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(acc) + j, a[j]);
+}
+
+__attribute__((target("avx2"))) static void
+hash_stripes_avx2(u64 *acc, cstr src, const usize first, const usize stripes) noexcept
+{
+    __m256i a[2];
+    for (uint j = 0; j < 2; j++)
+        a[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc) + j);
+    const __m256i prime = _mm256_set1_epi32((int)HASH_PRIME32);
+    for (usize s = first; s < first + stripes; s++, src += HASH_STRIPE)
+    {
+        const __m256i *key = reinterpret_cast<const __m256i *>(HASH_KEYS + s % HASH_BLOCK_STRIPES);
+        for (uint j = 0; j < 2; j++)
+        {
+            const __m256i word  = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src) + j);
+            const __m256i mixed = _mm256_xor_si256(word, _mm256_loadu_si256(key + j));
+            const __m256i product = _mm256_mul_epu32(mixed, _mm256_srli_epi64(mixed, 32));
+            const __m256i swapped = _mm256_shuffle_epi32(word, _MM_SHUFFLE(1, 0, 3, 2));
+            a[j] = _mm256_add_epi64(a[j], _mm256_add_epi64(product, swapped));
+        }
+        if (s % HASH_BLOCK_STRIPES != HASH_BLOCK_STRIPES - 1) continue;
+        for (uint j = 0; j < 2; j++)
+        {
+            const __m256i scramble =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(HASH_SCRAMBLE) + j);
+            const __m256i x =
+                _mm256_xor_si256(_mm256_xor_si256(a[j], _mm256_srli_epi64(a[j], 47)), scramble);
+            const __m256i low  = _mm256_mul_epu32(x, prime);
+            const __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), prime);
+            a[j]               = _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+        }
+    }
+    for (uint j = 0; j < 2; j++)
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc) + j, a[j]);
+}
+
+#endif // RT_SIMD_X86
+
+static inline void
+hash_stripes(u64 *acc, cstr src, const usize first, const usize stripes,
+             const SimdLevel level) noexcept
+{
+    switch (level)
+    {
+#if RT_SIMD_X86
+        case SimdLevel::avx2: return hash_stripes_avx2(acc, src, first, stripes);
+        case SimdLevel::sse2: return hash_stripes_sse2(acc, src, first, stripes);
+#endif
+        default: return hash_stripes_scalar(acc, src, first, stripes);
+    }
+}
+
+static inline u64
+hash_fold(const u64 a, const u64 b) noexcept
+{
+    const u128 product = (u128)a * b;
+    return (u64)product ^ (u64)(product >> 64);
+}
+
+u64
+simd_hash(cstr src, const usize length, const SimdLevel level) noexcept
+{
+    u64 acc[8] = {HASH_PRIME32, HASH_PRIME64,       HASH_KEYS[0], HASH_KEYS[1],
+                  HASH_KEYS[2], HASH_SCRAMBLE[0], HASH_SCRAMBLE[1], HASH_PRIME64 ^ HASH_PRIME32};
+    const usize stripes = length / HASH_STRIPE;
+    hash_stripes(acc, src, 0, stripes, level);
+    if (length % HASH_STRIPE)
+    {
+        // the zero padding is told apart by the length below
+        char tail[HASH_STRIPE];
+        memset(tail, 0, HASH_STRIPE);
+        memcpy(tail, src + stripes * HASH_STRIPE, length % HASH_STRIPE);
+        hash_stripes(acc, tail, stripes, 1, level);
+    }
+
+    u64 h = (u64)length * HASH_PRIME64;
+    for (uint i = 0; i < 8; i += 2)
+        h += hash_fold(acc[i] ^ HASH_KEYS[i + 8], acc[i + 1] ^ HASH_KEYS[i + 9]);
+    h ^= h >> 37;
+    h *= 0x165667919e3779f9ull;
+    return h ^ (h >> 32);
+}
+
+StructuralIndex::StructuralIndex(cstr src, const uint length, const SimdLevel level)
+    : src(src), length(length), level(level)
+{
+    ASSERT_NULL(src, "StructuralIndex source is a null pointer");
+    num_blocks = (uint)(((usize)length + SIMD_BLOCK_SIZE - 1) / SIMD_BLOCK_SIZE);
+}
+
+void
+StructuralIndex::fill(const uint b) noexcept
+{
+    first_block  = b;
+    last_block   = b;
+    cursor_block = UINT_MAX;
+    if (b >= num_blocks)
+    {
+        // past the end: everything reads as a NUL byte
+        last_block = b + 1;
+        memset(window, 0, sizeof(BlockMasks));
+        window[0].quote = ~(u64)0;
+        return;
+    }
+
+    uint full = num_blocks - b;
+    if (full > SIMD_WINDOW_BLOCKS) full = SIMD_WINDOW_BLOCKS;
+    // the last block is partial, classify a zero padded copy of it
+    const bool has_tail = b + full == num_blocks && (length % SIMD_BLOCK_SIZE) != 0;
+    if (has_tail) full--;
+
+    simd_classify(src + (usize)b * SIMD_BLOCK_SIZE, full, window, level);
+    last_block = b + full;
+
+    if (has_tail)
+    {
+        char tail[SIMD_BLOCK_SIZE];
+        const uint offset = last_block * SIMD_BLOCK_SIZE;
+        memset(tail, 0, SIMD_BLOCK_SIZE);
+        memcpy(tail, src + offset, length - offset);
+        simd_classify(tail, 1, window + full, level);
+        last_block++;
+    }
+}
+
+uint
+StructuralIndex::next_set(const BlockMask m, const uint pos) noexcept
+{
+    for (uint b = pos / SIMD_BLOCK_SIZE, shift = pos % SIMD_BLOCK_SIZE; b < num_blocks;
+         b++, shift = 0)
+    {
+        const u64 bits = (block(b).*m >> shift) << shift;
+        if (bits)
+        {
+            const uint found = b * SIMD_BLOCK_SIZE + (uint)__builtin_ctzll(bits);
+            return found < length ? found : length;
+        }
+    }
+    return pos > length ? pos : length;
+}
+
+uint
+StructuralIndex::next_clear(const BlockMask m, const uint pos) noexcept
+{
+    for (uint b = pos / SIMD_BLOCK_SIZE, shift = pos % SIMD_BLOCK_SIZE; b < num_blocks;
+         b++, shift = 0)
+    {
+        const u64 bits = ~(block(b).*m) >> shift << shift;
+        if (bits) return b * SIMD_BLOCK_SIZE + (uint)__builtin_ctzll(bits);
+    }
+    return pos > length ? pos : length;
+}
+
+} // namespace rotate
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "../include/common.hpp"
+
+namespace rotate
+{
+
+/*
+ *  Stage 1 of the simd lexer
+ *  every 64 bytes of the source are classified at once into bitmasks,
+ *  bit n of a mask describes the byte at (block * 64 + n)
+ */
+
+constexpr uint SIMD_BLOCK_SIZE    = 64;
+constexpr uint SIMD_WINDOW_BLOCKS = 256; // 16 KiB of source per stage 1 batch
+
+enum class SimdLevel : u8
+{
+    scalar,
+    sse2,
+    avx2,
+};
+
+struct BlockMasks
+{
+    u64 whitespace; // ' '
+    u64 newline;    // '\n'
+    u64 quote;      // '"', '\\' and '\0' (bytes that end a string scan)
+    u64 ident;      // [0-9a-zA-Z_]
+};
+
+typedef u64 BlockMasks::*BlockMask;
+
+SimdLevel simd_detect() noexcept;
+cstr simd_level_describe(const SimdLevel) noexcept;
+
+// NOTE: `src` must be readable for (blocks * SIMD_BLOCK_SIZE) bytes
+void simd_classify(cstr src, const uint blocks, BlockMasks *out, const SimdLevel) noexcept;
+
+// appends the offset of every '\n' in [0, length) to `out`, in order
+void simd_find_newlines(cstr src, const uint length, Array<uint> *out, const SimdLevel) noexcept;
+
+// offset of the first byte of [0, length) that is not allowed in a source, `length` if none:
+// control bytes other than '\n' (tabs, '\r', NUL, DEL) and, unless the bytes form valid
+// UTF-8, bytes above 0x7f (any of them when `ascii_only`)
+uint simd_validate_source(cstr src, const uint length, const bool ascii_only,
+                          const SimdLevel) noexcept;
+
+// 64 bit hash of `length` bytes, every level gives the same hash
+u64 simd_hash(cstr src, const usize length, const SimdLevel) noexcept;
+
+// windowed view of the stage 1 masks, refilled as stage 2 moves forward
+class StructuralIndex
+{
+    cstr src;
+    uint length, num_blocks;
+    uint first_block = 0, last_block = 0;
+    uint cursor_block        = UINT_MAX; // block of the last `skip`, reset by `fill`
+    const BlockMasks *cursor = nullptr;
+    SimdLevel level;
+    BlockMasks window[SIMD_WINDOW_BLOCKS];
+
+    void fill(const uint block) noexcept;
+
+    public:
+    StructuralIndex(cstr src, const uint length, const SimdLevel level);
+    ~StructuralIndex() = default;
+
+    const BlockMasks &block(const uint b) noexcept
+    {
+        if (b < first_block || b >= last_block) fill(b);
+        return window[b - first_block];
+    }
+
+    bool is_set(const BlockMask m, const uint pos) noexcept
+    {
+        return (block(pos / SIMD_BLOCK_SIZE).*m >> (pos % SIMD_BLOCK_SIZE)) & 1;
+    }
+
+    // first position >= pos where the mask bit is set, `length` if none
+    uint next_set(const BlockMask, const uint pos) noexcept;
+    // first position >= pos where the mask bit is clear
+    uint next_clear(const BlockMask, const uint pos) noexcept;
+
+    // next_clear for stage 2: one tzcnt while `pos` stays in the block of the previous
+    // call, the window is only looked up when a token start crosses into another block
+    uint skip(const BlockMask m, const uint pos) noexcept
+    {
+        const uint b = pos / SIMD_BLOCK_SIZE;
+        if (b != cursor_block)
+        {
+            cursor       = &block(b);
+            cursor_block = b;
+        }
+        const u64 bits = ~(cursor->*m) >> (pos % SIMD_BLOCK_SIZE);
+        if (bits) return pos + (uint)__builtin_ctzll(bits);
+        return next_clear(m, (b + 1) * SIMD_BLOCK_SIZE);
+    }
+};
+
+} // namespace rotate
@@ -0,0 +1,117 @@
+#include "strings.hpp"
+#include "literals.hpp"
+
+namespace rotate
+{
+
+StringPool::StringPool() : bytes(256), entries(16)
+{
+    slot_mask = STRING_MIN_SLOTS - 1;
+    slots     = static_cast<u32 *>(array::heap_alloc(STRING_MIN_SLOTS * sizeof(u32)));
+    memset(slots, 0xff, STRING_MIN_SLOTS * sizeof(u32));
+}
+
+StringPool::~StringPool()
+{
+    array::heap_free(slots, (slot_mask + 1) * sizeof(u32));
+}
+
+// doubles the slots once they are half full
+void
+StringPool::grow()
+{
+    const uint capacity = (slot_mask + 1) * 2;
+    array::heap_free(slots, (slot_mask + 1) * sizeof(u32));
+    slots = static_cast<u32 *>(array::heap_alloc(capacity * sizeof(u32)));
+    memset(slots, 0xff, capacity * sizeof(u32));
+    slot_mask = capacity - 1;
+
+    for (u32 id = 0; id < entries.count(); id++)
+    {
+        uint at = entries[id].hash & slot_mask;
+        while (slots[at] != STRING_VIEW)
+            at = (at + 1) & slot_mask;
+        slots[at] = id;
+    }
+}
+
+u32
+StringPool::insert(const u32 at, const u32 length)
+{
+    cstr value    = bytes.data() + at;
+    const u64 h64 = symbol_hash(value, length);
+    const u32 h   = (u32)(h64 ^ (h64 >> 32));
+    lookups++;
+
+    uint slot = h & slot_mask;
+    for (; slots[slot] != STRING_VIEW; slot = (slot + 1) & slot_mask)
+    {
+        const Entry &e = entries[slots[slot]];
+        if (e.hash == h && e.length == length && memcmp(bytes.data() + e.at, value, length) == 0)
+        {
+            // already pooled, the copy is dropped
+            hits++;
+            bytes.resize(at);
+            return slots[slot];
+        }
+    }
+
+    const u32 id = (u32)entries.count();
+    entries.append(Entry{at, length, h});
+    slots[slot] = id;
+    if (entries.count() * 2 > slot_mask + 1) grow();
+    return id;
+}
+
+u32
+StringPool::add_escaped(cstr body, const uint length)
+{
+    // decoded strings are never longer than their source
+    const u32 at = (u32)bytes.count();
+    bytes.resize(at + length + 1);
+    char *out = bytes.data() + at;
+    uint n    = 0;
+    for (uint i = 0; i < length; i++)
+    {
+        if (body[i] == '\\' && i + 1 < length) { out[n++] = decode_escape(body[++i]); }
+        else { out[n++] = body[i]; }
+    }
+    out[n] = '\0';
+    bytes.resize(at + n + 1);
+    return insert(at, n);
+}
+
+u32
+StringPool::add_value(cstr value, const uint length)
+{
+    const u32 at = (u32)bytes.count();
+    bytes.resize(at + length + 1);
+    memcpy(bytes.data() + at, value, length);
+    bytes[at + length] = '\0';
+    return insert(at, length);
+}
+
+StringView
+StringPool::value(cstr source, const uint offset, const uint length, const u32 payload) const
+{
+    if (payload != STRING_VIEW) return value(payload);
+    const uint quotes = string_quotes(source + offset, length);
+    return StringView{source + offset + quotes, length - 2 * quotes};
+}
+
+usize
+StringPool::memory() const
+{
+    return bytes.count() + entries.count() * sizeof(Entry) + (slot_mask + 1) * sizeof(u32);
+}
+
+void
+StringPool::clear()
+{
+    bytes.resize(0);
+    entries.resize(0);
+    memset(slots, 0xff, (slot_mask + 1) * sizeof(u32));
+    lookups = hits = 0;
+}
+
+} // namespace rotate
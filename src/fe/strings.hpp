@@ -0,0 +1,84 @@
+#pragma once
+
+#include "symbols.hpp"
+
+namespace rotate
+{
+
+/*
+ *  StringPool: values of the string literals that contain escapes
+ *  - a string without escapes is a view into the source (zero copy), its
+ *    token's payload is STRING_VIEW and its value is the token minus quotes
+ *  - a string with escapes is decoded once by the lexer, equal values share
+ *    one id, the token's payload is that id
+ *  - decoded values are NUL terminated but may contain NUL bytes
+ */
+
+constexpr u32 STRING_VIEW       = UINT32_MAX;
+constexpr uint STRING_MIN_SLOTS = 64; // power of 2
+
+struct StringView
+{
+    cstr data;
+    uint length;
+};
+
+class StringPool
+{
+    struct Entry
+    {
+        u32 at; // in `bytes`
+        u32 length;
+        u32 hash;
+    };
+
+    Array<char> bytes;
+    Array<Entry> entries; // by id
+    u32 *slots     = nullptr;
+    uint slot_mask = 0;
+    usize lookups  = 0, hits = 0;
+
+    u32 insert(const u32 at, const u32 length); // dedups the value at the end of `bytes`
+    void grow();
+
+    public:
+    StringPool();
+    ~StringPool();
+    StringPool(const StringPool &)            = delete;
+    StringPool &operator=(const StringPool &) = delete;
+
+    // decodes the escapes of `body` (the string between its quotes)
+    u32 add_escaped(cstr body, const uint length);
+    // an already decoded value
+    u32 add_value(cstr value, const uint length);
+
+    // NOTE: the pointers are invalidated by the next `add_escaped`
+    StringView value(const u32 id) const
+    {
+        return StringView{bytes.data() + entries[id].at, entries[id].length};
+    }
+    // value of a string token lexed from `source`
+    StringView value(cstr source, const uint offset, const uint length, const u32 payload) const;
+
+    usize count() const { return entries.count(); }
+    usize lookup_count() const { return lookups; }
+    usize hit_count() const { return hits; }
+    usize memory() const;
+
+    void clear();
+    // lookups that found their value without `add_value` (see TokenStream::assign)
+    void count_hits(const usize n)
+    {
+        lookups += n;
+        hits += n;
+    }
+};
+
+// number of quotes around a string token: 3 for """multi-line""" strings, else 1
+inline uint
+string_quotes(cstr token, const uint length)
+{
+    return length >= 6 && token[1] == '"' && token[2] == '"' ? 3 : 1;
+}
+
+} // namespace rotate
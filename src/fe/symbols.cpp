@@ -0,0 +1,140 @@
+#include "symbols.hpp"
+
+namespace rotate
+{
+
+SymbolTable::SymbolTable() : refs(SYMBOL_MIN_SLOTS / 2), chunks(4)
+{
+    slot_mask = SYMBOL_MIN_SLOTS - 1;
+    slots     = static_cast<Slot *>(array::heap_alloc(SYMBOL_MIN_SLOTS * sizeof(Slot)));
+    memset(slots, 0xff, SYMBOL_MIN_SLOTS * sizeof(Slot));
+}
+
+SymbolTable::~SymbolTable()
+{
+    array::heap_free(slots, (slot_mask + 1) * sizeof(Slot));
+    for (usize i = 0; i < chunks.count(); i++)
+        array::heap_free(chunks[i], SYMBOL_ARENA_CHUNK);
+}
+
+// copies the name into the arena, returns its ref
+u32
+SymbolTable::store(const u32 id, cstr str, const uint length)
+{
+    // entries stay 4 byte aligned
+    const uint size = (uint)(sizeof(Entry) + length + 1 + 3) & ~3u;
+    ASSERT(size <= SYMBOL_ARENA_CHUNK, "symbol does not fit in an arena chunk");
+    if (chunk_used + size > SYMBOL_ARENA_CHUNK)
+    {
+        ASSERT(chunks.count() < 0x10000, "symbol arena is full");
+        chunks.append(static_cast<char *>(array::heap_alloc(SYMBOL_ARENA_CHUNK)));
+        chunk_used = 0;
+    }
+
+    const u32 ref = (u32)(chunks.count() - 1) << 16 | chunk_used;
+    char *at      = chunks[chunks.count() - 1] + chunk_used;
+    const Entry e = {id, length};
+    memcpy(at, &e, sizeof(Entry));
+    memcpy(at + sizeof(Entry), str, length);
+    at[sizeof(Entry) + length] = '\0';
+    chunk_used += size;
+    return ref;
+}
+
+// doubles the slots once they are half full
+void
+SymbolTable::grow()
+{
+    const Slot *old     = slots;
+    const uint old_size = slot_mask + 1;
+    slots               = static_cast<Slot *>(array::heap_alloc(old_size * 2 * sizeof(Slot)));
+    memset(slots, 0xff, old_size * 2 * sizeof(Slot));
+    slot_mask = old_size * 2 - 1;
+
+    for (uint i = 0; i < old_size; i++)
+    {
+        if (old[i].ref == SYMBOL_NONE) continue;
+        uint at = old[i].hash & slot_mask;
+        while (slots[at].ref != SYMBOL_NONE)
+            at = (at + 1) & slot_mask;
+        slots[at] = old[i];
+    }
+    array::heap_free(const_cast<Slot *>(old), old_size * sizeof(Slot));
+}
+
+// NOTE: `stored` is NUL terminated and `str` is an identifier (no NUL byte)
+static inline bool
+same_name(cstr stored, cstr str, const uint length)
+{
+    uint i = 0;
+    for (; i + sizeof(u64) <= length; i += sizeof(u64))
+    {
+        u64 a, b;
+        memcpy(&a, stored + i, sizeof(u64));
+        memcpy(&b, str + i, sizeof(u64));
+        if (a != b) return false;
+    }
+    for (; i < length; i++)
+        if (stored[i] != str[i]) return false;
+    return stored[length] == '\0';
+}
+
+u32
+SymbolTable::intern(cstr str, const uint length, const u64 hash)
+{
+    const u32 h = (u32)(hash ^ (hash >> 32));
+    lookups++;
+    uint at = h & slot_mask;
+    for (; slots[at].ref != SYMBOL_NONE; at = (at + 1) & slot_mask)
+    {
+        if (slots[at].hash != h) continue;
+        const Entry *e = entry(slots[at].ref);
+        if (same_name(reinterpret_cast<cstr>(e + 1), str, length))
+        {
+            hits++;
+            return e->id;
+        }
+    }
+
+    const u32 id  = (u32)refs.count();
+    const u32 ref = store(id, str, length);
+    refs.append(ref);
+    slots[at] = Slot{h, ref};
+    if (refs.count() * 2 > slot_mask + 1) grow();
+    return id;
+}
+
+u32
+SymbolTable::find(cstr str, const uint length) const
+{
+    const u64 hash = symbol_hash(str, length);
+    const u32 h    = (u32)(hash ^ (hash >> 32));
+    for (uint at = h & slot_mask; slots[at].ref != SYMBOL_NONE; at = (at + 1) & slot_mask)
+    {
+        if (slots[at].hash != h) continue;
+        const Entry *e = entry(slots[at].ref);
+        if (same_name(reinterpret_cast<cstr>(e + 1), str, length)) return e->id;
+    }
+    return SYMBOL_NONE;
+}
+
+usize
+SymbolTable::memory() const
+{
+    return (slot_mask + 1) * sizeof(Slot) + refs.count() * sizeof(u32) +
+           chunks.count() * SYMBOL_ARENA_CHUNK;
+}
+
+void
+SymbolTable::clear()
+{
+    refs.resize(0);
+    memset(slots, 0xff, (slot_mask + 1) * sizeof(Slot));
+    for (usize i = 0; i < chunks.count(); i++)
+        array::heap_free(chunks[i], SYMBOL_ARENA_CHUNK);
+    chunks.resize(0);
+    chunk_used = SYMBOL_ARENA_CHUNK;
+    lookups = hits = 0;
+}
+
+} // namespace rotate
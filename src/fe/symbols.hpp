@@ -0,0 +1,177 @@
+#pragma once
+
+#include "../include/common.hpp"
+#include "charclass.hpp"
+
+namespace rotate
+{
+
+/*
+ *  SymbolTable: interned identifiers
+ *  - every distinct identifier gets a dense u32 id (in order of first
+ *    appearance), identifier tokens carry it as their payload so later
+ *    stages compare names by integer
+ *  - the hash is computed by the lexer in the same pass that finds the end
+ *    of the identifier (`scan_ident_hashed`), a word at a time
+ *  - open addressing with linear probing, a slot keeps the hash and where
+ *    the name is, so most mismatches are rejected without touching the bytes
+ *    and a hit reads the name right after its slot
+ *  - names are copied into a bump arena of fixed size chunks and never move,
+ *    each one after its id and length and NUL terminated
+ */
+
+constexpr u64 SYMBOL_HASH_SEED    = 0x2545f4914f6cdd1dull;
+constexpr uint SYMBOL_MIN_SLOTS   = 256;       // power of 2
+constexpr uint SYMBOL_ARENA_CHUNK = 64 * 1024; // a name's place fits in 16 bits
+constexpr u32 SYMBOL_NONE         = UINT32_MAX;
+inline u64
+symbol_hash_word(const u64 h, const u64 word)
+{
+    const u64 x = (h ^ word) * 0x9e3779b97f4a7c15ull;
+    return x ^ (x >> 29);
+}
+
+inline u64
+symbol_hash_finish(const u64 h, const uint length)
+{
+    return symbol_hash_word(h, length);
+}
+
+// hash of `length` bytes, the last word is zero padded
+inline u64
+symbol_hash(cstr str, const uint length)
+{
+    u64 h    = SYMBOL_HASH_SEED;
+    uint pos = 0;
+    for (; pos + sizeof(u64) <= length; pos += sizeof(u64))
+    {
+        u64 w;
+        memcpy(&w, str + pos, sizeof(u64));
+        h = symbol_hash_word(h, w);
+    }
+    if (pos < length)
+    {
+        u64 w = 0;
+        memcpy(&w, str + pos, length - pos);
+        h = symbol_hash_word(h, w);
+    }
+    return symbol_hash_finish(h, length);
+}
+
+// `symbol_hash` when `readable` bytes can be read at `str` (an identifier whose end is
+// already known), the last word is loaded whole and masked instead of copied bytewise
+inline u64
+symbol_hash_readable(cstr str, const uint length, const uint readable)
+{
+    if (readable < ((length + sizeof(u64) - 1) & ~(uint)(sizeof(u64) - 1)))
+        return symbol_hash(str, length);
+    u64 h    = SYMBOL_HASH_SEED;
+    uint pos = 0;
+    for (; pos + sizeof(u64) <= length; pos += sizeof(u64))
+    {
+        u64 w;
+        memcpy(&w, str + pos, sizeof(u64));
+        h = symbol_hash_word(h, w);
+    }
+    if (pos < length)
+    {
+        u64 w;
+        memcpy(&w, str + pos, sizeof(u64));
+        h = symbol_hash_word(h, w & ((1ull << (8 * (length - pos))) - 1));
+    }
+    return symbol_hash_finish(h, length);
+}
+
+// `scan_ident_run` from the first byte of the identifier that also hashes it,
+// the result is the same as `symbol_hash` over the run
+inline uint
+scan_ident_hashed(cstr src, const uint start, const uint readable, u64 *hash)
+{
+    u64 h    = SYMBOL_HASH_SEED;
+    uint pos = start;
+    while (pos + sizeof(u64) <= readable)
+    {
+        u64 w;
+        memcpy(&w, src + pos, sizeof(u64));
+        const u64 stop = ~swar_ident(w) & cc::HIGH;
+        if (stop)
+        {
+            const uint n = (uint)__builtin_ctzll(stop) >> 3;
+            if (n) h = symbol_hash_word(h, w & ((1ull << (8 * n)) - 1));
+            *hash = symbol_hash_finish(h, pos + n - start);
+            return pos + n;
+        }
+        h = symbol_hash_word(h, w);
+        pos += sizeof(u64);
+    }
+
+    // NOTE: the run ends in the NUL padding, so less than a word is left
+    u64 w  = 0;
+    uint n = 0;
+    for (; char_is(src[pos + n], CC_IDENT); n++)
+        w |= (u64)(u8)src[pos + n] << (8 * n);
+    if (n) h = symbol_hash_word(h, w);
+    *hash = symbol_hash_finish(h, pos + n - start);
+    return pos + n;
+}
+
+class SymbolTable
+{
+    // NOTE: followed by the name in the arena
+    struct Entry
+    {
+        u32 id;
+        u32 length;
+    };
+    struct Slot
+    {
+        u32 hash;
+        u32 ref; // arena chunk << 16 | offset of the entry, SYMBOL_NONE if empty
+    };
+
+    Array<u32> refs; // by id
+    Slot *slots    = nullptr;
+    uint slot_mask = 0;
+    Array<char *> chunks; // arena
+    uint chunk_used = SYMBOL_ARENA_CHUNK;
+    usize lookups   = 0, hits = 0;
+
+    const Entry *entry(const u32 ref) const
+    {
+        return reinterpret_cast<const Entry *>(chunks[ref >> 16] + (ref & 0xffff));
+    }
+    u32 store(const u32 id, cstr str, const uint length);
+    void grow();
+
+    public:
+    SymbolTable();
+    ~SymbolTable();
+    SymbolTable(const SymbolTable &)            = delete;
+    SymbolTable &operator=(const SymbolTable &) = delete;
+
+    // id of the identifier, a new one if it was never seen
+    u32 intern(cstr str, const uint length, const u64 hash);
+    u32 intern(cstr str, const uint length)
+    {
+        return intern(str, length, symbol_hash(str, length));
+    }
+    // SYMBOL_NONE if the identifier was never interned
+    u32 find(cstr str, const uint length) const;
+
+    cstr name(const u32 id) const { return reinterpret_cast<cstr>(entry(refs[id]) + 1); }
+    uint length(const u32 id) const { return entry(refs[id])->length; }
+    usize count() const { return refs.count(); }
+    usize lookup_count() const { return lookups; }
+    usize hit_count() const { return hits; }
+    usize memory() const; // slots, ids and arena chunks
+
+    void clear();
+    // lookups that found their symbol without `intern` (see TokenStream::assign)
+    void count_hits(const usize n)
+    {
+        lookups += n;
+        hits += n;
+    }
+};
+
+} // namespace rotate
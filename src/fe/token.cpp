@@ -1,4 +1,5 @@
 #include "token.hpp"
+#include "token_stream.hpp"
 
 // TODO: convert tokens to cstring funcs
 namespace rotate
@@ -76,10 +77,10 @@ tkn_type_describe(const TknType type) noexcept
 }
 
 cstr
-get_keyword_or_type(cstr string, const Token &tkn)
+get_keyword_or_type(const TokenStream *tokens, const TknIdx i)
 {
 
-    switch (tkn.type)
+    switch (tokens->type(i))
     {
         case TknType::As: return "as";
         case TknType::In: return "in";
@@ -136,13 +137,14 @@ get_keyword_or_type(cstr string, const Token &tkn)
         case TknType::Comma: return ",";
         case TknType::Void: return "void";
         case TknType::EOT: return "end_of_tokens";
+        // NOTE: interned, owned by the stream
+        case TknType::Identifier: return tokens->symbols()->name(tokens->payload(i));
         case TknType::Integer:
         case TknType::Float:
-        case TknType::Identifier:
         case TknType::String:
         case TknType::Char:
         case TknType::BuiltinFunc:
-            return strndup(string + tkn.index, tkn.length);
+            return strndup(tokens->source() + tokens->offset(i), tokens->length(i));
             /*default: {
                 return "TODO: IMPLEMENT";
             }*/
@@ -169,6 +171,9 @@ lexer_err_msg(const LexErr error) noexcept
         case LexErr::NOT_VALID_ESCAPE_CHAR: return "Invalid escaped char";
         case LexErr::WINDOWS_CRAP: return "Windows style files are not accepted \\r";
         case LexErr::NOT_CLOSED_COMMENT: return "Comment not closed";
+        case LexErr::NUMBER_OUT_OF_RANGE: return "Integer does not fit in 64 bits";
+        case LexErr::INVALID_UTF8: return "Invalid UTF-8 byte sequence";
+        case LexErr::NON_ASCII: return "Non ascii character";
         case LexErr::UNSUPPORTED: break;
         case LexErr::UNKNOWN: break;
     }
@@ -182,6 +187,7 @@ lexer_err_advice(const LexErr error) noexcept
     {
         case LexErr::NOT_VALID_ESCAPE_CHAR: return "Change the letter after \\";
         case LexErr::NOT_CLOSED_COMMENT: return "Close the comment with delimiter";
+        case LexErr::NUMBER_OUT_OF_RANGE: return "Integers must not exceed 18446744073709551615";
         case LexErr::LEXER_INVALID_CHAR: return "remove this character";
         case LexErr::OUT_OF_MEMORY: return "The compiler needs more memory";
         case LexErr::TOO_LONG_IDENTIFIER: return "Identifier must not exceed 100 characters";
@@ -194,6 +200,8 @@ lexer_err_advice(const LexErr error) noexcept
         case LexErr::BAD_TOKEN_AT_GLOBAL: return "Do not put this token in global scope";
         case LexErr::TABS: return "Convert the tabs to spaces";
         case LexErr::WINDOWS_CRAP: return "Files must be LF style";
+        case LexErr::INVALID_UTF8: return "Save the file as UTF-8";
+        case LexErr::NON_ASCII: return "Only ascii is accepted with --ascii";
         case LexErr::UNSUPPORTED: break;
         case LexErr::UNKNOWN: break;
     }
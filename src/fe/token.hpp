@@ -75,15 +75,26 @@ enum class TknType : u8
     EOT,              // EOT - END OF TOKENS
 };                    // enum TknType
 
+// the tokens, values and errors sources lex to; bump it with every change of the
+// lexer's output (a token type, an escape, a number rule...), the token cache keys
+// its files by it, so images of an older lexer are misses
+// 2: unknown escapes in strings are errors, 3: `0..2` is Integer To Integer
+constexpr u32 LEXER_VERSION = 3;
+static_assert((u32)TknType::EOT == 60, "a new token type changes the output, bump LEXER_VERSION");
+
 cstr tkn_type_describe(const TknType type) noexcept;
 
 struct Token
 {
-    uint index, length, line;
+    uint index, length;
     TknType type;
+    // by type: Integer, Float and Char the index of the value in the LiteralPool,
+    // Identifier the SymbolTable id, String the StringPool id (STRING_VIEW without
+    // escapes); 0 for every other type
+    u32 payload;
 
-    Token(uint index, uint length, uint line, TknType type)
-        : index(index), length(length), line(line), type(type)
+    Token(uint index, uint length, TknType type, u32 payload = 0)
+        : index(index), length(length), type(type), payload(payload)
     {
     }
 };
@@ -114,10 +125,14 @@ enum class LexErr : u8
     // forbidden token in global scope
     BAD_TOKEN_AT_GLOBAL,
     NOT_CLOSED_COMMENT,
+    // integer literal above 64 bits
+    NUMBER_OUT_OF_RANGE,
+    // bytes that are not UTF-8, or not ASCII in strict mode
+    INVALID_UTF8,
+    NON_ASCII,
     UNSUPPORTED,
 }; // enum LexErr
 
-cstr get_keyword_or_type(cstr, const Token &);
 cstr lexer_err_advice(const LexErr) noexcept;
 cstr lexer_err_msg(const LexErr) noexcept;
 bool is_token_type_length_variable(TknType);
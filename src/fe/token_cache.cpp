@@ -0,0 +1,193 @@
+#include "token_cache.hpp"
+#include "simd.hpp"
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace rotate
+{
+
+static const char TOKEN_CACHE_MAGIC[4] = {'V', 'R', 'T', 'C'};
+
+TokenCacheHit::~TokenCacheHit()
+{
+#ifdef __linux__
+    if (mapped) munmap(const_cast<char *>(image - sizeof(TokenCacheHeader)), mapped);
+#endif
+}
+
+TokenCache::TokenCache(const bool enabled, cstr directory)
+{
+#ifdef __linux__
+    if (!enabled) return;
+    if (directory) { snprintf(dir, sizeof(dir), "%s", directory); }
+    else if (cstr xdg = getenv("XDG_CACHE_HOME"))
+    {
+        if (xdg[0]) snprintf(dir, sizeof(dir), "%s/rotate", xdg);
+    }
+    if (!dir[0])
+    {
+        cstr home = getenv("HOME");
+        if (home && home[0]) snprintf(dir, sizeof(dir), "%s/.cache/rotate", home);
+    }
+#else
+    UNUSED(enabled);
+    UNUSED(directory);
+#endif
+}
+
+u64
+TokenCache::hash(cstr contents, const uint length)
+{
+    return simd_hash(contents, length, simd_detect());
+}
+
+TokenCacheKey
+TokenCache::key(cstr contents, const uint length)
+{
+    TokenCacheKey key;
+    key.hash   = hash(contents, length);
+    key.length = length;
+    digest(contents, length, key.digest);
+    return key;
+}
+
+// "/<16 hex digits>.vrtc"
+static const uint TOKEN_CACHE_NAME = 22;
+
+bool
+TokenCache::path(char *out, const u64 hash) const
+{
+    // a directory too long for the file name is a miss, never a truncated path
+    const int bound = (int)(TOKEN_CACHE_PATH - TOKEN_CACHE_NAME - 1);
+    if (strlen(dir) > (usize)bound) return false;
+    const int n = snprintf(out, TOKEN_CACHE_PATH, "%.*s/%016llx.vrtc", bound, dir,
+                           (unsigned long long)hash);
+    return n > 0 && n < (int)TOKEN_CACHE_PATH;
+}
+
+#ifdef __linux__
+
+bool
+TokenCache::find(const TokenCacheKey *key, TokenCacheHit *hit) const
+{
+    if (!enabled()) return false;
+    char name[TOKEN_CACHE_PATH];
+    if (!path(name, key->hash)) return false;
+    const int fd = open(name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    // the header is checked before the image is mapped
+    TokenCacheHeader header;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+        memcmp(header.magic, TOKEN_CACHE_MAGIC, 4) != 0 || header.version != TOKEN_CACHE_VERSION ||
+        header.hash != key->hash || header.source_length != key->length ||
+        header.types != (u32)TknType::EOT + 1 ||
+        memcmp(header.digest, key->digest, DIGEST_BYTES) != 0 ||
+        (u64)st.st_size != sizeof(header) + header.image_bytes)
+    {
+        close(fd);
+        return false;
+    }
+    // the whole image is copied out right away, its pages are read in up front
+    void *view = mmap(nullptr, (usize)st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) return false;
+
+    hit->image  = static_cast<cstr>(view) + sizeof(header);
+    hit->bytes  = header.image_bytes;
+    hit->tokens = header.tokens;
+    hit->mapped = (usize)st.st_size;
+    return true;
+}
+
+// mkdir -p
+static bool
+make_directories(cstr dir)
+{
+    char path[TOKEN_CACHE_PATH];
+    snprintf(path, sizeof(path), "%s", dir);
+    for (char *at = path + 1;; at++)
+    {
+        if (*at != '/' && *at != '\0') continue;
+        const char end = *at;
+        *at            = '\0';
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) return false;
+        if (!end) return true;
+        *at = '/';
+    }
+}
+
+u8
+TokenCache::store(const TokenCacheKey *key, const TokenStream *tokens) const
+{
+    if (!enabled()) return FAILURE;
+    static u32 stores = 0; // temporary names of the threads of a batch differ
+    char name[TOKEN_CACHE_PATH], temporary[TOKEN_CACHE_PATH + 32];
+    if (!path(name, key->hash)) return FAILURE;
+    snprintf(temporary, sizeof(temporary), "%s.%d.%u", name, (int)getpid(),
+             __atomic_fetch_add(&stores, 1, __ATOMIC_RELAXED));
+
+    int fd = open(temporary, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0 && errno == ENOENT && make_directories(dir))
+        fd = open(temporary, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return FAILURE;
+
+    // the image is written straight into the file's pages, allocated up front
+    // so a full disk fails here instead of faulting in `write_image`
+    const usize image = tokens->image_bytes();
+    const usize total = sizeof(TokenCacheHeader) + image;
+    void *view        = MAP_FAILED;
+    if (posix_fallocate(fd, 0, (off_t)total) == 0)
+        view = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED)
+    {
+        unlink(temporary);
+        return FAILURE;
+    }
+
+    TokenCacheHeader header;
+    memcpy(header.magic, TOKEN_CACHE_MAGIC, 4);
+    header.version       = TOKEN_CACHE_VERSION;
+    header.hash          = key->hash;
+    header.image_bytes   = image;
+    header.tokens        = tokens->count();
+    header.source_length = key->length;
+    header.types         = (u32)TknType::EOT + 1;
+    memcpy(header.digest, key->digest, DIGEST_BYTES);
+    memcpy(view, &header, sizeof(header));
+    tokens->write_image(static_cast<char *>(view) + sizeof(header));
+    munmap(view, total);
+
+    if (rename(temporary, name) != 0)
+    {
+        unlink(temporary);
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+#else
+
+bool
+TokenCache::find(const TokenCacheKey *, TokenCacheHit *) const
+{
+    return false;
+}
+
+u8
+TokenCache::store(const TokenCacheKey *, const TokenStream *) const
+{
+    return FAILURE;
+}
+
+#endif // __linux__
+
+} // namespace rotate
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "../include/digest.hpp"
+#include "token_stream.hpp"
+
+namespace rotate
+{
+
+/*
+ *  TokenCache: lexed token streams kept on disk between compilations
+ *  - a source is keyed by `simd_hash` of its contents, its tokens are in
+ *    `<dir>/<hash>.vrtc`: a TokenCacheHeader then the stream image (see
+ *    TokenStream::write_image), read back through a read-only mapping
+ *  - the header repeats the hash and the source length and records the
+ *    format and lexer versions and the number of token types, any mismatch is a miss
+ *  - the 64-bit hash only names the file, the header also holds a BLAKE2b
+ *    digest of the source, so a hash collision is a miss and never the tokens
+ *    of another source
+ *    and the next store replaces the file
+ *  - files are written under a temporary name and renamed into place, so
+ *    compilers running at the same time never see a partial file
+ *  - the directory is $XDG_CACHE_HOME/rotate, else ~/.cache/rotate
+ *  - opt-in with --cache or --cache-dir, a plain compile writes no files
+ *  Linux only, the cache is disabled elsewhere
+ */
+
+// the layout of the header and of the stream image
+constexpr u32 TOKEN_IMAGE_VERSION = 2;
+// a file is only read back by the same layout and the same lexer
+constexpr u32 TOKEN_CACHE_VERSION = TOKEN_IMAGE_VERSION << 16 | LEXER_VERSION;
+static_assert(LEXER_VERSION < 1u << 16, "LEXER_VERSION is the low half of TOKEN_CACHE_VERSION");
+constexpr uint TOKEN_CACHE_PATH   = 1024;
+
+struct TokenCacheHeader
+{
+    char magic[4]; // "VRTC"
+    u32 version;
+    u64 hash;
+    u64 image_bytes;
+    u64 tokens;
+    u32 source_length;
+    u32 types; // TknType::EOT + 1 when written
+    u8 digest[DIGEST_BYTES];
+};
+
+// what a source is looked up by, see `TokenCache::key`
+struct TokenCacheKey
+{
+    u64 hash;
+    uint length;
+    u8 digest[DIGEST_BYTES];
+};
+
+// a cache file found for a source, mapped until destroyed
+struct TokenCacheHit
+{
+    cstr image   = nullptr; // the stream image, after the header
+    usize bytes  = 0;
+    usize tokens = 0;
+    usize mapped = 0; // bytes of the mapping, it starts at the header
+
+    TokenCacheHit() = default;
+    ~TokenCacheHit();
+    TokenCacheHit(const TokenCacheHit &)            = delete;
+    TokenCacheHit &operator=(const TokenCacheHit &) = delete;
+};
+
+class TokenCache
+{
+    char dir[TOKEN_CACHE_PATH] = {0}; // empty when disabled
+
+    // false when the directory leaves no room for the file name
+    bool path(char *out, const u64 hash) const;
+
+    public:
+    // `dir` nullptr for the default directory
+    TokenCache(const bool enabled, cstr dir = nullptr);
+    ~TokenCache() = default;
+
+    bool enabled() const { return dir[0] != '\0'; }
+    cstr directory() const { return dir; }
+
+    static u64 hash(cstr contents, const uint length);
+    // the hash and the digest of a source
+    static TokenCacheKey key(cstr contents, const uint length);
+    // maps the tokens of the source of `key`, false on a miss
+    bool find(const TokenCacheKey *key, TokenCacheHit *hit) const;
+    // writes the tokens of a source, the directory is created when missing
+    u8 store(const TokenCacheKey *key, const TokenStream *tokens) const;
+};
+
+} // namespace rotate
@@ -0,0 +1,874 @@
+#include "token_stream.hpp"
+
+namespace rotate
+{
+
+// NOTE: indexed by TknType, keep in the same order as the enum
+static const u8 TKN_TYPE_LENGTHS[] = {
+    TKN_VARIABLE_LENGTH, // Identifier
+    TKN_VARIABLE_LENGTH, // BuiltinFunc
+    2,                   // To
+    2,                   // In
+    2,                   // As
+    6,                   // Delete
+    1,                   // Equal
+    TKN_VARIABLE_LENGTH, // Integer
+    3,                   // IntKeyword
+    4,                   // UintKeyword
+    TKN_VARIABLE_LENGTH, // Float
+    5,                   // FloatKeyword
+    TKN_VARIABLE_LENGTH, // String
+    TKN_VARIABLE_LENGTH, // Char
+    4,                   // CharKeyword
+    4,                   // True
+    5,                   // False
+    4,                   // BoolKeyword
+    1,                   // Terminator
+    1,                   // Colon
+    2,                   // Function
+    1,                   // PLUS
+    1,                   // MINUS
+    1,                   // Star
+    1,                   // DIV
+    1,                   // OpenParen
+    1,                   // CloseParen
+    1,                   // OpenCurly
+    1,                   // CloseCurly
+    1,                   // OpenSQRBrackets
+    1,                   // CloseSQRBrackets
+    6,                   // Return
+    6,                   // Import
+    2,                   // If
+    4,                   // Else
+    3,                   // For
+    5,                   // While
+    1,                   // Greater
+    2,                   // GreaterEql
+    1,                   // Less
+    2,                   // LessEql
+    1,                   // Dot
+    1,                   // Not
+    2,                   // NotEqual
+    3,                   // And
+    2,                   // Or
+    1,                   // Comma
+    3,                   // Public
+    6,                   // Switch
+    4,                   // Enum
+    2,                   // EqualEqual
+    5,                   // Break
+    2,                   // AddEqual
+    2,                   // SubEqual
+    2,                   // MultEqual
+    2,                   // DivEqual
+    6,                   // Struct
+    3,                   // Ref
+    3,                   // Nil
+    4,                   // Void
+    0,                   // EOT
+};
+static_assert(sizeof(TKN_TYPE_LENGTHS) == (usize)TknType::EOT + 1,
+              "TKN_TYPE_LENGTHS must have an entry for every TknType");
+
+u8
+tkn_type_length(const TknType type) noexcept
+{
+    return TKN_TYPE_LENGTHS[(u8)type];
+}
+
+bool
+is_token_type_length_variable(TknType type)
+{
+    return TKN_TYPE_LENGTHS[(u8)type] == TKN_VARIABLE_LENGTH;
+}
+
+TokenStream::TokenStream(cstr source, usize capacity, Arena *arena)
+    : src(source), types(capacity < TKN_MIN_CAPACITY ? TKN_MIN_CAPACITY : capacity, arena),
+      offsets(capacity < TKN_MIN_CAPACITY ? TKN_MIN_CAPACITY : capacity, arena),
+      var_lengths(capacity / 2 < TKN_MIN_CAPACITY ? TKN_MIN_CAPACITY : capacity / 2, arena),
+      payloads(capacity / 2 < TKN_MIN_CAPACITY ? TKN_MIN_CAPACITY : capacity / 2, arena),
+      ranks(capacity / TKN_BLOCK + 1, arena), var_bits(capacity / TKN_BLOCK + 1, arena),
+      long_lengths(1, arena)
+{
+    ASSERT_NULL(source, "TokenStream source is a null pointer");
+}
+
+void
+TokenStream::push(const TknType type, const uint index, const uint length, const u32 payload)
+{
+    const usize n = types.count();
+    if (n % TKN_BLOCK == 0)
+    {
+        ranks.append((uint)var_lengths.count());
+        var_bits.append(0);
+    }
+
+    types.append(type);
+    offsets.append(index);
+
+    const u8 fixed = TKN_TYPE_LENGTHS[(u8)type];
+    if (fixed == TKN_VARIABLE_LENGTH)
+    {
+        var_bits[n / TKN_BLOCK] |= 1ull << (n % TKN_BLOCK);
+        payloads.append(payload);
+        if (length < TKN_LONG_LENGTH) { var_lengths.append((u16)length); }
+        else
+        {
+            var_lengths.append(TKN_LONG_LENGTH);
+            long_lengths.append(LongLength{(TknIdx)n, length});
+        }
+    }
+#if DEBUG
+    else { ASSERT_CMP(fixed, length, "fixed length token with an unexpected length"); }
+#endif
+}
+
+uint
+TokenStream::rank(const TknIdx i) const
+{
+    const u64 before = var_bits[i / TKN_BLOCK] & ((1ull << (i % TKN_BLOCK)) - 1);
+    return ranks[i / TKN_BLOCK] + (uint)__builtin_popcountll(before);
+}
+
+uint
+TokenStream::length(const TknIdx i) const
+{
+    const u8 fixed = TKN_TYPE_LENGTHS[(u8)types[i]];
+    if (fixed != TKN_VARIABLE_LENGTH) return fixed;
+
+    const u16 len = var_lengths[rank(i)];
+    if (len != TKN_LONG_LENGTH) return len;
+
+    // binary search the rare long tokens (pushed in order)
+    usize lo = 0, hi = long_lengths.count();
+    while (lo < hi)
+    {
+        const usize mid = (lo + hi) / 2;
+        if (long_lengths[mid].token < i)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return long_lengths[lo].length;
+}
+
+u32
+TokenStream::payload(const TknIdx i) const
+{
+    if (TKN_TYPE_LENGTHS[(u8)types[i]] != TKN_VARIABLE_LENGTH) return 0;
+    return payloads[rank(i)];
+}
+
+Token
+TokenStream::at(const TknIdx i) const
+{
+    return Token(offsets[i], length(i), types[i], payload(i));
+}
+
+StringView
+TokenStream::string(const TknIdx i) const
+{
+    return string_pool.value(src, offsets[i], length(i), payload(i));
+}
+
+TknIdx
+TokenStream::find(const uint offset) const
+{
+    usize lo = 0, hi = offsets.count();
+    while (lo < hi)
+    {
+        const usize mid = (lo + hi) / 2;
+        if (offsets[mid] < offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (TknIdx)lo;
+}
+
+uint
+TokenStream::var_before(const TknIdx i) const
+{
+    return i == types.count() ? (uint)var_lengths.count() : rank(i);
+}
+
+/*
+ *  assign: prefix sums of the range sizes give every range its place in the
+ *  output, so the ranges are copied in parallel; the block bitmaps are then
+ *  moved a word at a time and `ranks` is their popcount prefix sum
+ *  the values are rebuilt from the copied tokens only: every range first lists
+ *  the symbols and pooled strings its tokens use (in order of first use) and
+ *  counts its literals, the lists are then interned in range order, so ids and
+ *  literal indices are the ones a serial lex gives; tokens lexed speculatively
+ *  and dropped (inside a string or a comment) leave nothing behind
+ */
+
+struct TokenStream::CopyJob
+{
+    TokenStream *out;
+    TokenRange range;
+    usize token_at, var_at;
+    LiteralPool::Base base; // where the literals of the range go in `out`
+    LiteralPool::Base used; // literals of the range
+    u32 *symbols = nullptr; // old symbol id -> new id, SYMBOL_NONE if unused
+    u32 *strings = nullptr; // old pooled string id -> new id, likewise
+    u32 *order   = nullptr; // symbol ids then string ids, in order of first use
+    uint used_symbols = 0, used_strings = 0;
+    usize identifiers = 0, escaped = 0; // tokens, for the lookup statistics
+};
+
+// lists the values the tokens of a range use
+void
+TokenStream::scan_range(void *ptr)
+{
+    CopyJob *job           = static_cast<CopyJob *>(ptr);
+    const TokenStream *src = job->range.stream;
+    const usize symbols = src->symbol_table.count(), strings = src->string_pool.count();
+    job->symbols = new u32[symbols + strings];
+    job->strings = job->symbols + symbols;
+    job->order   = new u32[symbols + strings];
+    memset(job->symbols, 0xff, (symbols + strings) * sizeof(u32));
+
+    u32 *strings_order = job->order + symbols;
+    const u32 *payload = src->payloads.data() + src->var_before(job->range.begin);
+    for (TknIdx i = job->range.begin; i < job->range.end; i++)
+    {
+        const TknType type = src->types[i];
+        if (TKN_TYPE_LENGTHS[(u8)type] != TKN_VARIABLE_LENGTH) continue;
+        const u32 value = *payload++;
+        switch (type)
+        {
+            case TknType::Identifier:
+                job->identifiers++;
+                if (job->symbols[value] != SYMBOL_NONE) break;
+                job->symbols[value]             = 0;
+                job->order[job->used_symbols++] = value;
+                break;
+            case TknType::String:
+                if (value == STRING_VIEW) break;
+                job->escaped++;
+                if (job->strings[value] != SYMBOL_NONE) break;
+                job->strings[value]                = 0;
+                strings_order[job->used_strings++] = value;
+                break;
+            case TknType::Integer: job->used.ints++; break;
+            case TknType::Float: job->used.floats++; break;
+            case TknType::Char: job->used.chars++; break;
+            default: break;
+        }
+    }
+}
+
+void
+TokenStream::copy_range(void *ptr)
+{
+    const CopyJob *job     = static_cast<const CopyJob *>(ptr);
+    const TokenStream *src = job->range.stream;
+    const TknIdx begin = job->range.begin, end = job->range.end;
+    const uint var_begin = src->var_before(begin), var_end = src->var_before(end);
+
+    memcpy(job->out->types.data() + job->token_at, src->types.data() + begin,
+           (end - begin) * sizeof(TknType));
+    if (job->range.shift == 0)
+    {
+        memcpy(job->out->offsets.data() + job->token_at, src->offsets.data() + begin,
+               (end - begin) * sizeof(uint));
+    }
+    else
+    {
+        uint *out       = job->out->offsets.data() + job->token_at;
+        const uint *in  = src->offsets.data() + begin;
+        const uint diff = (uint)job->range.shift; // wraps around for negative shifts
+        for (TknIdx i = 0; i < end - begin; i++)
+            out[i] = in[i] + diff;
+    }
+    memcpy(job->out->var_lengths.data() + job->var_at, src->var_lengths.data() + var_begin,
+           (var_end - var_begin) * sizeof(u16));
+
+    // the literals are copied in token order, right after the ones of the previous ranges
+    LiteralPool *literals   = &job->out->literal_pool;
+    const LiteralPool *from = &src->literal_pool;
+    LiteralPool::Base next  = job->base;
+    const u32 *in           = src->payloads.data() + var_begin;
+    u32 *payload            = job->out->payloads.data() + job->var_at;
+    for (TknIdx i = begin; i < end; i++)
+    {
+        const TknType type = src->types[i];
+        if (TKN_TYPE_LENGTHS[(u8)type] != TKN_VARIABLE_LENGTH) continue;
+        const u32 value = *in++;
+        switch (type)
+        {
+            case TknType::Identifier: *payload = job->symbols[value]; break;
+            case TknType::String:
+                *payload = value == STRING_VIEW ? STRING_VIEW : job->strings[value];
+                break;
+            case TknType::Integer:
+                literals->ints[next.ints] = from->ints[value];
+                *payload                  = next.ints++;
+                break;
+            case TknType::Float:
+                literals->floats[next.floats] = from->floats[value];
+                *payload                      = next.floats++;
+                break;
+            case TknType::Char:
+                literals->chars[next.chars] = from->chars[value];
+                *payload                    = next.chars++;
+                break;
+            default: *payload = value; break;
+        }
+        payload++;
+    }
+}
+
+// ORs n bits of `src` starting at bit `from` into `dst` at bit `at`
+static void
+copy_bits(u64 *dst, const usize dst_words, usize at, const u64 *src, const usize src_words,
+          usize from, usize n)
+{
+    while (n > 0)
+    {
+        const uint take = n < 64 ? (uint)n : 64;
+        const usize sw = from / 64, dw = at / 64;
+        const uint ss = from % 64, ds = at % 64;
+
+        u64 bits = src[sw] >> ss;
+        if (ss && sw + 1 < src_words) bits |= src[sw + 1] << (64 - ss);
+        if (take < 64) bits &= (1ull << take) - 1;
+        dst[dw] |= bits << ds;
+        if (ds && dw + 1 < dst_words) dst[dw + 1] |= bits >> (64 - ds);
+
+        at += take;
+        from += take;
+        n -= take;
+    }
+}
+
+void
+TokenStream::assign(const TokenRange *ranges, const uint count, ThreadPool *pool)
+{
+    Array<CopyJob> jobs(count);
+    usize tokens = 0, vars = 0;
+    for (uint r = 0; r < count; r++)
+    {
+        const TokenRange &range = ranges[r];
+        ASSERT(range.stream != this, "TokenStream assign from itself");
+        CopyJob job  = {};
+        job.out      = this;
+        job.range    = range;
+        job.token_at = tokens;
+        job.var_at   = vars;
+        jobs.append(job);
+        tokens += range.end - range.begin;
+        vars += range.stream->var_before(range.end) - range.stream->var_before(range.begin);
+    }
+    for (uint r = 0; r < count; r++)
+        pool->submit(scan_range, &jobs[r]);
+    pool->wait();
+
+    // the values used, in range order
+    literal_pool.clear();
+    symbol_table.clear();
+    string_pool.clear();
+    LiteralPool::Base total = {0, 0, 0};
+    usize identifiers = 0, escaped = 0, interned = 0, added = 0;
+    for (uint r = 0; r < count; r++)
+    {
+        CopyJob &job               = jobs[r];
+        const SymbolTable &symbols = job.range.stream->symbol_table;
+        const StringPool &strings  = job.range.stream->string_pool;
+        const u32 *strings_order   = job.order + symbols.count();
+        for (uint k = 0; k < job.used_symbols; k++)
+        {
+            const u32 id    = job.order[k];
+            job.symbols[id] = symbol_table.intern(symbols.name(id), symbols.length(id));
+        }
+        for (uint k = 0; k < job.used_strings; k++)
+        {
+            const StringView value        = strings.value(strings_order[k]);
+            job.strings[strings_order[k]] = string_pool.add_value(value.data, value.length);
+        }
+        job.base = total;
+        total.ints += job.used.ints;
+        total.floats += job.used.floats;
+        total.chars += job.used.chars;
+        identifiers += job.identifiers;
+        escaped += job.escaped;
+        interned += job.used_symbols;
+        added += job.used_strings;
+    }
+    // every further use of a value within a range is a hit of the serial lexer
+    symbol_table.count_hits(identifiers - interned);
+    string_pool.count_hits(escaped - added);
+    literal_pool.ints.resize(total.ints);
+    literal_pool.floats.resize(total.floats);
+    literal_pool.chars.resize(total.chars);
+
+    types.resize(tokens);
+    offsets.resize(tokens);
+    var_lengths.resize(vars);
+    payloads.resize(vars);
+    for (uint r = 0; r < count; r++)
+        pool->submit(copy_range, &jobs[r]);
+
+    // long lengths are rare, they are shifted to their new index serially
+    long_lengths.resize(0);
+    for (uint r = 0; r < count; r++)
+    {
+        const TokenRange &range = ranges[r];
+        const Array<LongLength> &longs = range.stream->long_lengths;
+        for (usize i = 0; i < longs.count(); i++)
+        {
+            if (longs[i].token < range.begin || longs[i].token >= range.end) continue;
+            const TknIdx at = (TknIdx)(jobs[r].token_at + longs[i].token - range.begin);
+            long_lengths.append(LongLength{at, longs[i].length});
+        }
+    }
+    pool->wait();
+
+    const usize blocks = (tokens + TKN_BLOCK - 1) / TKN_BLOCK;
+    var_bits.resize(blocks);
+    memset(var_bits.data(), 0, blocks * sizeof(u64));
+    for (uint r = 0; r < count; r++)
+    {
+        const TokenRange &range = ranges[r];
+        copy_bits(var_bits.data(), blocks, jobs[r].token_at, range.stream->var_bits.data(),
+                  range.stream->var_bits.count(), range.begin, range.end - range.begin);
+    }
+
+    ranks.resize(blocks);
+    uint sum = 0;
+    for (usize b = 0; b < blocks; b++)
+    {
+        ranks[b] = sum;
+        sum += (uint)__builtin_popcountll(var_bits[b]);
+    }
+
+    for (uint r = 0; r < count; r++)
+    {
+        delete[] jobs[r].symbols;
+        delete[] jobs[r].order;
+    }
+}
+
+/*
+ *  splice: an edit in place, the tails of the arrays move by the difference of
+ *  the token counts and the tail offsets by `shift`, the new tokens are copied
+ *  between; the block bitmaps are rebuilt from the first changed block on, a
+ *  word at a time in the tail, and `ranks` is their popcount prefix sum from there
+ *  the pools only grow: the values of the new tokens are added (interned symbols
+ *  and strings are found again), the ones of the removed tokens are left behind
+ */
+
+// moves the `tail` elements at `from` to `to`, the array then ends after them
+template <typename T>
+static void
+move_tail(Array<T> *array, const usize from, const usize to, const usize tail)
+{
+    if (to > from) array->resize(to + tail);
+    memmove(array->data() + to, array->data() + from, tail * sizeof(T));
+    if (to < from) array->resize(to + tail);
+}
+
+// the 64 bits of a bitmap of `words` words from bit `pos` on, zero past its end
+static inline u64
+bits_at(const u64 *bits, const usize words, const usize pos)
+{
+    const usize w = pos / 64, r = pos % 64;
+    u64 value     = w < words ? bits[w] >> r : 0;
+    if (r && w + 1 < words) value |= bits[w + 1] << (64 - r);
+    return value;
+}
+
+// the payload of a token of `with`, as an id or index of this stream's pools
+u32
+TokenStream::adopt_value(const TokenStream *with, const TknType type, const u32 payload)
+{
+    switch (type)
+    {
+        case TknType::Identifier:
+            return symbol_table.intern(with->symbol_table.name(payload),
+                                       with->symbol_table.length(payload));
+        case TknType::String: {
+            if (payload == STRING_VIEW) return STRING_VIEW;
+            const StringView value = with->string_pool.value(payload);
+            return string_pool.add_value(value.data, value.length);
+        }
+        case TknType::Integer: return literal_pool.add_integer(with->literal_pool.integer(payload));
+        case TknType::Float: return literal_pool.add_float(with->literal_pool.floating(payload));
+        case TknType::Char: return literal_pool.add_char(with->literal_pool.character(payload));
+        default: return payload;
+    }
+}
+
+void
+TokenStream::splice(cstr source, const TknIdx first, const TknIdx last, const TokenStream *with,
+                    const TknIdx count, const s64 shift)
+{
+    const usize n = types.count(), tail = n - last, total = n - (last - first) + count;
+    const uint var_first = var_before(first), var_last = var_before(last);
+    const uint with_vars = with->var_before(count);
+    const usize vars     = var_lengths.count();
+    src                  = source;
+
+    // the long lengths after the edit, moved like their tokens
+    usize lo = 0;
+    while (lo < long_lengths.count() && long_lengths[lo].token < first)
+        lo++;
+    usize hi = lo;
+    while (hi < long_lengths.count() && long_lengths[hi].token < last)
+        hi++;
+    Array<LongLength> moved(long_lengths.count() - hi + 1);
+    for (usize k = hi; k < long_lengths.count(); k++)
+        moved.append(LongLength{long_lengths[k].token - last + first + count,
+                                long_lengths[k].length});
+    long_lengths.resize(lo);
+    for (usize k = 0; k < with->long_lengths.count() && with->long_lengths[k].token < count; k++)
+        long_lengths.append(
+            LongLength{with->long_lengths[k].token + first, with->long_lengths[k].length});
+    for (usize k = 0; k < moved.count(); k++)
+        long_lengths.append(moved[k]);
+
+    move_tail(&types, last, first + count, tail);
+    memcpy(types.data() + first, with->types.data(), count * sizeof(TknType));
+    move_tail(&offsets, last, first + count, tail);
+    memcpy(offsets.data() + first, with->offsets.data(), count * sizeof(uint));
+    uint *moved_offsets = offsets.data() + first + count;
+    const uint diff     = (uint)shift; // wraps around for negative shifts
+    for (usize i = 0; i < tail; i++)
+        moved_offsets[i] += diff;
+
+    move_tail(&var_lengths, var_last, var_first + with_vars, vars - var_last);
+    memcpy(var_lengths.data() + var_first, with->var_lengths.data(), with_vars * sizeof(u16));
+    move_tail(&payloads, var_last, var_first + with_vars, vars - var_last);
+    for (TknIdx i = 0, k = 0; i < count; i++)
+    {
+        const TknType type = with->types[i];
+        if (TKN_TYPE_LENGTHS[(u8)type] != TKN_VARIABLE_LENGTH) continue;
+        payloads[var_first + k] = adopt_value(with, type, with->payloads[k]);
+        k++;
+    }
+
+    // bits before the tail from the types, the tail's from the old bitmap
+    const usize words = var_bits.count(), first_word = first / TKN_BLOCK;
+    const usize new_words = (total + TKN_BLOCK - 1) / TKN_BLOCK, tail_at = first + count;
+    Array<u64> bits(new_words - first_word + 1);
+    for (usize w = first_word; w < new_words; w++)
+    {
+        const usize start = w * TKN_BLOCK;
+        u64 value         = 0;
+        for (usize p = start; p < tail_at && p < start + TKN_BLOCK; p++)
+            if (TKN_TYPE_LENGTHS[(u8)types[p]] == TKN_VARIABLE_LENGTH) value |= 1ull << (p - start);
+        if (start + TKN_BLOCK > tail_at)
+        {
+            const usize from = start > tail_at ? start : tail_at;
+            value |= bits_at(var_bits.data(), words, from - tail_at + last) << (from - start);
+        }
+        bits.append(value);
+    }
+    var_bits.resize(new_words);
+    ranks.resize(new_words);
+    for (usize w = first_word; w < new_words; w++)
+    {
+        var_bits[w] = bits[w - first_word];
+        // the block of `first` may be new, its tokens before `first` are not
+        if (w == first_word)
+        {
+            const u64 before = var_bits[w] & ((1ull << (first % TKN_BLOCK)) - 1);
+            ranks[w]         = var_first - (uint)__builtin_popcountll(before);
+        }
+        else { ranks[w] = ranks[w - 1] + (uint)__builtin_popcountll(var_bits[w - 1]); }
+    }
+}
+
+/*
+ *  stream images
+ *  the counts below, then every array of the stream one after the other,
+ *  each padded to 8 bytes; symbols and pooled strings are stored as their
+ *  lengths followed by their bytes and are interned again in id order, so
+ *  they keep their ids
+ */
+
+struct ImageCounts
+{
+    u64 tokens, vars, longs, blocks;
+    u64 ints, floats, chars;
+    u64 symbols, symbol_bytes, strings, string_bytes;
+};
+
+static usize
+image_pad(const usize bytes)
+{
+    return (bytes + 7) & ~(usize)7;
+}
+
+// pads the `bytes` written at `out`, returns where the next array goes
+static char *
+image_end(char *out, const usize bytes)
+{
+    memset(out + bytes, 0, image_pad(bytes) - bytes);
+    return out + image_pad(bytes);
+}
+
+static char *
+image_put(char *out, const void *data, const usize bytes)
+{
+    if (bytes) memcpy(out, data, bytes);
+    return image_end(out, bytes);
+}
+
+// the next `count` elements of `size` bytes, nullptr when the image is too short
+static cstr
+image_take(cstr *at, cstr end, const u64 count, const usize size)
+{
+    if (count > (u64)(end - *at) / size) return nullptr;
+    const usize bytes = image_pad(count * size);
+    if (bytes > (usize)(end - *at)) return nullptr;
+    cstr data = *at;
+    *at += bytes;
+    return data;
+}
+
+static ImageCounts
+image_counts(const TokenStream *ts, const usize vars, const usize longs, const usize blocks)
+{
+    ImageCounts c  = {};
+    c.tokens       = ts->count();
+    c.vars         = vars;
+    c.longs        = longs;
+    c.blocks       = blocks;
+    c.symbols      = ts->symbols()->count();
+    c.strings      = ts->strings()->count();
+    for (u32 id = 0; id < c.symbols; id++)
+        c.symbol_bytes += ts->symbols()->length(id);
+    for (u32 id = 0; id < c.strings; id++)
+        c.string_bytes += ts->strings()->value(id).length;
+    return c;
+}
+
+usize
+TokenStream::image_bytes() const
+{
+    ImageCounts c = image_counts(this, var_lengths.count(), long_lengths.count(), ranks.count());
+    return sizeof(ImageCounts) + image_pad(c.tokens * sizeof(TknType)) +
+           image_pad(c.tokens * sizeof(uint)) + image_pad(c.vars * sizeof(u16)) +
+           image_pad(c.vars * sizeof(u32)) + image_pad(c.blocks * sizeof(uint)) +
+           image_pad(c.blocks * sizeof(u64)) + image_pad(c.longs * sizeof(LongLength)) +
+           image_pad(literal_pool.ints.count() * sizeof(u64)) +
+           image_pad(literal_pool.floats.count() * sizeof(f64)) +
+           image_pad(literal_pool.chars.count()) + image_pad(c.symbols * sizeof(u32)) +
+           image_pad(c.symbol_bytes) + image_pad(c.strings * sizeof(u32)) +
+           image_pad(c.string_bytes);
+}
+
+void
+TokenStream::write_image(char *out) const
+{
+    ImageCounts c = image_counts(this, var_lengths.count(), long_lengths.count(), ranks.count());
+    c.ints        = literal_pool.ints.count();
+    c.floats      = literal_pool.floats.count();
+    c.chars       = literal_pool.chars.count();
+    out           = image_put(out, &c, sizeof(c));
+    out           = image_put(out, types.data(), c.tokens * sizeof(TknType));
+    out           = image_put(out, offsets.data(), c.tokens * sizeof(uint));
+    out           = image_put(out, var_lengths.data(), c.vars * sizeof(u16));
+    out           = image_put(out, payloads.data(), c.vars * sizeof(u32));
+    out           = image_put(out, ranks.data(), c.blocks * sizeof(uint));
+    out           = image_put(out, var_bits.data(), c.blocks * sizeof(u64));
+    out           = image_put(out, long_lengths.data(), c.longs * sizeof(LongLength));
+    out           = image_put(out, literal_pool.ints.data(), c.ints * sizeof(u64));
+    out           = image_put(out, literal_pool.floats.data(), c.floats * sizeof(f64));
+    out           = image_put(out, literal_pool.chars.data(), c.chars);
+
+    u32 *lengths = reinterpret_cast<u32 *>(out);
+    for (u32 id = 0; id < c.symbols; id++)
+        lengths[id] = symbol_table.length(id);
+    out         = image_end(out, c.symbols * sizeof(u32));
+    char *names = out;
+    for (u32 id = 0; id < c.symbols; id++)
+        names = static_cast<char *>(mempcpy(names, symbol_table.name(id), lengths[id]));
+    out = image_end(out, c.symbol_bytes);
+
+    lengths = reinterpret_cast<u32 *>(out);
+    for (u32 id = 0; id < c.strings; id++)
+        lengths[id] = string_pool.value(id).length;
+    out          = image_end(out, c.strings * sizeof(u32));
+    char *values = out;
+    for (u32 id = 0; id < c.strings; id++)
+        values = static_cast<char *>(mempcpy(values, string_pool.value(id).data, lengths[id]));
+    image_end(out, c.string_bytes);
+}
+
+// the cache directory is user writable and a stale file may share the hash of
+// the source, so every field of an image is checked before a token is read
+bool
+TokenStream::check_image(const uint source_length) const
+{
+    const usize n = types.count();
+    usize var = 0, longs = 0;
+    uint previous = 0;
+    for (usize i = 0; i < n; i++)
+    {
+        if (i % TKN_BLOCK == 0 && ranks[i / TKN_BLOCK] != var) return false;
+        if ((u8)types[i] > (u8)TknType::EOT) return false;
+        const u8 fixed = TKN_TYPE_LENGTHS[(u8)types[i]];
+        if ((fixed == TKN_VARIABLE_LENGTH) != ((var_bits[i / TKN_BLOCK] >> (i % TKN_BLOCK)) & 1))
+            return false;
+
+        uint length = fixed;
+        if (fixed == TKN_VARIABLE_LENGTH)
+        {
+            length = var_lengths[var];
+            if (length == TKN_LONG_LENGTH)
+            {
+                if (longs == long_lengths.count() || long_lengths[longs].token != i ||
+                    long_lengths[longs].length < TKN_LONG_LENGTH)
+                    return false;
+                length = long_lengths[longs++].length;
+            }
+            const u32 value = payloads[var++];
+            bool known      = true;
+            switch (types[i])
+            {
+                case TknType::Identifier: known = value < symbol_table.count(); break;
+                case TknType::String:
+                    known = length >= 2 && (value == STRING_VIEW || value < string_pool.count());
+                    break;
+                case TknType::Integer: known = value < literal_pool.ints.count(); break;
+                case TknType::Float: known = value < literal_pool.floats.count(); break;
+                case TknType::Char: known = value < literal_pool.chars.count(); break;
+                default: break;
+            }
+            if (!known) return false;
+        }
+        // in source order and inside the source
+        if (offsets[i] < previous || offsets[i] > source_length ||
+            length > source_length - offsets[i])
+            return false;
+        previous = offsets[i];
+    }
+    // no bits past the last token
+    if (n % TKN_BLOCK && var_bits[n / TKN_BLOCK] >> (n % TKN_BLOCK)) return false;
+    return var == var_lengths.count() && longs == long_lengths.count();
+}
+
+bool
+TokenStream::read_image(cstr image, const usize bytes, const uint source_length)
+{
+    if (bytes < sizeof(ImageCounts)) return false;
+    ImageCounts c;
+    memcpy(&c, image, sizeof(c));
+    cstr at = image + sizeof(c), end = image + bytes;
+    if (c.tokens > UINT32_MAX || c.vars > c.tokens || c.longs > c.vars ||
+        c.blocks != (c.tokens + TKN_BLOCK - 1) / TKN_BLOCK)
+        return false;
+
+    cstr in_types    = image_take(&at, end, c.tokens, sizeof(TknType));
+    cstr in_offsets  = image_take(&at, end, c.tokens, sizeof(uint));
+    cstr in_lengths  = image_take(&at, end, c.vars, sizeof(u16));
+    cstr in_payloads = image_take(&at, end, c.vars, sizeof(u32));
+    cstr in_ranks    = image_take(&at, end, c.blocks, sizeof(uint));
+    cstr in_bits     = image_take(&at, end, c.blocks, sizeof(u64));
+    cstr in_longs    = image_take(&at, end, c.longs, sizeof(LongLength));
+    cstr in_ints     = image_take(&at, end, c.ints, sizeof(u64));
+    cstr in_floats   = image_take(&at, end, c.floats, sizeof(f64));
+    cstr in_chars    = image_take(&at, end, c.chars, sizeof(char));
+    cstr in_symbols  = image_take(&at, end, c.symbols, sizeof(u32));
+    cstr in_names    = image_take(&at, end, c.symbol_bytes, sizeof(char));
+    cstr in_strings  = image_take(&at, end, c.strings, sizeof(u32));
+    cstr in_values   = image_take(&at, end, c.string_bytes, sizeof(char));
+    if (!in_types || !in_offsets || !in_lengths || !in_payloads || !in_ranks || !in_bits ||
+        !in_longs || !in_ints || !in_floats || !in_chars || !in_symbols || !in_names ||
+        !in_strings || !in_values)
+        return false;
+
+    // the bitmaps must agree with the number of variable length tokens
+    usize vars = 0;
+    for (u64 b = 0; b < c.blocks; b++)
+    {
+        u64 bits;
+        memcpy(&bits, in_bits + b * sizeof(u64), sizeof(u64));
+        vars += (usize)__builtin_popcountll(bits);
+    }
+    if (vars != c.vars) return false;
+    usize names = 0, values = 0;
+    for (u64 id = 0; id < c.symbols; id++)
+    {
+        u32 length;
+        memcpy(&length, in_symbols + id * sizeof(u32), sizeof(u32));
+        names += length;
+    }
+    for (u64 id = 0; id < c.strings; id++)
+    {
+        u32 length;
+        memcpy(&length, in_strings + id * sizeof(u32), sizeof(u32));
+        values += length;
+    }
+    if (names != c.symbol_bytes || values != c.string_bytes) return false;
+
+    types.resize(c.tokens);
+    offsets.resize(c.tokens);
+    var_lengths.resize(c.vars);
+    payloads.resize(c.vars);
+    ranks.resize(c.blocks);
+    var_bits.resize(c.blocks);
+    long_lengths.resize(c.longs);
+    memcpy(types.data(), in_types, c.tokens * sizeof(TknType));
+    memcpy(offsets.data(), in_offsets, c.tokens * sizeof(uint));
+    memcpy(var_lengths.data(), in_lengths, c.vars * sizeof(u16));
+    memcpy(payloads.data(), in_payloads, c.vars * sizeof(u32));
+    memcpy(ranks.data(), in_ranks, c.blocks * sizeof(uint));
+    memcpy(var_bits.data(), in_bits, c.blocks * sizeof(u64));
+    memcpy(long_lengths.data(), in_longs, c.longs * sizeof(LongLength));
+
+    literal_pool.clear();
+    literal_pool.ints.resize(c.ints);
+    literal_pool.floats.resize(c.floats);
+    literal_pool.chars.resize(c.chars);
+    memcpy(literal_pool.ints.data(), in_ints, c.ints * sizeof(u64));
+    memcpy(literal_pool.floats.data(), in_floats, c.floats * sizeof(f64));
+    memcpy(literal_pool.chars.data(), in_chars, c.chars);
+
+    // interned in id order, every name gets its id back unless one is repeated
+    bool same_ids = true;
+    symbol_table.clear();
+    for (u64 id = 0; id < c.symbols; id++)
+    {
+        u32 length;
+        memcpy(&length, in_symbols + id * sizeof(u32), sizeof(u32));
+        same_ids &= symbol_table.intern(in_names, length) == id;
+        in_names += length;
+    }
+    string_pool.clear();
+    for (u64 id = 0; id < c.strings; id++)
+    {
+        u32 length;
+        memcpy(&length, in_strings + id * sizeof(u32), sizeof(u32));
+        same_ids &= string_pool.add_value(in_values, length) == id;
+        in_values += length;
+    }
+    if (same_ids && check_image(source_length)) return true;
+
+    types.resize(0);
+    offsets.resize(0);
+    var_lengths.resize(0);
+    payloads.resize(0);
+    ranks.resize(0);
+    var_bits.resize(0);
+    long_lengths.resize(0);
+    literal_pool.clear();
+    symbol_table.clear();
+    string_pool.clear();
+    return false;
+}
+
+usize
+TokenStream::memory() const
+{
+    return types.count() * sizeof(TknType) + offsets.count() * sizeof(uint) +
+           var_lengths.count() * sizeof(u16) + ranks.count() * sizeof(uint) +
+           var_bits.count() * sizeof(u64) + long_lengths.count() * sizeof(LongLength) +
+           payloads.count() * sizeof(u32) + literal_pool.memory() + symbol_table.memory() +
+           string_pool.memory();
+}
+
+} // namespace rotate
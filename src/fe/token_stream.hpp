@@ -0,0 +1,119 @@
+#pragma once
+
+#include "../include/thread_pool.hpp"
+#include "literals.hpp"
+#include "strings.hpp"
+#include "token.hpp"
+
+namespace rotate
+{
+
+/*
+ *  TokenStream: struct of arrays storage for the lexed tokens
+ *  - types and start offsets are stored for every token (5 bytes)
+ *  - lengths are only stored for variable length tokens (identifiers, literals),
+ *    fixed length tokens (keywords, punctuators) derive it from their type
+ *  - every TKN_BLOCK tokens the number of variable length tokens before it is
+ *    recorded with a bitmap of the variable length tokens in the block, so a
+ *    token's stored length is found with a popcount
+ *  - variable length tokens also carry a payload, the index of a literal's
+ *    value in the stream's LiteralPool, the symbol id of an identifier or the
+ *    StringPool id of a string (STRING_VIEW if it has no escapes)
+ *  - lines are not stored, they are resolved through a `LineIndex`
+ */
+
+constexpr uint TKN_BLOCK         = 64; // one u64 bitmap per block
+constexpr u8 TKN_VARIABLE_LENGTH = 0xff;
+constexpr u16 TKN_LONG_LENGTH    = 0xffff; // real length is in `long_lengths`
+constexpr usize TKN_MIN_CAPACITY = 16;
+static_assert(TKN_BLOCK == sizeof(u64) * 8, "a block bitmap is one u64");
+
+// length of a token of a given type, TKN_VARIABLE_LENGTH if it is not fixed
+u8 tkn_type_length(const TknType) noexcept;
+
+class TokenStream;
+
+// tokens [begin, end) of a stream, their offsets are moved by `shift` when copied
+struct TokenRange
+{
+    const TokenStream *stream;
+    TknIdx begin, end;
+    s64 shift;
+};
+
+class TokenStream
+{
+    struct LongLength
+    {
+        TknIdx token;
+        uint length;
+    };
+
+    cstr src; // not owned by the stream
+    Array<TknType> types;
+    Array<uint> offsets;
+    Array<u16> var_lengths;
+    Array<u32> payloads; // indexed like var_lengths
+    Array<uint> ranks;   // variable length tokens before every TKN_BLOCK tokens
+    Array<u64> var_bits; // variable length tokens in every TKN_BLOCK tokens
+    Array<LongLength> long_lengths;
+    LiteralPool literal_pool;
+    SymbolTable symbol_table;
+    StringPool string_pool;
+
+    uint rank(const TknIdx) const;
+    uint var_before(const TknIdx) const; // like `rank` but accepts `count()`
+    bool check_image(const uint source_length) const;
+
+    struct CopyJob;
+    static void scan_range(void *job);
+    static void copy_range(void *job);
+    u32 adopt_value(const TokenStream *with, const TknType, const u32 payload);
+
+    public:
+    // the token arrays take their storage from `arena` when given
+    TokenStream(cstr source, usize capacity, Arena *arena = nullptr);
+    ~TokenStream() = default;
+
+    void push(const TknType, const uint index, const uint length, const u32 payload = 0);
+    // replaces the tokens with the concatenation of `ranges` and the values with the
+    // ones these tokens use (as a serial lex of them would number them),
+    // the copies are spread over the threads of `pool`
+    void assign(const TokenRange *ranges, const uint count, ThreadPool *pool);
+    // replaces tokens [first, last) with the first `count` tokens of `with` (lexed from
+    // the edited `source`) and moves the offsets of the tokens after them by `shift`;
+    // the pools only grow, so the payloads of the kept tokens stay valid
+    void splice(cstr source, const TknIdx first, const TknIdx last, const TokenStream *with,
+                const TknIdx count, const s64 shift);
+
+    usize count() const { return types.count(); }
+    cstr source() const { return src; }
+    TknType type(const TknIdx i) const { return types[i]; }
+    uint offset(const TknIdx i) const { return offsets[i]; }
+    uint length(const TknIdx) const;
+    u32 payload(const TknIdx) const; // 0 for fixed length tokens
+    LiteralPool *literals() { return &literal_pool; }
+    const LiteralPool *literals() const { return &literal_pool; }
+    SymbolTable *symbols() { return &symbol_table; }
+    const SymbolTable *symbols() const { return &symbol_table; }
+    StringPool *strings() { return &string_pool; }
+    const StringPool *strings() const { return &string_pool; }
+    StringView string(const TknIdx i) const; // value of a string token, without its quotes
+    Token at(const TknIdx) const; // unpacked copy of a token
+    TknIdx find(const uint offset) const; // first token starting at or after `offset`
+
+    // bytes used by the stream (excluding unused capacity)
+    usize memory() const;
+
+    // the whole stream (tokens, literals, symbols and strings) as one flat image,
+    // see token_cache.hpp; `write_image` fills `image_bytes()` bytes
+    usize image_bytes() const;
+    void write_image(char *out) const;
+    // replaces the tokens with the ones of an image of a `source_length` bytes source,
+    // false if it is malformed (an empty stream is then left empty)
+    bool read_image(cstr image, const usize bytes, const uint source_length);
+};
+
+cstr get_keyword_or_type(const TokenStream *, const TknIdx);
+
+} // namespace rotate
@@ -1,16 +1,112 @@
 #include "include/file.hpp"
 #include "include/defines.hpp"
+#include "include/mem_stats.hpp"
+
+#include "fe/simd.hpp"
+#include "fe/token.hpp"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 namespace rotate
 {
 
+#ifdef __linux__
+static usize
+round_to_pages(const usize bytes)
+{
+    const usize page = (usize)sysconf(_SC_PAGESIZE);
+    return (bytes + page - 1) & ~(page - 1);
+}
+
+// maps `length` bytes of `fd` read-only, followed by at least
+// EXTRA_NULL_TERMINATORS zeros, nullptr when the file cannot be mapped
+static char *
+map_file(const int fd, const usize length, usize *mapped)
+{
+    // the kernel zero fills the last file page past the end of the file,
+    // if the file ends too close to a page boundary, an anonymous zero page follows it
+    const usize file_bytes = round_to_pages(length);
+    const usize total      = round_to_pages(length + EXTRA_NULL_TERMINATORS);
+    void *region           = nullptr;
+    if (total > file_bytes)
+    {
+        region = mmap(nullptr, total, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED) return nullptr;
+    }
+    void *view = mmap(region, file_bytes, PROT_READ, MAP_PRIVATE | (region ? MAP_FIXED : 0), fd, 0);
+    if (view == MAP_FAILED)
+    {
+        if (region) munmap(region, total);
+        return nullptr;
+    }
+    // the lexer reads the source front to back
+    madvise(view, file_bytes, MADV_SEQUENTIAL);
+    *mapped = total;
+    return static_cast<char *>(view);
+}
+#endif
+
+void
+file_unmap(cstr contents, const usize mapped) noexcept
+{
+#ifdef __linux__
+    munmap(const_cast<char *>(contents), mapped);
+#else
+    UNUSED(contents);
+    UNUSED(mapped);
+#endif
+}
+
+// the whole source is checked once, the lexer trusts it afterwards;
+// the first forbidden byte is reported like a lexer error
+bool
+file_validate(cstr name, cstr contents, const uint length, const bool ascii_only) noexcept
+{
+    const uint at = simd_validate_source(contents, length, ascii_only, simd_detect());
+    if (at == length) return true;
+
+    const u8 c = (u8)contents[at];
+    LexErr error;
+    if (c == '\t') { error = LexErr::TABS; }
+    else if (c == '\r') { error = LexErr::WINDOWS_CRAP; }
+    else if (c < 0x80) { error = LexErr::LEXER_INVALID_CHAR; }
+    else { error = ascii_only ? LexErr::NON_ASCII : LexErr::INVALID_UTF8; }
+
+    uint line = 1, low = 0;
+    for (uint i = 0; i < at; i++)
+    {
+        if (contents[i] != '\n') continue;
+        line++;
+        low = i + 1;
+    }
+    cstr eol        = static_cast<cstr>(memchr(contents + at, '\n', length - at));
+    const uint high = eol ? (uint)(eol - contents) : length;
+
+    flockfile(stderr);
+    fprintf(stderr, " > %s%s%s:%u:%u: %serror: %s%s%s\n", BOLD, WHITE, name, line, at - low + 1,
+            LRED, LBLUE, lexer_err_msg(error), RESET);
+    fprintf(stderr, "  %s%u%s | %.*s\n", LYELLOW, line, RESET, high - low, contents + low);
+    fprintf(stderr, "  %*c |%*c%s%s^\n", get_digits_from_number(line), ' ', at - low + 1, ' ', LRED,
+            BOLD);
+    fprintf(stderr, " > Advice: %s%s\n", RESET, lexer_err_advice(error));
+    funlockfile(stderr);
+    return false;
+}
+
 /// NOTE:
 /// the whole file will be read at once
 /// to avoid potential problems with the
 /// filesystem during reading as developers
 /// may modify the files during reading
+/// large files are mapped instead (MAP_PRIVATE), the pages are only read
+/// when the lexer reaches them, so time to first token and resident memory
+/// do not grow with the file size; a file truncated while it is mapped
+/// faults, the same way any mmap reader does
 file_t
-file_read(cstr name) noexcept
+file_read(cstr name, const bool map, const bool ascii_only) noexcept
 {
     usize len = strlen(name);
 
@@ -51,18 +147,40 @@ file_read(cstr name) noexcept
         fclose(file);
         return file_t(nullptr, nullptr, 0, valid::failure);
     }
+#ifdef __linux__
+    if (map && length >= FILE_MAP_THRESHOLD)
+    {
+        usize mapped = 0;
+        if (char *view = map_file(fileno(file), length, &mapped))
+        {
+            fclose(file);
+            if (!file_validate(name, view, (uint)length, ascii_only))
+            {
+                file_unmap(view, mapped);
+                return file_t(nullptr, nullptr, 0, valid::failure);
+            }
+            return file_t(name, view, (uint)length, valid::success, mapped);
+        }
+        // not mappable (pipes, some filesystems): read it
+    }
+#else
+    UNUSED(map);
+#endif
+
     // rewind the fseek to the beginning of the file
     rewind(file);
 
     // Read the file into a buffer
     char *buffer = new char[length + 3];
     if (!buffer) exit_error("Memory allocation failure");
+    mem_track_alloc(length + 3);
 
     // get file contents
     if (fread(buffer, sizeof(char), length, file) != length)
     {
         log_error("Read file error");
         fclose(file);
+        mem_track_free(length + 3);
         delete[] buffer;
         return file_t(nullptr, nullptr, 0, valid::failure);
     }
@@ -71,11 +189,10 @@ file_read(cstr name) noexcept
     for (u8 i = 0; i < EXTRA_NULL_TERMINATORS; i++)
         buffer[length + i] = '\0';
 
-    // simple validator (check first char if it is a visible ascii or is_space(without tabs))
-    if ((buffer[0] < ' ' || buffer[0] > '~') && isspace(buffer[0]))
+    if (!file_validate(name, buffer, (uint)length, ascii_only))
     {
-        log_error("Only ascii text files are supported for compilation");
         fclose(file);
+        mem_track_free(length + 3);
         delete[] buffer;
         return file_t(nullptr, nullptr, 0, valid::failure);
     }
@@ -0,0 +1,422 @@
+#include "include/file.hpp"
+#include "include/defines.hpp"
+#include "include/mem_stats.hpp"
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+#define RT_URING 1
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace rotate
+{
+
+/*
+ *  batched source reads on io_uring, without liburing
+ *  - a source costs four ring operations: statx and openat are queued together,
+ *    the read once both completed (its size is known then), close once it was read
+ *  - up to URING_DEPTH / 2 sources are in flight (started and not handed over
+ *    yet) and at most URING_DEPTH completions outstanding, a close included, so
+ *    completions never overflow the completion ring (twice the submission ring)
+ *  - a source is handed over as soon as its read completes, in completion order
+ *  - a kernel without io_uring (or one a seccomp filter hides it from) or without
+ *    one of the four operations reads the batch with `file_read`
+ *  - sources mapped by `file_read` (FILE_MAP_THRESHOLD) are mapped here as well,
+ *    the ring only replaces the syscalls of the buffered path
+ */
+
+static void
+read_each(cstr const *names, const uint count, FileReadFn on_read, void *arg, const bool map,
+          const bool ascii_only)
+{
+    for (uint i = 0; i < count; i++)
+        on_read(arg, i, new file_t(file_read(names[i], map, ascii_only)));
+}
+
+#ifdef RT_URING
+
+// 16 sources in flight: deeper batches save few syscalls, and sources read far ahead
+// of their validation may leave the cache before they are lexed
+constexpr u32 URING_DEPTH = 32;
+// a single read is capped, larger sources take several
+constexpr u32 URING_READ_MAX = 1u << 30;
+
+enum class UringOp : u8
+{
+    statx,
+    open,
+    read,
+    close,
+};
+
+class Ring
+{
+    int fd = -1;
+    u32 entries = 0, tail = 0, queued = 0; // the local submission tail, sqes not yet entered
+    u32 *sq_head = nullptr, *sq_tail = nullptr, *sq_mask = nullptr, *sq_array = nullptr;
+    u32 *cq_head = nullptr, *cq_tail = nullptr, *cq_mask = nullptr;
+    io_uring_sqe *sqes = nullptr;
+    io_uring_cqe *cqes = nullptr;
+    void *sq_ring = MAP_FAILED, *cq_ring = MAP_FAILED;
+    usize sq_bytes = 0, cq_bytes = 0;
+
+    bool supports(const u8 *ops) const;
+
+    public:
+    ~Ring();
+    bool open(const u32 depth);
+
+    io_uring_sqe *sqe(const UringOp op, const u32 index);
+    int enter(const u32 wait); // submits the queued sqes, waits for `wait` completions
+
+    // the next completion, false when none is ready
+    bool reap(io_uring_cqe *out)
+    {
+        const u32 head = *cq_head;
+        if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) return false;
+        *out = cqes[head & *cq_mask];
+        __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+};
+
+Ring::~Ring()
+{
+    if (sqes) munmap(sqes, entries * sizeof(io_uring_sqe));
+    if (cq_ring != MAP_FAILED && cq_ring != sq_ring) munmap(cq_ring, cq_bytes);
+    if (sq_ring != MAP_FAILED) munmap(sq_ring, sq_bytes);
+    if (fd >= 0) close(fd);
+}
+
+bool
+Ring::supports(const u8 *ops) const
+{
+    const usize bytes     = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+    io_uring_probe *probe = static_cast<io_uring_probe *>(calloc(1, bytes));
+    if (!probe) return false;
+    bool ok = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+    for (; ok && *ops != IORING_OP_LAST; ops++)
+        ok = *ops <= probe->last_op && (probe->ops[*ops].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    return ok;
+}
+
+bool
+Ring::open(const u32 depth)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd = (int)syscall(__NR_io_uring_setup, depth, &params);
+    if (fd < 0) return false;
+    static const u8 OPS[] = {IORING_OP_STATX, IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE,
+                             IORING_OP_LAST};
+    if (!supports(OPS)) return false;
+
+    // one mapping holds both rings on 5.4+
+    sq_bytes = params.sq_off.array + params.sq_entries * sizeof(u32);
+    cq_bytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) sq_bytes = cq_bytes = sq_bytes > cq_bytes ? sq_bytes : cq_bytes;
+    sq_ring = mmap(nullptr, sq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                   IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED) return false;
+    cq_ring = single ? sq_ring
+                     : mmap(nullptr, cq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            fd, IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED) return false;
+    void *sqe_view = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqe_view == MAP_FAILED) return false;
+
+    char *sq = static_cast<char *>(sq_ring), *cq = static_cast<char *>(cq_ring);
+    entries  = params.sq_entries;
+    sqes     = static_cast<io_uring_sqe *>(sqe_view);
+    sq_head  = reinterpret_cast<u32 *>(sq + params.sq_off.head);
+    sq_tail  = reinterpret_cast<u32 *>(sq + params.sq_off.tail);
+    sq_mask  = reinterpret_cast<u32 *>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<u32 *>(sq + params.sq_off.array);
+    cq_head  = reinterpret_cast<u32 *>(cq + params.cq_off.head);
+    cq_tail  = reinterpret_cast<u32 *>(cq + params.cq_off.tail);
+    cq_mask  = reinterpret_cast<u32 *>(cq + params.cq_off.ring_mask);
+    cqes     = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    tail     = *sq_tail;
+    return true;
+}
+
+io_uring_sqe *
+Ring::sqe(const UringOp op, const u32 index)
+{
+    // the kernel consumes every entered sqe before io_uring_enter returns
+    if (tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) == entries && enter(0) < 0)
+        exit_error("io_uring_enter failure");
+    const u32 slot    = tail & *sq_mask;
+    io_uring_sqe *sqe = &sqes[slot];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data    = (u64)index << 2 | (u64)op;
+    sq_array[slot]    = slot;
+    tail++;
+    queued++;
+    return sqe;
+}
+
+int
+Ring::enter(const u32 wait)
+{
+    __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+    for (;;)
+    {
+        const int n = (int)syscall(__NR_io_uring_enter, fd, queued, wait,
+                                   wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+        if (n >= 0)
+        {
+            queued -= (u32)n < queued ? (u32)n : queued;
+            return n;
+        }
+        if (errno != EINTR) return -errno;
+    }
+}
+
+struct UringSource
+{
+    cstr name;
+    struct statx stat;
+    char *buffer = nullptr;
+    u64 length = 0, done = 0;
+    int fd = -1, error = 0;
+    u8 waiting = 0; // statx and openat completions still to come
+};
+
+class UringBatch
+{
+    Ring *ring;
+    UringSource *sources;
+    FileReadFn on_read;
+    void *arg;
+    bool map, ascii_only;
+
+    void queue_read(const u32 i);
+    void opened(const u32 i);
+    void finish(const u32 i);
+    void fail(const u32 i, cstr message); // `message` is nullptr when already reported
+    void hand_over(const u32 i, file_t *file);
+
+    public:
+    u32 pending = 0; // completions still to come
+    u32 active  = 0; // sources started on the ring and not handed over yet
+
+    UringBatch(Ring *ring, UringSource *sources, FileReadFn on_read, void *arg, const bool map,
+               const bool ascii_only)
+        : ring(ring), sources(sources), on_read(on_read), arg(arg), map(map),
+          ascii_only(ascii_only)
+    {
+    }
+
+    void start(const u32 i);
+    void complete(const io_uring_cqe *cqe);
+};
+
+void
+UringBatch::hand_over(const u32 i, file_t *file)
+{
+    active--;
+    on_read(arg, i, file);
+}
+
+void
+UringBatch::fail(const u32 i, cstr message)
+{
+    UringSource *source = &sources[i];
+    if (message) log_error(message);
+    if (source->fd >= 0) close(source->fd);
+    if (source->buffer)
+    {
+        mem_track_free(source->length + EXTRA_NULL_TERMINATORS);
+        delete[] source->buffer;
+    }
+    source->fd     = -1;
+    source->buffer = nullptr;
+    hand_over(i, new file_t(nullptr, nullptr, 0, valid::failure));
+}
+
+void
+UringBatch::start(const u32 i)
+{
+    UringSource *source = &sources[i];
+    const usize length  = strlen(source->name);
+    if (length < 3 || strcmp(source->name + length - 3, ".vr") != 0)
+    {
+        // file_read reports the name
+        on_read(arg, i, new file_t(file_read(source->name, map, ascii_only)));
+        return;
+    }
+
+    io_uring_sqe *stat = ring->sqe(UringOp::statx, i);
+    stat->opcode       = IORING_OP_STATX;
+    stat->fd           = AT_FDCWD;
+    stat->addr         = (u64)(uintptr_t)source->name;
+    stat->len          = STATX_SIZE;
+    stat->off          = (u64)(uintptr_t)&source->stat;
+
+    io_uring_sqe *open = ring->sqe(UringOp::open, i);
+    open->opcode       = IORING_OP_OPENAT;
+    open->fd           = AT_FDCWD;
+    open->addr         = (u64)(uintptr_t)source->name;
+    open->open_flags   = O_RDONLY | O_CLOEXEC;
+    source->waiting    = 2;
+    pending += 2;
+    active++;
+}
+
+void
+UringBatch::queue_read(const u32 i)
+{
+    UringSource *source = &sources[i];
+    const u64 left      = source->length - source->done;
+    io_uring_sqe *read  = ring->sqe(UringOp::read, i);
+    read->opcode        = IORING_OP_READ;
+    read->fd            = source->fd;
+    read->addr          = (u64)(uintptr_t)(source->buffer + source->done);
+    read->len           = left < URING_READ_MAX ? (u32)left : URING_READ_MAX;
+    read->off           = source->done;
+    pending++;
+}
+
+void
+UringBatch::opened(const u32 i)
+{
+    UringSource *source = &sources[i];
+    if (source->error) return fail(i, "File does not exist");
+
+    source->length = source->stat.stx_size;
+    if (source->length == 0) return fail(i, "File is empty");
+    // NOTE: hardcoded 3 null-terminators
+    if (source->length > (UINT_MAX - 3)) return fail(i, "File is too large");
+    if (map && source->length >= FILE_MAP_THRESHOLD)
+    {
+        close(source->fd);
+        source->fd = -1;
+        hand_over(i, new file_t(file_read(source->name, map, ascii_only)));
+        return;
+    }
+
+    source->buffer = new char[source->length + EXTRA_NULL_TERMINATORS];
+    mem_track_alloc(source->length + EXTRA_NULL_TERMINATORS);
+    queue_read(i);
+}
+
+void
+UringBatch::finish(const u32 i)
+{
+    UringSource *source = &sources[i];
+    io_uring_sqe *done  = ring->sqe(UringOp::close, i);
+    done->opcode        = IORING_OP_CLOSE;
+    done->fd            = source->fd;
+    source->fd          = -1;
+    pending++;
+
+    for (u8 k = 0; k < EXTRA_NULL_TERMINATORS; k++)
+        source->buffer[source->length + k] = '\0';
+    if (!file_validate(source->name, source->buffer, (uint)source->length, ascii_only))
+        return fail(i, nullptr); // reported by file_validate
+    char *buffer   = source->buffer;
+    source->buffer = nullptr;
+    hand_over(i, new file_t(source->name, buffer, (uint)source->length, valid::success));
+}
+
+void
+UringBatch::complete(const io_uring_cqe *cqe)
+{
+    const u32 i         = (u32)(cqe->user_data >> 2);
+    const UringOp op    = (UringOp)(cqe->user_data & 3);
+    UringSource *source = &sources[i];
+    pending--;
+    switch (op)
+    {
+    case UringOp::statx:
+    case UringOp::open:
+        if (cqe->res < 0) { source->error = -cqe->res; }
+        else if (op == UringOp::open) { source->fd = cqe->res; }
+        if (--source->waiting == 0) opened(i);
+        break;
+    case UringOp::read:
+        // 0: the source was truncated since its statx
+        if (cqe->res <= 0) return fail(i, "Read file error");
+        source->done += (u64)cqe->res;
+        if (source->done < source->length) { queue_read(i); }
+        else { finish(i); }
+        break;
+    case UringOp::close: break;
+    }
+}
+
+bool
+file_uring_supported() noexcept
+{
+    Ring ring;
+    return ring.open(URING_DEPTH);
+}
+
+bool
+file_read_batch(cstr const *names, const uint count, FileReadFn on_read, void *arg,
+                const bool map, const bool ascii_only, const bool uring) noexcept
+{
+    Ring ring;
+    if (!uring || count == 0 || !ring.open(URING_DEPTH))
+    {
+        read_each(names, count, on_read, arg, map, ascii_only);
+        return false;
+    }
+
+    UringSource *sources = new UringSource[count];
+    UringBatch batch(&ring, sources, on_read, arg, map, ascii_only);
+    u32 next = 0;
+    while (next < count || batch.pending)
+    {
+        // four completions at most per source, two of them at a time
+        while (next < count && batch.active < URING_DEPTH / 2 &&
+               batch.pending + 2 <= URING_DEPTH)
+        {
+            sources[next].name = names[next];
+            batch.start(next++);
+        }
+        if (!batch.pending) continue;
+
+        io_uring_cqe cqe;
+        const int entered = ring.enter(1);
+        // the ring is unusable, nothing in flight can complete anymore
+        if (entered < 0 && entered != -EBUSY && entered != -EAGAIN)
+            exit_error("io_uring_enter failure");
+        while (ring.reap(&cqe))
+            batch.complete(&cqe);
+    }
+    delete[] sources;
+    return true;
+}
+
+#else
+
+bool
+file_uring_supported() noexcept
+{
+    return false;
+}
+
+bool
+file_read_batch(cstr const *names, const uint count, FileReadFn on_read, void *arg,
+                const bool map, const bool ascii_only, const bool) noexcept
+{
+    read_each(names, count, on_read, arg, map, ascii_only);
+    return false;
+}
+
+#endif // RT_URING
+
+} // namespace rotate
@@ -1,43 +1,448 @@
 #pragma once
 
+#include "arena.hpp"
 #include "defines.hpp"
+#include "mem_stats.hpp"
+
+#include <new>
+#include <type_traits>
 
 namespace rotate
 {
 
+/*
+ *  Containers
+ *  - Array<T, Growth>: growable array, elements are accessed by reference
+ *  - SmallArray<T, N>: the first N elements live inside the object, for the
+ *    many short lists that never need the heap
+ *  - Slice<T>: non owning view of consecutive elements
+ *  trivially copyable elements are moved with realloc/memcpy, other types are
+ *  move constructed and destroyed one by one; the arrays can not be copied
+ *  an Array given an Arena takes its storage from it and never frees it
+ */
+
+constexpr usize ARRAY_MIN_CAPACITY = 8;
+
+// growth policies: the capacity to grow to when `needed` elements do not fit
+struct GrowDouble
+{
+    static usize next(const usize capacity, const usize needed)
+    {
+        const usize grown = capacity < ARRAY_MIN_CAPACITY ? ARRAY_MIN_CAPACITY : capacity * 2;
+        return grown < needed ? needed : grown;
+    }
+};
+
+// 1.5x, less memory left unused at the cost of more reallocations
+struct GrowHalf
+{
+    static usize next(const usize capacity, const usize needed)
+    {
+        const usize grown =
+            capacity < ARRAY_MIN_CAPACITY ? ARRAY_MIN_CAPACITY : capacity + capacity / 2;
+        return grown < needed ? needed : grown;
+    }
+};
+
+template <typename T>
+class Slice
+{
+    T *m_data     = nullptr;
+    usize m_count = 0;
+
+    public:
+    Slice() = default;
+    Slice(T *data, const usize count) : m_data(data), m_count(count) {}
+
+    T &operator[](const usize index) const { return m_data[index]; }
+    T &at(const usize index) const
+    {
+        ASSERT(index < m_count, "Slice index out of bounds");
+        return m_data[index];
+    }
+    usize count() const { return m_count; }
+    bool is_empty() const { return m_count == 0; }
+    T *data() const { return m_data; }
+    T *begin() const { return m_data; }
+    T *end() const { return m_data + m_count; }
+
+    // elements [from, to)
+    Slice sub(const usize from, const usize to) const { return Slice(m_data + from, to - from); }
+};
+
+namespace array
+{
+
+template <typename T>
+constexpr bool
+is_trivial()
+{
+    return std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value;
+}
+
+// moves `count` elements to uninitialized memory, the sources are destroyed
+template <typename T>
+inline void
+relocate(T *dst, T *src, const usize count)
+{
+    if (is_trivial<T>())
+    {
+        if (count) memcpy(static_cast<void *>(dst), static_cast<void *>(src), count * sizeof(T));
+        return;
+    }
+    for (usize i = 0; i < count; i++)
+    {
+        new (dst + i) T(static_cast<T &&>(src[i]));
+        src[i].~T();
+    }
+}
+
 template <typename T>
+inline void
+destroy(T *data, const usize from, const usize to)
+{
+    if (is_trivial<T>()) return;
+    for (usize i = from; i < to; i++)
+        data[i].~T();
+}
+
+// heap storage of the containers, charged to the running Stage (see mem_stats.hpp)
+inline void *
+heap_alloc(const usize bytes)
+{
+    void *data = malloc(bytes);
+    ASSERT_NULL(data, "heap allocation failure");
+    mem_track_alloc(bytes);
+    return data;
+}
+
+inline void *
+heap_resize(void *data, const usize old_bytes, const usize bytes)
+{
+    data = realloc(data, bytes);
+    ASSERT_NULL(data, "heap allocation failure");
+    mem_track_resize(old_bytes, bytes);
+    return data;
+}
+
+inline void
+heap_free(void *data, const usize bytes)
+{
+    if (!data) return;
+    mem_track_free(bytes);
+    free(data);
+}
+
+} // namespace array
+
+template <typename T, typename Growth = GrowDouble>
 class Array
 {
     private:
     T *m_data        = nullptr;
     usize m_count    = 0;
     usize m_capacity = 0;
+    Arena *m_arena   = nullptr;
+
+    void grow(const usize needed) { reserve(Growth::next(m_capacity, needed)); }
+    // the slow path of append, `element` is a temporary that outlives the old buffer
+    void append_grown(T &&element)
+    {
+        grow(m_count + 1);
+        new (m_data + m_count++) T(static_cast<T &&>(element));
+    }
+    void release()
+    {
+        array::destroy(m_data, 0, m_count);
+        if (!m_arena) array::heap_free(static_cast<void *>(m_data), m_capacity * sizeof(T));
+    }
 
     public:
-    Array(usize init_size = 10)
+    Array(usize init_size = 10, Arena *arena = nullptr) : m_arena(arena) { reserve(init_size); }
+    ~Array() { release(); }
+
+    Array(const Array &)            = delete;
+    Array &operator=(const Array &) = delete;
+    Array(Array &&other)
+        : m_data(other.m_data), m_count(other.m_count), m_capacity(other.m_capacity),
+          m_arena(other.m_arena)
+    {
+        other.m_data     = nullptr;
+        other.m_count    = 0;
+        other.m_capacity = 0;
+    }
+    Array &operator=(Array &&other)
     {
-        m_count    = 0;
-        m_capacity = init_size;
-        m_data     = static_cast<T *>(malloc(sizeof(T) * init_size));
-        ASSERT_NULL(m_data, "Array initialization failure");
+        if (this == &other) return *this;
+        release();
+        m_data           = other.m_data;
+        m_count          = other.m_count;
+        m_capacity       = other.m_capacity;
+        m_arena          = other.m_arena;
+        other.m_data     = nullptr;
+        other.m_count    = 0;
+        other.m_capacity = 0;
+        return *this;
     }
 
-    ~Array() { free(static_cast<void *>(m_data)); }
+    // NOTE: `element` may live in this array, it is copied before grow() frees it
+    void append(const T &element)
+    {
+        if (m_count == m_capacity) return append_grown(T(element));
+        new (m_data + m_count++) T(element);
+    }
+    void append(T &&element)
+    {
+        if (m_count == m_capacity) return append_grown(T(static_cast<T &&>(element)));
+        new (m_data + m_count++) T(static_cast<T &&>(element));
+    }
 
-    void append(T element)
+    // constructs the new last element in place
+    template <typename... Args>
+    T &emplace(Args &&...args)
     {
         if (m_count == m_capacity)
         {
-            m_capacity <<= 1;
-            m_data = static_cast<T *>(realloc(m_data, m_capacity * sizeof(T)));
-            ASSERT_NULL(m_data, "Array resize");
+            append_grown(T(static_cast<Args &&>(args)...));
+            return m_data[m_count - 1];
         }
-        m_data[m_count++] = element;
+        T *element = new (m_data + m_count) T(static_cast<Args &&>(args)...);
+        m_count++;
+        return *element;
     }
 
-    T at(const usize index) const { return m_data[index]; }
-    T operator[](const usize index) const { return m_data[index]; }
+    // removes the last element and returns it
+    T pop()
+    {
+        ASSERT(m_count > 0, "Array pop from an empty array");
+        m_count--;
+        T element(static_cast<T &&>(m_data[m_count]));
+        m_data[m_count].~T();
+        return element;
+    }
+
+    // the capacity is never lowered here, see `shrink_to_fit`
+    void reserve(const usize capacity)
+    {
+        if (capacity <= m_capacity) return;
+        if (m_arena && array::is_trivial<T>())
+        {
+            m_data = static_cast<T *>(
+                m_arena->grow(m_data, m_capacity * sizeof(T), capacity * sizeof(T), alignof(T)));
+        }
+        else if (m_arena)
+        {
+            T *data = m_arena->alloc_array<T>(capacity);
+            array::relocate(data, m_data, m_count);
+            m_data = data;
+        }
+        else if (array::is_trivial<T>())
+        {
+            m_data = static_cast<T *>(array::heap_resize(
+                static_cast<void *>(m_data), m_capacity * sizeof(T), capacity * sizeof(T)));
+        }
+        else
+        {
+            T *data = static_cast<T *>(array::heap_alloc(capacity * sizeof(T)));
+            array::relocate(data, m_data, m_count);
+            array::heap_free(static_cast<void *>(m_data), m_capacity * sizeof(T));
+            m_data = data;
+        }
+        m_capacity = capacity;
+    }
+
+    // NOTE: a no-op for arena arrays, the arena would keep the old storage anyway
+    void shrink_to_fit()
+    {
+        if (m_arena || m_count == m_capacity) return;
+        if (m_count == 0)
+        {
+            array::heap_free(static_cast<void *>(m_data), m_capacity * sizeof(T));
+            m_data     = nullptr;
+            m_capacity = 0;
+            return;
+        }
+        T *data = static_cast<T *>(array::heap_alloc(m_count * sizeof(T)));
+        array::relocate(data, m_data, m_count);
+        array::heap_free(static_cast<void *>(m_data), m_capacity * sizeof(T));
+        m_data     = data;
+        m_capacity = m_count;
+    }
+
+    // NOTE: new elements are default initialized, so left uninitialized for plain types
+    void resize(const usize count)
+    {
+        if (count > m_capacity) reserve(count);
+        if (count > m_count)
+        {
+            for (usize i = m_count; i < count; i++)
+                new (m_data + i) T;
+        }
+        else { array::destroy(m_data, count, m_count); }
+        m_count = count;
+    }
+
+    void clear()
+    {
+        array::destroy(m_data, 0, m_count);
+        m_count = 0;
+    }
+
+    T &at(const usize index)
+    {
+        ASSERT(index < m_count, "Array index out of bounds");
+        return m_data[index];
+    }
+    const T &at(const usize index) const
+    {
+        ASSERT(index < m_count, "Array index out of bounds");
+        return m_data[index];
+    }
+    T &operator[](const usize index) { return m_data[index]; }
+    const T &operator[](const usize index) const { return m_data[index]; }
+    T &last() { return m_data[m_count - 1]; }
+    const T &last() const { return m_data[m_count - 1]; }
+
     usize count() const { return m_count; }
+    usize capacity() const { return m_capacity; }
+    bool is_empty() const { return m_count == 0; }
+    Arena *arena() const { return m_arena; }
+    T *data() { return m_data; }
+    const T *data() const { return m_data; }
+    T *begin() { return m_data; }
+    T *end() { return m_data + m_count; }
+    const T *begin() const { return m_data; }
+    const T *end() const { return m_data + m_count; }
+
+    Slice<T> slice() { return Slice<T>(m_data, m_count); }
+    Slice<const T> slice() const { return Slice<const T>(m_data, m_count); }
+};
+
+template <typename T, usize N, typename Growth = GrowDouble>
+class SmallArray
+{
+    static_assert(N > 0, "SmallArray needs inline room for at least one element");
+
+    private:
+    T *m_data        = reinterpret_cast<T *>(m_inline);
+    usize m_count    = 0;
+    usize m_capacity = N;
+    alignas(T) char m_inline[N * sizeof(T)];
+
+    bool is_inline() const { return m_data == reinterpret_cast<const T *>(m_inline); }
+
+    void grow(const usize needed)
+    {
+        const usize capacity = Growth::next(m_capacity, needed);
+        T *data              = static_cast<T *>(array::heap_alloc(capacity * sizeof(T)));
+        array::relocate(data, m_data, m_count);
+        if (!is_inline()) array::heap_free(static_cast<void *>(m_data), m_capacity * sizeof(T));
+        m_data     = data;
+        m_capacity = capacity;
+    }
+    void append_grown(T &&element)
+    {
+        grow(m_count + 1);
+        new (m_data + m_count++) T(static_cast<T &&>(element));
+    }
+
+    public:
+    SmallArray() = default;
+    ~SmallArray()
+    {
+        array::destroy(m_data, 0, m_count);
+        if (!is_inline()) array::heap_free(static_cast<void *>(m_data), m_capacity * sizeof(T));
+    }
+
+    SmallArray(const SmallArray &)            = delete;
+    SmallArray &operator=(const SmallArray &) = delete;
+    SmallArray(SmallArray &&other)
+    {
+        if (other.is_inline()) { array::relocate(m_data, other.m_data, other.m_count); }
+        else
+        {
+            m_data           = other.m_data;
+            m_capacity       = other.m_capacity;
+            other.m_data     = reinterpret_cast<T *>(other.m_inline);
+            other.m_capacity = N;
+        }
+        m_count       = other.m_count;
+        other.m_count = 0;
+    }
+
+    // NOTE: `element` may live in this array, it is copied before grow() frees it
+    void append(const T &element)
+    {
+        if (m_count == m_capacity) return append_grown(T(element));
+        new (m_data + m_count++) T(element);
+    }
+    void append(T &&element)
+    {
+        if (m_count == m_capacity) return append_grown(T(static_cast<T &&>(element)));
+        new (m_data + m_count++) T(static_cast<T &&>(element));
+    }
+
+    template <typename... Args>
+    T &emplace(Args &&...args)
+    {
+        if (m_count == m_capacity)
+        {
+            append_grown(T(static_cast<Args &&>(args)...));
+            return m_data[m_count - 1];
+        }
+        T *element = new (m_data + m_count) T(static_cast<Args &&>(args)...);
+        m_count++;
+        return *element;
+    }
+
+    T pop()
+    {
+        ASSERT(m_count > 0, "SmallArray pop from an empty array");
+        m_count--;
+        T element(static_cast<T &&>(m_data[m_count]));
+        m_data[m_count].~T();
+        return element;
+    }
+
+    void reserve(const usize capacity)
+    {
+        if (capacity > m_capacity) grow(capacity);
+    }
+
+    void clear()
+    {
+        array::destroy(m_data, 0, m_count);
+        m_count = 0;
+    }
+
+    T &at(const usize index)
+    {
+        ASSERT(index < m_count, "SmallArray index out of bounds");
+        return m_data[index];
+    }
+    const T &at(const usize index) const
+    {
+        ASSERT(index < m_count, "SmallArray index out of bounds");
+        return m_data[index];
+    }
+    T &operator[](const usize index) { return m_data[index]; }
+    const T &operator[](const usize index) const { return m_data[index]; }
+    T &last() { return m_data[m_count - 1]; }
+    const T &last() const { return m_data[m_count - 1]; }
+
+    usize count() const { return m_count; }
+    usize capacity() const { return m_capacity; }
+    bool is_empty() const { return m_count == 0; }
+    bool on_heap() const { return !is_inline(); }
+    T *data() { return m_data; }
+    const T *data() const { return m_data; }
+    T *begin() { return m_data; }
+    T *end() { return m_data + m_count; }
+    const T *begin() const { return m_data; }
+    const T *end() const { return m_data + m_count; }
+
+    Slice<T> slice() { return Slice<T>(m_data, m_count); }
+    Slice<const T> slice() const { return Slice<const T>(m_data, m_count); }
 };
 
 } // namespace rotate
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include <new>
+
+namespace rotate
+{
+
+/*
+ *  Arena: chunked bump allocator, nothing is freed on its own
+ *  - small allocations are carved from ARENA_CHUNK_SIZE chunks
+ *  - allocations above a quarter of a chunk get a dedicated chunk, growing
+ *    one reallocates it in place so large arrays cost the same as malloc
+ *  - `mark`/`rollback` release everything allocated after the mark at once
+ *  - `recycle` empties the arena but keeps its chunks, for a stage that runs
+ *    again on the next input (batch compilation)
+ *  - destructors of the allocated objects are never run, put trivially
+ *    destructible data in arenas or destroy the objects yourself
+ *  every chunk is freed with the arena
+ */
+
+constexpr usize ARENA_CHUNK_SIZE = 64 * 1024;
+constexpr usize ARENA_ALIGN      = 16; // default alignment, enough for any scalar
+
+struct ArenaMark
+{
+    void *chunk;
+    char *at, *floor;
+    u64 serial;
+};
+
+class Arena
+{
+    struct alignas(ARENA_ALIGN) Chunk
+    {
+        Chunk *prev, *next; // bump chunks only use `prev`
+        usize size;         // bytes after the header
+        u64 serial;         // allocation order, see `rollback`
+        usize used; // bump chunks: bytes used once the chunk was left, dedicated: bytes asked
+    };
+
+    Chunk *current     = nullptr; // bump chunk allocations are carved from
+    Chunk *large       = nullptr; // dedicated chunks, newest first
+    Chunk *spare       = nullptr; // released bump chunks kept for reuse (through `prev`)
+    Chunk *spare_large = nullptr; // recycled dedicated chunks (through `next`)
+    char *at = nullptr, *end = nullptr;
+    char *floor = nullptr; // allocations below it are not grown in place (see `mark`)
+    usize chunk_size;
+    u64 serial = 0;
+    usize reserved_bytes = 0, peak_bytes = 0;
+
+    static char *data(const Chunk *chunk)
+    {
+        return reinterpret_cast<char *>(const_cast<Chunk *>(chunk) + 1);
+    }
+    void *alloc_slow(const usize size, const usize align);
+    void *alloc_large(const usize size);
+    // first chunk of a spare list holding `size` bytes, unlinked from the list
+    static Chunk *take_spare(Chunk **list, Chunk *Chunk::*link, const usize size);
+    Chunk *find_large(const void *ptr) const;
+    void release(Chunk *chunk);
+
+    public:
+    Arena(const usize chunk_size = ARENA_CHUNK_SIZE);
+    ~Arena();
+    Arena(const Arena &)            = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *alloc(const usize size, const usize align = ARENA_ALIGN);
+    // like realloc, `ptr` has to be the last allocation of `old_size` bytes to grow in place
+    void *grow(void *ptr, const usize old_size, const usize new_size,
+               const usize align = ARENA_ALIGN);
+    char *strndup(cstr src, const usize length);
+
+    template <typename T>
+    T *alloc_array(const usize count)
+    {
+        return static_cast<T *>(alloc(count * sizeof(T), alignof(T)));
+    }
+
+    // constructs a T in the arena, its destructor is never called
+    template <typename T, typename... Args>
+    T *make(Args &&...args)
+    {
+        return new (alloc(sizeof(T), alignof(T))) T(static_cast<Args &&>(args)...);
+    }
+
+    ArenaMark mark();
+    void rollback(const ArenaMark);
+    void reset(); // rollback to an empty arena, keeps a chunk around
+    void recycle(); // empties the arena, every chunk is kept for reuse
+
+    usize used() const;     // bytes handed out, including alignment padding
+    usize reserved() const { return reserved_bytes; } // bytes taken from malloc
+    usize peak() const { return peak_bytes; }
+};
+
+// rolls the arena back to where it was when the scope was entered
+class ArenaScope
+{
+    Arena *arena;
+    ArenaMark saved;
+
+    public:
+    ArenaScope(Arena *arena) : arena(arena), saved(arena->mark()) {}
+    ~ArenaScope() { arena->rollback(saved); }
+    ArenaScope(const ArenaScope &)            = delete;
+    ArenaScope &operator=(const ArenaScope &) = delete;
+};
+
+inline void *
+Arena::alloc(const usize size, const usize align)
+{
+    // NOTE: the common case, the next aligned bytes of the current chunk
+    char *p = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(at) + align - 1) &
+                                       ~(uintptr_t)(align - 1));
+    if (at && p + size <= end)
+    {
+        at = p + size;
+        return p;
+    }
+    return alloc_slow(size, align);
+}
+
+} // namespace rotate
@@ -15,6 +15,7 @@ enum class Stage : u8
     tchecker,
     logger,
 };
+constexpr u8 STAGE_COUNT = (u8)Stage::logger + 1;
 
 /*
  *  Utilites
@@ -27,8 +28,10 @@ void exit_error(cstr);
 void log_debug(cstr);
 void log_info(cstr);
 void log_warn(cstr);
+cstr stage_describe(const Stage);
 
 char *strndup(cstr, const usize);
+u64 time_ns(); // monotonic clock
 //
 uint get_digits_from_number(uint);
 // bitwise operations
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common.hpp"
+#include "log_writer.hpp"
 
 namespace rotate
 {
@@ -9,8 +10,29 @@ static void
 print_version_and_exit()
 {
     cstr out = " Rotate Compiler \n Version: %s\n"
+               " usage: vr file.vr [more.vr...] [flags]\n"
                " --lex   for lexical analysis\n"
                " --log   for dumping compilation info as orgmode format in output.org\n"
+               " --log=org|json|binary   the log format, json-lines in output.jsonl, binary in\n"
+               "     output.bin\n"
+               " --lexer=simd|scalar   select the lexer engine (default: scalar)\n"
+               " --jobs=N   lex large files in N parallel chunks (default: 1)\n"
+               " --read=mmap|buffered   how large sources are loaded (default: mmap)\n"
+               " --ascii   only accept ascii sources (default: UTF-8)\n"
+               " --stats   print memory per stage and token density statistics\n"
+               " --timer   print the wall time of every stage\n"
+               " --perf-counters   also count cycles, instructions and misses per stage (Linux)\n"
+               " --trace=FILE   write a Chrome trace of the stages and threads to FILE\n"
+               " --module-path=DIR[:DIR...]   where imported modules are looked for after the\n"
+               "     main file's directory\n"
+               " --no-imports   do not load the imported modules\n"
+               " --cache   reuse the tokens of unchanged sources from the token cache\n"
+               " --cache-dir=DIR   where lexed tokens are cached, implies --cache (default:\n"
+               "     ~/.cache/rotate)\n"
+               " --no-cache   always lex, neither read nor write the token cache (default)\n"
+               " --batch=FILE   also compile every file listed in FILE, one per line\n"
+               " --workers=N   files compiled in parallel in batch mode (default: one per cpu)\n"
+               " --no-uring   read batch sources one by one instead of with io_uring (Linux)\n"
                " https://github.com/Airbus5717/rotate.git"
                "\n";
     fprintf(stdout, out, RTVERSION);
@@ -21,39 +43,139 @@ struct compile_options
 {
     const s32 argc;
     char **const argv;
-    cstr filename      = NULL;
+    cstr filename      = NULL; // the first input
+    cstr batch_list    = NULL;
+    cstr log_path      = "output.org";
+    cstr trace_path    = NULL;
+    cstr cache_dir     = NULL; // NULL: the default, see TokenCache
+    cstr module_path   = NULL; // ':' separated directories
     bool debug_info    = false;
     bool debug_symbols = false;
     bool timer         = false;
+    bool perf_counters = false;
     bool lex_only      = false;
-    Stage st           = Stage::unknown;
+    bool simd_lexer    = false;
+    bool stats         = false;
+    bool map_file      = true;
+    bool ascii_only    = false;
+    bool cache         = false; // opt-in, it writes to the user's cache directory
+    bool imports       = true;
+    bool uring         = true; // batch sources are read with `file_read_batch`
+    uint jobs          = 1;
+    uint workers       = 0; // 0: one per cpu
+    uint inputs        = 0; // inputs on the command line
+    // of the log written to `log_path` with --log
+    LogFormat log_format = LogFormat::org;
+    // filled by `compile`
+    Stage st          = Stage::unknown;
+    uint source_bytes = 0;
+    usize token_count = 0;
+    uint modules      = 0; // the main source and the modules it imports
 
     compile_options(const s32 argc, char **argv) : argc(argc), argv(argv)
     {
-        filename = argv[1];
-        for (s32 i = 2; i < argc; i++)
+        for (s32 i = 1; i < argc; i++)
         {
             auto string = argv[i];
 
-            if (strcmp(string, "--log") == 0) { debug_info = true; }
+            if (is_input(string))
+            {
+                if (!filename) filename = string;
+                inputs++;
+            }
+            else if (strcmp(string, "--log") == 0) { debug_info = true; }
+            else if (strncmp(string, "--log=", 6) == 0) { set_log_format(string); }
             else if (!strcmp(string, "--version") || !strcmp(string, "-v"))
             {
                 print_version_and_exit();
             }
             else if (strcmp(string, "--timer") == 0) { timer = true; }
+            else if (strcmp(string, "--perf-counters") == 0) { timer = perf_counters = true; }
             else if (strcmp(string, "--lex") == 0) { lex_only = true; }
+            else if (strcmp(string, "--stats") == 0) { stats = true; }
+            else if (strcmp(string, "--ascii") == 0) { ascii_only = true; }
+            else if (strcmp(string, "--read=mmap") == 0) { map_file = true; }
+            else if (strcmp(string, "--read=buffered") == 0) { map_file = false; }
+            else if (strcmp(string, "--cache") == 0) { cache = true; }
+            else if (strcmp(string, "--no-cache") == 0) { cache = false; }
+            else if (strcmp(string, "--no-imports") == 0) { imports = false; }
+            else if (strcmp(string, "--no-uring") == 0) { uring = false; }
+            else if (strncmp(string, "--module-path=", 14) == 0) { module_path = string + 14; }
+            else if (strncmp(string, "--cache-dir=", 12) == 0 && string[12])
+            {
+                cache_dir = string + 12;
+                cache     = true;
+            }
+            else if (strcmp(string, "--lexer=simd") == 0) { simd_lexer = true; }
+            else if (strcmp(string, "--lexer=scalar") == 0) { simd_lexer = false; }
+            else if (strncmp(string, "--jobs=", 7) == 0)
+            {
+                const long n = strtol(string + 7, nullptr, 10);
+                if (n < 1 || n > 256) { log_error_unknown_flag(string); }
+                else { jobs = (uint)n; }
+            }
+            else if (strncmp(string, "--batch=", 8) == 0) { batch_list = string + 8; }
+            else if (strncmp(string, "--trace=", 8) == 0 && string[8]) { trace_path = string + 8; }
+            else if (strncmp(string, "--workers=", 10) == 0)
+            {
+                const long n = strtol(string + 10, nullptr, 10);
+                if (n < 1 || n > 256) { log_error_unknown_flag(string); }
+                else { workers = (uint)n; }
+            }
             else { log_error_unknown_flag(string); }
         }
     }
 
+    static bool is_input(cstr arg) { return arg[0] != '-'; }
+    // several inputs or a list of them, see `compile_batch`
+    bool batch() const { return batch_list || inputs > 1; }
+
     ~compile_options() = default;
 
+    void set_log_format(cstr flag)
+    {
+        static const cstr NAMES[] = {"org", "json", "binary"};
+        static const cstr PATHS[] = {"output.org", "output.jsonl", "output.bin"};
+        for (u8 i = 0; i < 3; i++)
+        {
+            if (strcmp(flag + 6, NAMES[i]) != 0) continue;
+            debug_info = true;
+            log_format = (LogFormat)i;
+            log_path   = PATHS[i];
+            return;
+        }
+        log_error_unknown_flag(flag);
+    }
+
     void log_error_unknown_flag(cstr str)
     {
         fprintf(stderr, "[%sWARN%s] : Ignored flag: `%s`\n", LYELLOW, RESET, str);
     }
 };
 
-u8 compile(compile_options *options) noexcept;
+// one arena per stage, released together when `compile` returns
+struct StageArenas
+{
+    Arena arenas[STAGE_COUNT];
+
+    Arena *of(const Stage stage) { return &arenas[(u8)stage]; }
+    void recycle()
+    {
+        for (u8 i = 0; i < STAGE_COUNT; i++)
+            arenas[i].recycle();
+    }
+};
+
+class Lexer;
+struct file_t;
+
+// lexes the file, or loads its tokens from the token cache when it has them
+u8 lex_file(const compile_options *options, const file_t *file, Lexer *lexer);
+// compiles `options->filename`, the stage allocations go to `arenas` when given;
+// `source` is the file when it was read already (a batch reads ahead of its workers)
+u8 compile(compile_options *options, StageArenas *arenas = nullptr,
+           file_t *source = nullptr) noexcept;
+// compiles every input of the command line and of `options->batch_list`
+u8 compile_batch(compile_options *options) noexcept;
 
 } // namespace rotate
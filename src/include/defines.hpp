@@ -29,6 +29,8 @@ typedef uint8_t u8;
 typedef uint16_t u16;
 typedef uint32_t u32;
 typedef uint64_t u64;
+// a gcc/clang extension, only for 64x64 -> 128 bit products
+__extension__ typedef unsigned __int128 u128;
 
 typedef unsigned long long usize;
 typedef signed long long ssize;
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "common.hpp"
+
+namespace rotate
+{
+
+/*
+ *  BLAKE2b (RFC 7693) with a 32 byte output and no key
+ *  - a cryptographic digest: two different sources never share one in practice,
+ *    unlike the 64-bit `simd_hash` that only spreads them
+ *  - one 128 byte block per compression, 12 rounds, about 1 GB/s on a 64-bit core
+ *  the input is read as little endian words
+ */
+
+constexpr uint DIGEST_BYTES = 32;
+
+void digest(cstr data, const usize length, u8 out[DIGEST_BYTES]) noexcept;
+
+} // namespace rotate
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common.hpp"
+#include "mem_stats.hpp"
 
 namespace rotate
 {
@@ -11,15 +12,22 @@ enum class valid : u8
     failure,
 };
 
+// sources at least this large are mapped instead of copied (when mapping is allowed)
+constexpr usize FILE_MAP_THRESHOLD = 64 * 1024;
+
+// releases the read-only mapping of a mapped file_t
+void file_unmap(cstr contents, const usize mapped) noexcept;
+
 struct file_t
 {
     cstr name;
     cstr contents;
     const uint length = 0; // contents length
     valid valid_code;
+    usize mapped = 0; // bytes of the mapping holding contents, 0 for a new[] buffer
 
-    file_t(cstr name, cstr contents, const uint length, valid valid_code)
-        : name(name), contents(contents), length(length), valid_code(valid_code)
+    file_t(cstr name, cstr contents, const uint length, valid valid_code, const usize mapped = 0)
+        : name(name), contents(contents), length(length), valid_code(valid_code), mapped(mapped)
     {
     }
 
@@ -32,9 +40,34 @@ struct file_t
         else { fprintf(output, "%s\n", contents); }
     }
 
-    ~file_t() { delete[] contents; };
+    ~file_t()
+    {
+        if (mapped)
+        {
+            file_unmap(contents, mapped);
+            return;
+        }
+        if (contents) mem_track_free(length + EXTRA_NULL_TERMINATORS);
+        delete[] contents;
+    };
 };
 
-file_t file_read(cstr name) noexcept;
+// `map` allows the mmap path, the buffered read is the fallback
+// the contents are valid UTF-8 (ASCII when `ascii_only`) without tabs, '\r' or NUL
+file_t file_read(cstr name, const bool map = true, const bool ascii_only = false) noexcept;
+
+// a source of `file_read_batch` was read, `file` (failed or not) belongs to the callee
+typedef void (*FileReadFn)(void *arg, const uint index, file_t *file);
+
+// reads `count` sources with io_uring, batches of openat/statx/read/close go to the
+// kernel at once and every source is handed to `on_read` as soon as it was read;
+// false when `uring` is off or the kernel cannot do it, then each is read by `file_read`
+bool file_read_batch(cstr const *names, const uint count, FileReadFn on_read, void *arg,
+                     const bool map = true, const bool ascii_only = false,
+                     const bool uring = true) noexcept;
+// the kernel has io_uring and the operations `file_read_batch` needs
+bool file_uring_supported() noexcept;
+// the check `file_read` makes of a source, the first error is printed
+bool file_validate(cstr name, cstr contents, const uint length, const bool ascii_only) noexcept;
 
 } // namespace rotate
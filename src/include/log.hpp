@@ -2,10 +2,23 @@
 
 #include "../fe/lexer.hpp"
 #include "common.hpp"
+#include "log_writer.hpp"
 
 namespace rotate
 {
 
-void log_compilation(FILE *, file_t *, Lexer *);
+struct StageArenas;
+class ModuleGraph;
+
+// SUCCESS once the whole log was written, the caller reports it
+u8 log_compilation(FILE *, file_t *, Lexer *, const LogFormat = LogFormat::org);
+// memory per stage and token density, for `--stats`
+void log_stats(FILE *, const file_t *, Lexer *, StageArenas *);
+// the modules in load order with their sizes and imports, for `--stats`
+void log_modules(FILE *, const ModuleGraph *);
+// memory per stage, the arena columns are summed over `count` StageArenas
+void log_memory(FILE *, StageArenas *, const uint count);
+// wall time per stage and the hardware counters when counted, for `--timer`
+void log_times(FILE *, const usize tokens);
 
 };
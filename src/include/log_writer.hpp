@@ -0,0 +1,78 @@
+#pragma once
+
+#include "defines.hpp"
+
+namespace rotate
+{
+
+/*
+ *  LogWriter: buffered output of the compilation logs
+ *  - records are copied into one LOG_BUFFER_SIZE buffer written out with fwrite
+ *    when full, nothing is allocated per record
+ *  - integers are formatted by hand two digits at a time, strings with memcpy;
+ *    only floats and the header lines go through snprintf
+ *  - binary values are little endian whatever the host
+ *  a failed write is remembered and reported by `flush`
+ */
+
+constexpr usize LOG_BUFFER_SIZE = 1024 * 1024;
+
+enum class LogFormat : u8
+{
+    org,    // readable org-mode document
+    json,   // one JSON object per line
+    binary, // compact records, see log_compilation in log.cpp
+};
+
+cstr log_format_extension(const LogFormat);
+
+class LogWriter
+{
+    FILE *output;
+    char *buffer;
+    usize used  = 0;
+    bool failed = false;
+
+    void drain();
+    void put_slow(cstr str, const usize length);
+    // room for `bytes` (at most LOG_BUFFER_SIZE) at the end of the buffer
+    char *reserve(const usize bytes)
+    {
+        if (used + bytes > LOG_BUFFER_SIZE) drain();
+        return buffer + used;
+    }
+
+    public:
+    LogWriter(FILE *output);
+    ~LogWriter();
+    LogWriter(const LogWriter &)            = delete;
+    LogWriter &operator=(const LogWriter &) = delete;
+
+    void put(const char c)
+    {
+        if (used == LOG_BUFFER_SIZE) drain();
+        buffer[used++] = c;
+    }
+    void put(cstr str, const usize length)
+    {
+        if (used + length > LOG_BUFFER_SIZE) return put_slow(str, length);
+        memcpy(buffer + used, str, length);
+        used += length;
+    }
+    void put(cstr str) { put(str, strlen(str)); }
+    void put_uint(u64 value);
+    void put_float(const f64 value); // %.17g
+    // `str` escaped for a JSON string, without the quotes
+    void put_json(cstr str, const usize length);
+    // cold paths, the formatted text must fit in 1 KiB
+    void put_format(cstr format, ...) __attribute__((format(printf, 2, 3)));
+
+    void put_u8(const u8 value) { put((char)value); }
+    void put_u32(const u32 value);
+    void put_u64(const u64 value);
+
+    // FAILURE when any write failed
+    u8 flush();
+};
+
+} // namespace rotate
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "defines.hpp"
+
+namespace rotate
+{
+
+/*
+ *  Heap accounting per compiler Stage
+ *  - Array, SmallArray, Arena chunks, file_read and strndup report their
+ *    allocations, reallocations and frees here, they are charged to the
+ *    stage that is running when they happen
+ *  - `peak` is the highest amount of live tracked bytes seen while a stage ran
+ *  - the running stage is per thread, ThreadPool tasks run in the stage of the
+ *    thread that submitted them; the counters are shared and atomic
+ */
+
+enum class Stage : u8;
+
+struct StageMemory
+{
+    usize allocations; // malloc and growing realloc calls
+    usize frees;
+    usize allocated; // bytes, a reallocation counts its growth
+    usize freed;
+    usize peak; // live bytes
+};
+
+void mem_set_stage(const Stage);
+Stage mem_stage();
+
+void mem_track_alloc(const usize bytes);
+void mem_track_resize(const usize old_bytes, const usize new_bytes);
+void mem_track_free(const usize bytes);
+
+StageMemory mem_stage_stats(const Stage);
+usize mem_live(); // tracked bytes currently allocated
+
+} // namespace rotate
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "defines.hpp"
+
+namespace rotate
+{
+
+/*
+ *  compile time helpers (C++11 has no std::index_sequence)
+ */
+
+template <uint... Is>
+struct index_seq
+{
+};
+
+template <uint N, uint... Is>
+struct make_index_seq : make_index_seq<N - 1, N - 1, Is...>
+{
+};
+
+template <uint... Is>
+struct make_index_seq<0, Is...>
+{
+    typedef index_seq<Is...> type;
+};
+
+constexpr uint
+cstr_len(cstr str, const uint i = 0)
+{
+    return str[i] == '\0' ? i : cstr_len(str, i + 1);
+}
+
+// smallest power of two that is >= n
+constexpr uint
+next_pow2(const uint n, const uint p = 1)
+{
+    return p >= n ? p : next_pow2(n, p << 1);
+}
+
+constexpr uint
+log2_pow2(const uint p)
+{
+    return p <= 1 ? 0 : 1 + log2_pow2(p >> 1);
+}
+
+} // namespace rotate
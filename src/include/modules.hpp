@@ -0,0 +1,95 @@
+#pragma once
+
+#include "../fe/lexer.hpp"
+#include "compile.hpp"
+#include "source_manager.hpp"
+#include "thread_pool.hpp"
+
+namespace rotate
+{
+
+/*
+ *  ModuleGraph: the modules reachable from the main source through imports
+ *  - `import "std/io";` and `import "std/os" as os;` are found by scanning a
+ *    module's tokens for Import String (As Identifier)
+ *  - "a/b" is `<dir>/a/b.vr` for the first directory of the search path that
+ *    has it: the main source's directory, then every --module-path entry
+ *  - every module is read and lexed once, as a task on a ThreadPool; the task
+ *    queues the modules its imports discover, so a wide graph keeps every
+ *    worker busy, and modules are told apart by their real path
+ *  - `order` then lists the modules, every one after the modules it imports;
+ *    an import cycle is an error
+ *  - every module read is added to `sources`, a token of any module is then
+ *    one SrcLoc, see `location`
+ *  module 0 is the main source, its file and lexer belong to the caller
+ */
+
+constexpr u32 MODULE_NONE  = UINT32_MAX;
+constexpr TknIdx NO_ALIAS  = UINT_MAX;
+constexpr uint MODULE_PATH = 4096;
+
+struct ModuleImport
+{
+    u32 module;   // MODULE_NONE if the path was not found
+    TknIdx path;  // the String token
+    TknIdx alias; // the Identifier token after `as`, NO_ALIAS if none
+};
+
+class ModuleGraph;
+
+struct Module
+{
+    ModuleGraph *graph;
+    cstr path; // real path, owned by the graph
+    file_t *file    = nullptr;
+    Lexer *lexer    = nullptr;
+    bool owned      = true; // file and lexer are deleted with the module
+    u8 status       = FAILURE;
+    SourceId source = SOURCE_NONE;
+    Array<ModuleImport> imports;
+
+    Module(ModuleGraph *graph, cstr path) : graph(graph), path(path), imports(4) {}
+    ~Module();
+};
+
+class ModuleGraph
+{
+    const compile_options *options;
+    Array<char *> search; // directories
+    Array<Module *> modules;
+    SymbolTable paths; // real path -> module id
+    pthread_mutex_t lock; // `modules` and `paths` while loading
+    ThreadPool *pool = nullptr;
+    Array<Module *> pending; // found before the pool starts, or by any load on one thread
+
+    static void load(void *module);
+    void scan(Module *);
+    u32 resolve(const Module *from, const TknIdx import);
+    u8 add_source(Module *);
+    // "path:line:column" of token `i` of `module`
+    void describe(char *out, const usize size, const Module *module, const TknIdx i);
+    u32 add(cstr real_path, Module **added);
+    u8 sort();
+
+    public:
+    Array<u32> order;
+    SourceManager sources;
+
+    ModuleGraph(const compile_options *);
+    ~ModuleGraph();
+    ModuleGraph(const ModuleGraph &)            = delete;
+    ModuleGraph &operator=(const ModuleGraph &) = delete;
+
+    // loads every module imported from the lexed main source on `workers` threads,
+    // FAILURE if one could not be read or lexed or the imports form a cycle
+    u8 load_imports(file_t *main_file, Lexer *main_lexer, const uint workers);
+
+    usize count() const { return modules.count(); }
+    const Module *module(const u32 id) const { return modules[id]; }
+    // the global location of token `i` of `module`
+    SrcLoc location(const Module *module, const TknIdx i) const;
+    usize tokens() const; // of every module
+    usize bytes() const;  // of every module
+};
+
+} // namespace rotate
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "defines.hpp"
+
+namespace rotate
+{
+
+/*
+ *  Hardware performance counters per compiler Stage (Linux perf_event_open)
+ *  - every thread that times a stage opens its own counters on first use,
+ *    they count user space only and are read when a StageTimer changes stage
+ *  - threads started while a stage runs (parallel lexing) inherit the counters,
+ *    their counts are added when they exit, so before the stage ends
+ *  - a counter the kernel or the machine refuses (perf_event_paranoid, no PMU
+ *    in a VM...) stays unavailable, the others are still counted
+ *  - multiplexed counters are scaled by their enabled / running time
+ */
+
+enum class Stage : u8;
+
+enum class Counter : u8
+{
+    cycles,
+    instructions,
+    branch_misses,
+    l1d_misses, // L1 data cache read misses
+    llc_misses, // last level cache read misses
+};
+constexpr u8 COUNTER_COUNT = 5;
+
+struct StageCounters
+{
+    u64 value[COUNTER_COUNT];
+};
+
+// opens the counters of the calling thread, FAILURE (with a warning) when none is available
+u8 perf_start();
+bool perf_counting();
+bool perf_available(const Counter);
+
+// the counts of the calling thread so far, false when not counting
+bool perf_read(u64 counts[COUNTER_COUNT]);
+// charges the counts between two `perf_read` to `stage`
+void perf_add(const Stage, const u64 before[COUNTER_COUNT], const u64 after[COUNTER_COUNT]);
+StageCounters stage_counters(const Stage);
+
+} // namespace rotate
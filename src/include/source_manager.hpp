@@ -0,0 +1,70 @@
+#pragma once
+
+#include "../fe/lines.hpp"
+#include "file.hpp"
+
+#include <pthread.h>
+
+namespace rotate
+{
+
+/*
+ *  SourceManager: every loaded source in one 32-bit offset space
+ *  - a source is given the range [base, base + length], the extra location is
+ *    its end (EOT); bases are handed out in load order, so the ranges are sorted
+ *  - a location (SrcLoc) is base + byte offset, a token of any module is then
+ *    named by a single u32 instead of a file pointer and an offset
+ *  - the source of a location is a binary search of the range table, its line
+ *    a binary search of that source's LineIndex, built on the first lookup
+ *  sources are added from the threads loading modules, lookups may run meanwhile
+ */
+
+typedef u32 SrcLoc;
+typedef u32 SourceId;
+constexpr SrcLoc SRC_LOC_NONE  = UINT32_MAX;
+constexpr SourceId SOURCE_NONE = UINT32_MAX;
+
+// a location decoded, `file` is nullptr when it is in no source
+struct SourceSpot
+{
+    const file_t *file;
+    SourceId source;
+    uint offset, line, column;
+    uint line_start, line_end; // offsets of the line's first byte and of its '\n'
+};
+
+class SourceManager
+{
+    struct Range
+    {
+        SrcLoc base;
+        uint length;
+        const file_t *file; // not owned
+        LineIndex *lines;   // nullptr until a location of the source is decoded
+    };
+    Array<Range> ranges;
+    SrcLoc next = 0; // base of the next source
+    mutable pthread_mutex_t lock;
+
+    SourceId find(const SrcLoc loc) const;
+
+    public:
+    SourceManager();
+    ~SourceManager();
+    SourceManager(const SourceManager &)            = delete;
+    SourceManager &operator=(const SourceManager &) = delete;
+
+    // SOURCE_NONE when the offset space is full
+    SourceId add(const file_t *file);
+    // the location of byte `offset` of `source`, SRC_LOC_NONE past its end
+    SrcLoc location(const SourceId source, const uint offset) const;
+    // the source holding `loc`, SOURCE_NONE if none does
+    SourceId source_of(const SrcLoc loc) const;
+    SourceSpot spot(const SrcLoc loc);
+
+    usize count() const;
+    const file_t *file(const SourceId source) const;
+    SrcLoc base(const SourceId source) const;
+};
+
+} // namespace rotate
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <pthread.h>
+
+namespace rotate
+{
+
+/*
+ *  ThreadPool: fixed set of pthread workers running submitted tasks
+ *  a pool of 1 thread runs every task inline on the calling thread
+ */
+
+typedef void (*TaskFn)(void *arg);
+
+struct Task
+{
+    TaskFn fn;
+    void *arg;
+    Stage stage; // the submitter's, for the memory accounting
+};
+
+class ThreadPool
+{
+    pthread_t *threads = nullptr;
+    uint num_threads   = 0;
+    pthread_mutex_t lock;
+    pthread_cond_t has_work, all_done;
+
+    // ring buffer of queued tasks
+    Task *queue     = nullptr;
+    uint q_capacity = 0, q_head = 0, q_count = 0;
+    uint running    = 0;
+    bool stopping   = false;
+
+    static void *worker(void *pool);
+
+    public:
+    ThreadPool(const uint threads);
+    ~ThreadPool();
+
+    void submit(TaskFn fn, void *arg);
+    void wait(); // blocks until every submitted task has finished
+    uint size() const { return num_threads; }
+};
+
+// number of online cpus, at least 1
+uint hardware_threads() noexcept;
+
+} // namespace rotate
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "common.hpp"
+#include "perf.hpp"
+
+namespace rotate
+{
+
+/*
+ *  Wall clock timing of the compiler
+ *  - StageTimer: the stages of one compilation, the time of every Stage is
+ *    summed over the files and threads for `--timer`
+ *  - TimeScope: a named piece of work inside a stage (a lexed chunk...)
+ *  - with `trace_start`, stages and scopes are also recorded as Chrome trace
+ *    events, `trace_write` saves them for chrome://tracing or Perfetto
+ *  - with `perf_start`, StageTimer also charges the hardware counters to the stage
+ *  a scope costs two reads of the monotonic clock, and a locked append when tracing
+ */
+
+struct StageTime
+{
+    u64 ns;
+    uint runs;
+};
+
+StageTime stage_time(const Stage);
+
+void trace_start();
+bool tracing();
+// writes the recorded events as a JSON trace, FAILURE if the file cannot be written
+u8 trace_write(cstr path);
+// `detail` is copied, it shows as the event's "file" argument
+void trace_event(cstr name, cstr category, cstr detail, const u64 start, const u64 end);
+
+class StageTimer
+{
+    cstr file;
+    Stage current = Stage::unknown;
+    u64 start     = 0;
+    u64 counts[COUNTER_COUNT]; // at `start`, when counting
+
+    public:
+    StageTimer(cstr file) : file(file) {}
+    ~StageTimer() { enter(Stage::unknown); }
+    StageTimer(const StageTimer &)            = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+
+    // ends the running stage, Stage::unknown starts none
+    void enter(const Stage);
+};
+
+class TimeScope
+{
+    cstr name, category, detail;
+    u64 start;
+
+    public:
+    TimeScope(cstr name, cstr category, cstr detail = nullptr)
+        : name(name), category(category), detail(detail), start(tracing() ? time_ns() : 0)
+    {
+    }
+    ~TimeScope()
+    {
+        if (start) trace_event(name, category, detail, start, time_ns());
+    }
+    TimeScope(const TimeScope &)            = delete;
+    TimeScope &operator=(const TimeScope &) = delete;
+};
+
+} // namespace rotate
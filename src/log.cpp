@@ -2,55 +2,157 @@
 #include "include/common.hpp"
 #include "include/compile.hpp"
 #include "include/file.hpp"
+#include "include/log_writer.hpp"
+#include "include/mem_stats.hpp"
+#include "include/modules.hpp"
+#include "include/perf.hpp"
+#include "include/timer.hpp"
 
 #include "fe/lexer.hpp"
 
 namespace rotate
 {
 
-void
-log_compilation(FILE *output, file_t *code_file, Lexer *lexer)
+// lines of the tokens in order, one step at a time instead of a search per token
+struct LineCursor
+{
+    const LineIndex *lines;
+    uint line;
+
+    uint at(const uint offset)
+    {
+        while (line < lines->count() && lines->line_end(line) < offset)
+            line++;
+        return line;
+    }
+};
+
+// the org-mode document of `--log`
+static void
+log_org(LogWriter *out, const file_t *code_file, Lexer *lexer)
 {
     time_t rawtime;
     time(&rawtime);
-    assert(code_file && lexer);
+    const TokenStream *tokens = lexer->get_tokens();
+    const usize count         = tokens->count();
+    out->put("#+TITLE: COMPILATION LOG" NEWLINE);
+    out->put("#+OPTIONS: toc:nil num:nil" NEWLINE);
+    out->put("#+AUTHOR: Rotate compiler" NEWLINE);
+    out->put_format("#+DATE: %s" NEWLINE, asctime(localtime(&rawtime)));
+    out->put("** Meta\n");
+    out->put_format("- filename: =%s=" NEWLINE, code_file->name);
+    out->put_format("- file length(chars): %u chars" NEWLINE, code_file->length);
+    out->put_format("- time: %s", asctime(localtime(&rawtime)));
+    out->put_format("- number of tokens: %llu" NEWLINE, count);
+    out->put_format("- tokens memory: %llu bytes (%.2f bytes per token)" NEWLINE,
+                    tokens->memory(), (f64)tokens->memory() / (f64)count);
+    const SymbolTable *symbols = tokens->symbols();
+    const usize lookups        = symbols->lookup_count();
+    out->put_format("- symbols: %llu distinct, %llu lookups, %.2f%% hit rate" NEWLINE,
+                    symbols->count(), lookups,
+                    lookups ? 100.0 * (f64)symbols->hit_count() / (f64)lookups : 0.0);
+    out->put_format("- symbols memory: %llu bytes" NEWLINE NEWLINE, symbols->memory());
+    out->put("** FILE" NEWLINE);
+    out->put("#+begin_src cpp " NEWLINE);
+    out->put(code_file->contents, code_file->length);
+    out->put(NEWLINE "#+end_src" NEWLINE NEWLINE);
 
-    const auto tokens = lexer->get_tokens();
-    if (tokens->count() > 0x10000000)
+    // TOKENS LOG STAGE
+    out->put("** TOKENS" NEWLINE);
+    out->put("#+begin_src" NEWLINE);
+    LineCursor lines = {lexer->get_lines(), 1};
+    for (uint i = 0; i < count; i++)
     {
-        log_warn("Too large file to show log");
-        return;
-    }
-    log_warn("Logging will slow down compiliation ");
-    fprintf(output, "#+TITLE: COMPILATION LOG" NEWLINE);
-    fprintf(output, "#+OPTIONS: toc:nil num:nil" NEWLINE);
-    fprintf(output, "#+AUTHOR: Rotate compiler" NEWLINE);
-    fprintf(output, "#+DATE: %s" NEWLINE, asctime(localtime(&rawtime)));
-    fprintf(output, "** Meta\n");
-    fprintf(output, "- filename: =%s=" NEWLINE, code_file->name);
-    fprintf(output, "- file length(chars): %u chars" NEWLINE, code_file->length);
-    fprintf(output, "- time: %s", asctime(localtime(&rawtime)));
-    fprintf(output, "- number of tokens: %llu" NEWLINE NEWLINE, tokens->count());
-    fprintf(output, "** FILE" NEWLINE);
-    fprintf(output, "#+begin_src cpp " NEWLINE "%s" NEWLINE "#+end_src" NEWLINE NEWLINE,
-            code_file->contents);
+        const Token tkn = tokens->at(i);
+        out->put("[TOKEN]: n: ");
+        out->put_uint(i);
+        out->put(", idx: ");
+        out->put_uint(tkn.index);
+        out->put(", line: ");
+        out->put_uint(lines.at(tkn.index));
+        out->put(", len: ");
+        out->put_uint(tkn.length);
+        out->put(", type: ");
+        out->put(tkn_type_describe(tkn.type));
+        out->put(", val: `");
+        out->put(code_file->contents + tkn.index, tkn.length);
+        out->put("`" NEWLINE);
+    }
+    out->put("#+end_src" NEWLINE);
 
-    // TOKENS LOG STAGE
-    fprintf(output, "** TOKENS" NEWLINE);
-    fprintf(output, "#+begin_src" NEWLINE);
-    for (uint i = 0; i < tokens->count(); i++)
+    // decoded literal values
+    const LiteralPool *literals = tokens->literals();
+    out->put("** LITERALS" NEWLINE);
+    out->put("#+begin_src" NEWLINE);
+    for (uint i = 0; i < count; i++)
     {
-        const Token &tkn = tokens->at(i);
-        fprintf(output, "[TOKEN]: n: %u, idx: %u, line: %u, len: %u, type: %s, val: `%.*s`" NEWLINE,
-                i, tkn.index, tkn.line, tkn.length, tkn_type_describe(tkn.type), tkn.length,
-                code_file->contents + tkn.index);
+        const TknType type = tokens->type(i);
+        const u32 payload  = tokens->payload(i);
+        if (type != TknType::Integer && type != TknType::Float && type != TknType::Char) continue;
+        out->put("[LITERAL]: n: ");
+        out->put_uint(i);
+        if (type == TknType::Integer)
+        {
+            out->put(", type: Integer, value: ");
+            out->put_uint(literals->integer(payload));
+        }
+        else if (type == TknType::Float)
+        {
+            out->put(", type: Float, value: ");
+            out->put_float(literals->floating(payload));
+        }
+        else
+        {
+            out->put(", type: Char, value: ");
+            out->put_uint((u8)literals->character(payload));
+        }
+        out->put(NEWLINE);
     }
-    fprintf(output, "#+end_src" NEWLINE);
+    out->put("#+end_src" NEWLINE);
+
+    // string values, escaped strings were decoded into the pool
+    out->put("** STRINGS" NEWLINE);
+    out->put("#+begin_src" NEWLINE);
+    for (uint i = 0; i < count; i++)
+    {
+        if (tokens->type(i) != TknType::String) continue;
+        const u32 payload  = tokens->payload(i);
+        const StringView v = tokens->string(i);
+        out->put("[STRING]: n: ");
+        out->put_uint(i);
+        if (payload == STRING_VIEW) { out->put(", view"); }
+        else
+        {
+            out->put(", id: ");
+            out->put_uint(payload);
+        }
+        out->put(", len: ");
+        out->put_uint(v.length);
+        out->put(", value: `");
+        out->put(v.data, v.length);
+        out->put("`" NEWLINE);
+    }
+    out->put("#+end_src" NEWLINE);
+
+    // interned identifiers, by id
+    out->put("** SYMBOLS" NEWLINE);
+    out->put("#+begin_src" NEWLINE);
+    for (u32 id = 0; id < symbols->count(); id++)
+    {
+        out->put("[SYMBOL]: id: ");
+        out->put_uint(id);
+        out->put(", len: ");
+        out->put_uint(symbols->length(id));
+        out->put(", name: `");
+        out->put(symbols->name(id), symbols->length(id));
+        out->put("`" NEWLINE);
+    }
+    out->put("#+end_src" NEWLINE);
 
     // PARSER STAGE
-    fprintf(output, "\n** TODO Parser Abstract Syntax Tree" NEWLINE);
-    fprintf(output, "*** Imports " NEWLINE);
-    fprintf(output, "#+begin_src" NEWLINE);
+    out->put("\n** TODO Parser Abstract Syntax Tree" NEWLINE);
+    out->put("*** Imports " NEWLINE);
+    out->put("#+begin_src" NEWLINE);
     // for (uint i = 0; i < parser->ast->imports.count(); i++)
     // {
     //     const AstImport &m = parser->ast->imports[i];
@@ -60,9 +162,343 @@ log_compilation(FILE *output, file_t *code_file, Lexer *lexer)
     //     else
     //         fprintf(output, "[IMPORT]: n: %u, id_idx: %u " NEWLINE, i, m.import_str);
     // }
-    fprintf(output, "#+end_src" NEWLINE);
-    fprintf(output, NEWLINE "** TODO TYPECHECKER" NEWLINE);
-    log_info("Logging complete");
+    out->put("#+end_src" NEWLINE);
+    out->put(NEWLINE "** TODO TYPECHECKER" NEWLINE);
+}
+
+static void
+put_json_field(LogWriter *out, cstr key, cstr value, const usize length)
+{
+    out->put(key);
+    out->put('"');
+    out->put_json(value, length);
+    out->put('"');
+}
+
+// one object per line: the meta data, then every token, literal, string and symbol
+static void
+log_json(LogWriter *out, const file_t *code_file, Lexer *lexer)
+{
+    const TokenStream *tokens = lexer->get_tokens();
+    const usize count         = tokens->count();
+    put_json_field(out, "{\"kind\": \"meta\", \"file\": ", code_file->name,
+                   strlen(code_file->name));
+    out->put(", \"length\": ");
+    out->put_uint(code_file->length);
+    out->put(", \"tokens\": ");
+    out->put_uint(count);
+    out->put(", \"lines\": ");
+    out->put_uint(lexer->get_lines()->count());
+    out->put("}\n");
+
+    LineCursor lines = {lexer->get_lines(), 1};
+    for (uint i = 0; i < count; i++)
+    {
+        const Token tkn = tokens->at(i);
+        out->put("{\"kind\": \"token\", \"n\": ");
+        out->put_uint(i);
+        out->put(", \"offset\": ");
+        out->put_uint(tkn.index);
+        out->put(", \"line\": ");
+        out->put_uint(lines.at(tkn.index));
+        out->put(", \"length\": ");
+        out->put_uint(tkn.length);
+        cstr type = tkn_type_describe(tkn.type);
+        put_json_field(out, ", \"type\": ", type, strlen(type));
+        put_json_field(out, ", \"text\": ", code_file->contents + tkn.index, tkn.length);
+        out->put("}\n");
+    }
+
+    const LiteralPool *literals = tokens->literals();
+    for (uint i = 0; i < count; i++)
+    {
+        const TknType type = tokens->type(i);
+        const u32 payload  = tokens->payload(i);
+        if (type == TknType::String)
+        {
+            const StringView v = tokens->string(i);
+            out->put("{\"kind\": \"string\", \"n\": ");
+            out->put_uint(i);
+            put_json_field(out, ", \"value\": ", v.data, v.length);
+            out->put("}\n");
+            continue;
+        }
+        if (type != TknType::Integer && type != TknType::Float && type != TknType::Char) continue;
+        out->put("{\"kind\": \"literal\", \"n\": ");
+        out->put_uint(i);
+        if (type == TknType::Integer)
+        {
+            out->put(", \"type\": \"Integer\", \"value\": ");
+            out->put_uint(literals->integer(payload));
+        }
+        else if (type == TknType::Float)
+        {
+            // JSON has no infinity
+            const f64 value = literals->floating(payload);
+            out->put(", \"type\": \"Float\", \"value\": ");
+            if (std::isfinite(value)) { out->put_float(value); }
+            else { out->put("null"); }
+        }
+        else
+        {
+            out->put(", \"type\": \"Char\", \"value\": ");
+            out->put_uint((u8)literals->character(payload));
+        }
+        out->put("}\n");
+    }
+
+    const SymbolTable *symbols = tokens->symbols();
+    for (u32 id = 0; id < symbols->count(); id++)
+    {
+        out->put("{\"kind\": \"symbol\", \"id\": ");
+        out->put_uint(id);
+        put_json_field(out, ", \"name\": ", symbols->name(id), symbols->length(id));
+        out->put("}\n");
+    }
+}
+
+/*
+ *  binary log, every integer little endian
+ *  - header: "VRLOG", u8 version (1), u32 name length, the name, u32 source
+ *    length, u32 token count, u32 line count
+ *  - tokens: u8 type, u32 offset, u32 length, u32 line
+ *  - literals: u32 count, then u32 token, u8 type, u64 value (the bits of a Float)
+ *  - strings: u32 count, then u32 token, u32 length, the decoded value
+ *  - symbols: u32 count, then u32 length, the name
+ */
+static void
+log_binary(LogWriter *out, const file_t *code_file, Lexer *lexer)
+{
+    const TokenStream *tokens = lexer->get_tokens();
+    const u32 count           = (u32)tokens->count();
+    const u32 name_length     = (u32)strlen(code_file->name);
+    out->put("VRLOG", 5);
+    out->put_u8(1);
+    out->put_u32(name_length);
+    out->put(code_file->name, name_length);
+    out->put_u32(code_file->length);
+    out->put_u32(count);
+    out->put_u32(lexer->get_lines()->count());
+
+    LineCursor lines  = {lexer->get_lines(), 1};
+    u32 literal_count = 0, string_count = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        const Token tkn = tokens->at(i);
+        out->put_u8((u8)tkn.type);
+        out->put_u32(tkn.index);
+        out->put_u32(tkn.length);
+        out->put_u32(lines.at(tkn.index));
+        literal_count += tkn.type == TknType::Integer || tkn.type == TknType::Float ||
+                         tkn.type == TknType::Char;
+        string_count += tkn.type == TknType::String;
+    }
+
+    const LiteralPool *literals = tokens->literals();
+    out->put_u32(literal_count);
+    for (u32 i = 0; i < count; i++)
+    {
+        const TknType type = tokens->type(i);
+        const u32 payload  = tokens->payload(i);
+        u64 value          = 0;
+        if (type == TknType::Integer) { value = literals->integer(payload); }
+        else if (type == TknType::Char) { value = (u8)literals->character(payload); }
+        else if (type == TknType::Float)
+        {
+            const f64 floating = literals->floating(payload);
+            memcpy(&value, &floating, sizeof(value));
+        }
+        else { continue; }
+        out->put_u32(i);
+        out->put_u8((u8)type);
+        out->put_u64(value);
+    }
+
+    out->put_u32(string_count);
+    for (u32 i = 0; i < count; i++)
+    {
+        if (tokens->type(i) != TknType::String) continue;
+        const StringView v = tokens->string(i);
+        out->put_u32(i);
+        out->put_u32(v.length);
+        out->put(v.data, v.length);
+    }
+
+    const SymbolTable *symbols = tokens->symbols();
+    out->put_u32((u32)symbols->count());
+    for (u32 id = 0; id < symbols->count(); id++)
+    {
+        out->put_u32(symbols->length(id));
+        out->put(symbols->name(id), symbols->length(id));
+    }
+}
+
+u8
+log_compilation(FILE *output, file_t *code_file, Lexer *lexer, const LogFormat format)
+{
+    assert(code_file && lexer);
+    if (lexer->get_tokens()->count() > 0x10000000)
+    {
+        log_warn("Too large file to show log");
+        return FAILURE;
+    }
+
+    LogWriter out(output);
+    switch (format)
+    {
+        case LogFormat::org: log_org(&out, code_file, lexer); break;
+        case LogFormat::json: log_json(&out, code_file, lexer); break;
+        case LogFormat::binary: log_binary(&out, code_file, lexer); break;
+    }
+    if (out.flush() != SUCCESS)
+    {
+        log_error("Log write failed");
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+static cstr
+stage_name(const Stage stage)
+{
+    switch (stage)
+    {
+        case Stage::unknown: return "unknown";
+        case Stage::file: return "file";
+        case Stage::lexer: return "lexer";
+        case Stage::parser: return "parser";
+        case Stage::tchecker: return "tchecker";
+        case Stage::logger: return "logger";
+    }
+    return "unknown";
+}
+
+static f64
+kib(const usize bytes)
+{
+    return (f64)bytes / 1024.0;
+}
+
+void
+log_memory(FILE *output, StageArenas *arenas, const uint count)
+{
+    // charged to the stage that was running when it was allocated
+    fprintf(output, "[%sSTATS%s] : memory per stage (KiB)" NEWLINE, LGREEN, RESET);
+    fprintf(output, "  %-9s %9s %9s %12s %12s %12s %12s %12s" NEWLINE, "stage", "allocs",
+            "frees", "allocated", "freed", "peak", "arena used", "arena rsv");
+    for (u8 i = 0; i < STAGE_COUNT; i++)
+    {
+        const Stage stage     = (Stage)i;
+        const StageMemory mem = mem_stage_stats(stage);
+        usize used            = 0, reserved = 0;
+        for (uint k = 0; k < count; k++)
+        {
+            used += arenas[k].of(stage)->used();
+            reserved += arenas[k].of(stage)->reserved();
+        }
+        if (!mem.allocations && !mem.frees && !reserved) continue;
+        fprintf(output, "  %-9s %9llu %9llu %12.1f %12.1f %12.1f %12.1f %12.1f" NEWLINE,
+                stage_name(stage), mem.allocations, mem.frees, kib(mem.allocated),
+                kib(mem.freed), kib(mem.peak), kib(used), kib(reserved));
+    }
+    fprintf(output, "  live: %.1f KiB" NEWLINE, kib(mem_live()));
+}
+
+void
+log_stats(FILE *output, const file_t *code_file, Lexer *lexer, StageArenas *arenas)
+{
+    assert(code_file && lexer && arenas);
+    log_memory(output, arenas, 1);
+
+    // TOKEN DENSITY
+    const TokenStream *tokens = lexer->get_tokens();
+    if (!tokens) return;
+    const usize count = tokens->count();
+    const uint bytes  = code_file->length;
+    usize variable    = 0;
+    for (TknIdx i = 0; i < (TknIdx)count; i++)
+        variable += tkn_type_length(tokens->type(i)) == TKN_VARIABLE_LENGTH;
+
+    fprintf(output, "[%sSTATS%s] : tokens" NEWLINE, LGREEN, RESET);
+    fprintf(output, "  - tokens: %llu in %u bytes (%s%s), %u lines" NEWLINE, count, bytes,
+            code_file->mapped ? "mapped" : "read", lexer->from_cache() ? ", cached" : "",
+            lexer->get_num_of_lines());
+    fprintf(output, "  - density: %.2f tokens per KiB, %.2f bytes per token" NEWLINE,
+            bytes ? 1024.0 * (f64)count / (f64)bytes : 0.0,
+            count ? (f64)bytes / (f64)count : 0.0);
+    fprintf(output, "  - variable length: %llu (%.2f%%)" NEWLINE, variable,
+            count ? 100.0 * (f64)variable / (f64)count : 0.0);
+    fprintf(output, "  - sampled density: %.4f tokens per byte, initial capacity %llu (%.2f%% used)"
+                    NEWLINE,
+            lexer->get_density(), lexer->get_token_capacity(),
+            lexer->get_token_capacity() ? 100.0 * (f64)count / (f64)lexer->get_token_capacity()
+                                        : 0.0);
+    fprintf(output, "  - stream memory: %llu bytes (%.2f bytes per token)" NEWLINE,
+            tokens->memory(), count ? (f64)tokens->memory() / (f64)count : 0.0);
+}
+
+void
+log_modules(FILE *output, const ModuleGraph *modules)
+{
+    fprintf(output, "[%sSTATS%s] : %llu modules, %llu bytes, %llu tokens" NEWLINE, LGREEN, RESET,
+            modules->count(), modules->bytes(), modules->tokens());
+    for (usize i = 0; i < modules->order.count(); i++)
+    {
+        const Module *module = modules->module(modules->order[i]);
+        fprintf(output, "  %9u B %9llu tkn %3llu imports  %s" NEWLINE, module->file->length,
+                module->lexer->get_tokens()->count(), module->imports.count(), module->path);
+    }
+}
+
+// a counter per token, "n/a" when the machine does not count it
+static void
+per_token(FILE *output, const StageCounters *counters, const Counter counter, const usize tokens)
+{
+    if (!perf_available(counter) || !tokens) { fprintf(output, " %12s", "n/a"); }
+    else { fprintf(output, " %12.4f", (f64)counters->value[(u8)counter] / (f64)tokens); }
+}
+
+void
+log_times(FILE *output, const usize tokens)
+{
+    // wall time per stage, summed over every file and thread that ran it
+    fprintf(output, "[%sTIMER%s] : time per stage" NEWLINE, LGREEN, RESET);
+    fprintf(output, "  %-9s %8s %14s %14s" NEWLINE, "stage", "runs", "total ms", "mean us");
+    for (u8 i = 0; i < STAGE_COUNT; i++)
+    {
+        const Stage stage    = (Stage)i;
+        const StageTime time = stage_time(stage);
+        if (!time.runs) continue;
+        fprintf(output, "  %-9s %8u %14.3f %14.3f" NEWLINE, stage_name(stage), time.runs,
+                (f64)time.ns / 1e6, (f64)time.ns / 1e3 / (f64)time.runs);
+    }
+    if (!perf_counting()) return;
+
+    // hardware counters, the misses are per token of every file
+    fprintf(output, "[%sTIMER%s] : counters per stage, %llu tokens" NEWLINE, LGREEN, RESET,
+            tokens);
+    fprintf(output, "  %-9s %14s %8s %12s %12s %12s" NEWLINE, "stage", "Mcycles", "IPC",
+            "br-miss/tkn", "L1D-miss/tkn", "LLC-miss/tkn");
+    for (u8 i = 0; i < STAGE_COUNT; i++)
+    {
+        const Stage stage            = (Stage)i;
+        const StageCounters counters = stage_counters(stage);
+        const u64 cycles             = counters.value[(u8)Counter::cycles];
+        const u64 instructions       = counters.value[(u8)Counter::instructions];
+        if (!stage_time(stage).runs) continue;
+        fprintf(output, "  %-9s", stage_name(stage));
+        if (perf_available(Counter::cycles)) { fprintf(output, " %14.3f", (f64)cycles / 1e6); }
+        else { fprintf(output, " %14s", "n/a"); }
+        if (perf_available(Counter::cycles) && perf_available(Counter::instructions) && cycles)
+        {
+            fprintf(output, " %8.3f", (f64)instructions / (f64)cycles);
+        }
+        else { fprintf(output, " %8s", "n/a"); }
+        per_token(output, &counters, Counter::branch_misses, tokens);
+        per_token(output, &counters, Counter::l1d_misses, tokens);
+        per_token(output, &counters, Counter::llc_misses, tokens);
+        fprintf(output, NEWLINE);
+    }
 }
 
 } // namespace rotate
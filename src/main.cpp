@@ -1,22 +1,8 @@
 #include "include/common.hpp"
 #include "include/compile.hpp"
 #include "include/defines.hpp"
-
-rotate::cstr
-main_err(rotate::Stage s)
-{
-    using namespace rotate;
-    switch (s)
-    {
-        case Stage::file: return "FILE READ";
-        case Stage::lexer: return "LEXER";
-        case Stage::parser: return "PARSER";
-        case Stage::tchecker: return "TYPE CHECKER";
-        case Stage::logger: return "LOGGER";
-        default: return "UNKNOWN";
-    }
-    return "UNKNOWN";
-}
+#include "include/log.hpp"
+#include "include/timer.hpp"
 
 int
 main(const int argc, char **const argv)
@@ -27,23 +13,32 @@ main(const int argc, char **const argv)
     {
         // parse program arguments
         auto comp_opt = compile_options(argc, argv);
+        if (!comp_opt.filename && !comp_opt.batch_list) print_version_and_exit();
 
-        // setup timer stuff
-        clock_t start_t, end_t;
-        f128 total_t;
-        start_t = clock();
+        // wall time, the cpu time of clock() adds up every thread
+        if (comp_opt.trace_path) trace_start();
+        if (comp_opt.perf_counters) perf_start();
+        const u64 start_t = time_ns();
 
-        // compile
-        u8 _exit = compile(&comp_opt);
-        if (_exit == FAILURE)
-            log_stage(main_err(comp_opt.st));
-        else if (_exit == SUCCESS)
-            log_info("SUCCESS");
+        // compile, a batch reports every file itself and its status is the exit code
+        u8 _exit = SUCCESS;
+        if (comp_opt.batch()) { _exit = compile_batch(&comp_opt); }
+        else
+        {
+            const u8 status = compile(&comp_opt);
+            if (status == FAILURE)
+                log_stage(stage_describe(comp_opt.st));
+            else if (status == SUCCESS)
+                log_info("SUCCESS");
+        }
 
         // print comptime
-        end_t   = clock();
-        total_t = (double)(end_t - start_t) / CLOCKS_PER_SEC;
-        printf("[%sTIME%s] : %.5Lf sec\n", LMAGENTA, RESET, total_t);
+        const f64 total_t = (f64)(time_ns() - start_t) / 1e9;
+        if (comp_opt.trace_path && trace_write(comp_opt.trace_path) != SUCCESS)
+            log_error("Trace failed");
+        if (comp_opt.timer) log_times(stdout, comp_opt.token_count);
+        printf("[%sTIME%s] : %.5f sec\n", LMAGENTA, RESET, total_t);
+        return _exit;
     }
     else { print_version_and_exit(); }
     return SUCCESS;
@@ -0,0 +1,265 @@
+#include "include/modules.hpp"
+#include "include/file.hpp"
+#include "include/mem_stats.hpp"
+#include "include/timer.hpp"
+
+#include <limits.h>
+#include <stdlib.h>
+
+namespace rotate
+{
+
+Module::~Module()
+{
+    if (!owned) return;
+    delete lexer;
+    delete file;
+}
+
+ModuleGraph::ModuleGraph(const compile_options *options)
+    : options(options), search(4), modules(16), pending(4), order(16)
+{
+    pthread_mutex_init(&lock, nullptr);
+
+    // the main source's directory, then the --module-path entries
+    cstr main  = options->filename;
+    cstr slash = strrchr(main, '/');
+    search.append(slash ? strndup(main, (usize)(slash - main)) : strndup(".", 1));
+    for (cstr dirs = options->module_path; dirs && *dirs;)
+    {
+        cstr end = strchr(dirs, ':');
+        if (!end) end = dirs + strlen(dirs);
+        if (end > dirs) search.append(strndup(dirs, (usize)(end - dirs)));
+        dirs = *end ? end + 1 : end;
+    }
+}
+
+ModuleGraph::~ModuleGraph()
+{
+    for (usize i = 0; i < modules.count(); i++)
+        delete modules[i];
+    for (usize i = 0; i < search.count(); i++)
+    {
+        mem_track_free(strlen(search[i]) + 1);
+        delete[] search[i];
+    }
+    pthread_mutex_destroy(&lock);
+}
+
+// the id of the module at `real_path`, `*added` is the new module when it was never seen
+u32
+ModuleGraph::add(cstr real_path, Module **added)
+{
+    const uint length = (uint)strlen(real_path);
+    pthread_mutex_lock(&lock);
+    u32 id = paths.find(real_path, length);
+    if (id == SYMBOL_NONE)
+    {
+        // the name is kept by the table's arena, it never moves
+        id     = paths.intern(real_path, length);
+        *added = new Module(this, paths.name(id));
+        modules.append(*added);
+    }
+    pthread_mutex_unlock(&lock);
+    return id;
+}
+
+// a module's source gets its range of locations once it was read
+u8
+ModuleGraph::add_source(Module *module)
+{
+    module->source = sources.add(module->file);
+    if (module->source != SOURCE_NONE) return SUCCESS;
+    log_error("the sources exceed the 4 GiB of source locations");
+    return FAILURE;
+}
+
+SrcLoc
+ModuleGraph::location(const Module *module, const TknIdx i) const
+{
+    return sources.location(module->source, module->lexer->get_tokens()->offset(i));
+}
+
+void
+ModuleGraph::describe(char *out, const usize size, const Module *module, const TknIdx i)
+{
+    const SourceSpot spot = sources.spot(location(module, i));
+    snprintf(out, size, "%s:%u:%u", module->path, spot.line, spot.column);
+}
+
+u32
+ModuleGraph::resolve(const Module *from, const TknIdx path)
+{
+    const StringView import = from->lexer->get_tokens()->string(path);
+    char candidate[MODULE_PATH], real[PATH_MAX];
+    for (usize d = 0; d < search.count(); d++)
+    {
+        const int n = snprintf(candidate, sizeof(candidate), "%s/%.*s.vr", search[d],
+                               (int)import.length, import.data);
+        if (n < 0 || (usize)n >= sizeof(candidate) || !realpath(candidate, real)) continue;
+
+        Module *added = nullptr;
+        const u32 id  = add(real, &added);
+        if (!added) return id;
+        // queued once the lock is released; a pool of one thread would run it right
+        // here, one stack frame per import level, so `load_imports` drains it instead
+        if (pool && pool->size() > 1) { pool->submit(load, added); }
+        else { pending.append(added); }
+        return id;
+    }
+
+    char at[MODULE_PATH], message[MODULE_PATH + 64];
+    describe(at, sizeof(at), from, path);
+    snprintf(message, sizeof(message), "module `%.*s` imported at `%s` was not found",
+             (int)import.length, import.data, at);
+    log_warn(message);
+    return MODULE_NONE;
+}
+
+void
+ModuleGraph::scan(Module *module)
+{
+    const TokenStream *tokens = module->lexer->get_tokens();
+    const TknIdx count        = (TknIdx)tokens->count();
+    for (TknIdx i = 0; i + 1 < count; i++)
+    {
+        if (tokens->type(i) != TknType::Import || tokens->type(i + 1) != TknType::String) continue;
+        ModuleImport import = {MODULE_NONE, i + 1, NO_ALIAS};
+        if (i + 3 < count && tokens->type(i + 2) == TknType::As &&
+            tokens->type(i + 3) == TknType::Identifier)
+            import.alias = i + 3;
+        import.module = resolve(module, i + 1);
+        module->imports.append(import);
+    }
+}
+
+void
+ModuleGraph::load(void *ptr)
+{
+    Module *module = static_cast<Module *>(ptr);
+    TimeScope scope("load module", "modules", module->path);
+
+    mem_set_stage(Stage::file);
+    const compile_options *options = module->graph->options;
+    module->file  = new file_t(file_read(module->path, options->map_file, options->ascii_only));
+    if (module->file->valid_code != valid::success) return;
+    if (module->graph->add_source(module) != SUCCESS) return;
+
+    mem_set_stage(Stage::lexer);
+    module->lexer  = new Lexer(module->file);
+    module->status = lex_file(options, module->file, module->lexer);
+    if (module->status == SUCCESS) module->graph->scan(module);
+}
+
+// depth first, a module is listed once all its imports are
+u8
+ModuleGraph::sort()
+{
+    struct Frame
+    {
+        u32 module, next;
+    };
+    Array<u8> state(modules.count()); // 0: not seen, 1: on the stack, 2: listed
+    Array<Frame> stack(16);
+    state.resize(modules.count());
+    memset(state.data(), 0, modules.count());
+    order.resize(0);
+
+    stack.append(Frame{0, 0});
+    state[0] = 1;
+    while (!stack.is_empty())
+    {
+        Frame &top           = stack.last();
+        const Module *module = modules[top.module];
+        if (top.next == module->imports.count())
+        {
+            state[top.module] = 2;
+            order.append(top.module);
+            stack.pop();
+            continue;
+        }
+        const u32 next = module->imports[top.next++].module;
+        if (next == MODULE_NONE || state[next] == 2) continue;
+        if (state[next] == 0)
+        {
+            state[next] = 1;
+            stack.append(Frame{next, 0});
+            continue;
+        }
+
+        // `next` is on the stack, the cycle is the stack from there,
+        // every step is named by the import that takes it
+        char at[MODULE_PATH];
+        flockfile(stderr);
+        fprintf(stderr, "[%sERROR%s]: import cycle:", LRED, RESET);
+        usize from = 0;
+        while (stack[from].module != next)
+            from++;
+        for (usize i = from; i < stack.count(); i++)
+        {
+            const Module *step = modules[stack[i].module];
+            describe(at, sizeof(at), step, step->imports[stack[i].next - 1].path);
+            fprintf(stderr, " %s ->", at);
+        }
+        fprintf(stderr, " %s\n", modules[next]->path);
+        funlockfile(stderr);
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+u8
+ModuleGraph::load_imports(file_t *main_file, Lexer *main_lexer, const uint workers)
+{
+    char real[PATH_MAX];
+    Module *main = nullptr;
+    add(realpath(main_file->name, real) ? real : main_file->name, &main);
+    main->file   = main_file;
+    main->lexer  = main_lexer;
+    main->owned  = false;
+    main->status = SUCCESS;
+    if (add_source(main) != SUCCESS) return FAILURE;
+
+    // the threads are only started when the main source imports a module that exists
+    scan(main);
+    if (!pending.is_empty())
+    {
+        const Stage stage = mem_stage();
+        ThreadPool threads(workers);
+        pool = &threads;
+        // on one thread the modules the loads discover are appended to `pending`
+        for (usize i = 0; i < pending.count(); i++)
+        {
+            if (threads.size() > 1) { threads.submit(load, pending[i]); }
+            else { load(pending[i]); }
+        }
+        threads.wait();
+        pool = nullptr;
+        mem_set_stage(stage);
+    }
+
+    u8 status = SUCCESS;
+    for (usize i = 0; i < modules.count(); i++)
+        if (modules[i]->status != SUCCESS) status = FAILURE;
+    return status == SUCCESS ? sort() : FAILURE;
+}
+
+usize
+ModuleGraph::tokens() const
+{
+    usize total = 0;
+    for (usize i = 0; i < modules.count(); i++)
+        if (modules[i]->lexer) total += modules[i]->lexer->get_tokens()->count();
+    return total;
+}
+
+usize
+ModuleGraph::bytes() const
+{
+    usize total = 0;
+    for (usize i = 0; i < modules.count(); i++)
+        if (modules[i]->file) total += modules[i]->file->length;
+    return total;
+}
+
+} // namespace rotate
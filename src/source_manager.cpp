@@ -0,0 +1,117 @@
+#include "include/source_manager.hpp"
+
+namespace rotate
+{
+
+SourceManager::SourceManager() : ranges(16)
+{
+    pthread_mutex_init(&lock, nullptr);
+}
+
+SourceManager::~SourceManager()
+{
+    for (usize i = 0; i < ranges.count(); i++)
+        delete ranges[i].lines;
+    pthread_mutex_destroy(&lock);
+}
+
+SourceId
+SourceManager::add(const file_t *file)
+{
+    pthread_mutex_lock(&lock);
+    // the range ends one past the source, SRC_LOC_NONE is never inside one
+    SourceId id = SOURCE_NONE;
+    if ((u64)next + file->length + 1 < SRC_LOC_NONE)
+    {
+        id = (SourceId)ranges.count();
+        ranges.append(Range{next, file->length, file, nullptr});
+        next += file->length + 1;
+    }
+    pthread_mutex_unlock(&lock);
+    return id;
+}
+
+// the last range starting at or before `loc`, with the lock held
+SourceId
+SourceManager::find(const SrcLoc loc) const
+{
+    usize lo = 0, hi = ranges.count();
+    while (lo < hi)
+    {
+        const usize mid = (lo + hi) / 2;
+        if (ranges[mid].base <= loc)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0 || loc - ranges[lo - 1].base > ranges[lo - 1].length) return SOURCE_NONE;
+    return (SourceId)(lo - 1);
+}
+
+SrcLoc
+SourceManager::location(const SourceId source, const uint offset) const
+{
+    pthread_mutex_lock(&lock);
+    const SrcLoc loc = offset <= ranges[source].length ? ranges[source].base + offset : SRC_LOC_NONE;
+    pthread_mutex_unlock(&lock);
+    return loc;
+}
+
+SourceId
+SourceManager::source_of(const SrcLoc loc) const
+{
+    pthread_mutex_lock(&lock);
+    const SourceId source = find(loc);
+    pthread_mutex_unlock(&lock);
+    return source;
+}
+
+SourceSpot
+SourceManager::spot(const SrcLoc loc)
+{
+    SourceSpot spot = {nullptr, SOURCE_NONE, 0, 0, 0, 0, 0};
+    pthread_mutex_lock(&lock);
+    spot.source = find(loc);
+    if (spot.source != SOURCE_NONE)
+    {
+        Range *range = &ranges[spot.source];
+        if (!range->lines) range->lines = new LineIndex(range->file->contents, range->length);
+        spot.file       = range->file;
+        spot.offset     = loc - range->base;
+        spot.line       = range->lines->line_of(spot.offset);
+        spot.line_start = range->lines->line_start(spot.line);
+        spot.line_end   = range->lines->line_end(spot.line);
+        spot.column     = spot.offset - spot.line_start + 1;
+    }
+    pthread_mutex_unlock(&lock);
+    return spot;
+}
+
+usize
+SourceManager::count() const
+{
+    pthread_mutex_lock(&lock);
+    const usize n = ranges.count();
+    pthread_mutex_unlock(&lock);
+    return n;
+}
+
+const file_t *
+SourceManager::file(const SourceId source) const
+{
+    pthread_mutex_lock(&lock);
+    const file_t *file = ranges[source].file;
+    pthread_mutex_unlock(&lock);
+    return file;
+}
+
+SrcLoc
+SourceManager::base(const SourceId source) const
+{
+    pthread_mutex_lock(&lock);
+    const SrcLoc base = ranges[source].base;
+    pthread_mutex_unlock(&lock);
+    return base;
+}
+
+} // namespace rotate
@@ -0,0 +1,260 @@
+#include "../include/arena.hpp"
+#include "../include/mem_stats.hpp"
+
+namespace rotate
+{
+
+Arena::Arena(const usize chunk_size) : chunk_size(chunk_size < 1024 ? 1024 : chunk_size) {}
+
+// chunks are charged to the running Stage like any container storage
+static void
+free_chunk(void *chunk, const usize bytes)
+{
+    mem_track_free(bytes);
+    free(chunk);
+}
+
+Arena::~Arena()
+{
+    while (current)
+    {
+        Chunk *prev = current->prev;
+        free_chunk(current, sizeof(Chunk) + current->size);
+        current = prev;
+    }
+    while (large)
+    {
+        Chunk *next = large->next;
+        free_chunk(large, sizeof(Chunk) + large->size);
+        large = next;
+    }
+    while (spare)
+    {
+        Chunk *prev = spare->prev;
+        free_chunk(spare, sizeof(Chunk) + spare->size);
+        spare = prev;
+    }
+    while (spare_large)
+    {
+        Chunk *next = spare_large->next;
+        free_chunk(spare_large, sizeof(Chunk) + spare_large->size);
+        spare_large = next;
+    }
+}
+
+Arena::Chunk *
+Arena::take_spare(Chunk **list, Chunk *Chunk::*link, const usize size)
+{
+    for (Chunk **it = list; *it; it = &((*it)->*link))
+    {
+        if ((*it)->size < size) continue;
+        Chunk *chunk = *it;
+        *it          = chunk->*link;
+        return chunk;
+    }
+    return nullptr;
+}
+
+void *
+Arena::alloc_slow(const usize size, const usize align)
+{
+    if (size > chunk_size / 4)
+    {
+        ASSERT(align <= ARENA_ALIGN, "Arena large allocations are only aligned to ARENA_ALIGN");
+        return alloc_large(size);
+    }
+
+    // leave the current chunk for a new one
+    if (current) current->used = (usize)(at - data(current));
+    Chunk *chunk = take_spare(&spare, &Chunk::prev, size + align);
+    if (!chunk)
+    {
+        const usize bytes = size + align > chunk_size ? size + align : chunk_size;
+        chunk             = static_cast<Chunk *>(malloc(sizeof(Chunk) + bytes));
+        ASSERT_NULL(chunk, "Arena chunk allocation failure");
+        chunk->size = bytes;
+        mem_track_alloc(sizeof(Chunk) + bytes);
+        reserved_bytes += sizeof(Chunk) + bytes;
+        if (reserved_bytes > peak_bytes) peak_bytes = reserved_bytes;
+    }
+    chunk->prev   = current;
+    chunk->next   = nullptr;
+    chunk->serial = ++serial;
+    chunk->used   = 0;
+    current       = chunk;
+    at            = data(chunk);
+    end           = at + chunk->size;
+    floor         = at;
+    return alloc(size, align);
+}
+
+void *
+Arena::alloc_large(const usize size)
+{
+    Chunk *chunk = take_spare(&spare_large, &Chunk::next, size);
+    if (!chunk)
+    {
+        chunk = static_cast<Chunk *>(malloc(sizeof(Chunk) + size));
+        ASSERT_NULL(chunk, "Arena chunk allocation failure");
+        chunk->size = size;
+        mem_track_alloc(sizeof(Chunk) + size);
+        reserved_bytes += sizeof(Chunk) + size;
+        if (reserved_bytes > peak_bytes) peak_bytes = reserved_bytes;
+    }
+    chunk->prev   = nullptr;
+    chunk->next   = large;
+    chunk->serial = ++serial;
+    chunk->used   = size;
+    if (large) large->prev = chunk;
+    large = chunk;
+    return data(chunk);
+}
+
+Arena::Chunk *
+Arena::find_large(const void *ptr) const
+{
+    for (Chunk *chunk = large; chunk; chunk = chunk->next)
+        if (data(chunk) == ptr) return chunk;
+    return nullptr;
+}
+
+void *
+Arena::grow(void *ptr, const usize old_size, const usize new_size, const usize align)
+{
+    if (!ptr) return alloc(new_size, align);
+    if (new_size <= old_size) return ptr;
+
+    // the last allocation of the current chunk is extended
+    char *const p = static_cast<char *>(ptr);
+    if (p >= floor && p + old_size == at && p + new_size <= end)
+    {
+        at = p + new_size;
+        return ptr;
+    }
+
+    // dedicated chunks are reallocated, the allocator may move them without a copy
+    if (Chunk *chunk = find_large(ptr))
+    {
+        // a recycled chunk may already be large enough
+        if (new_size <= chunk->size)
+        {
+            chunk->used = new_size;
+            return ptr;
+        }
+        Chunk *moved = static_cast<Chunk *>(realloc(chunk, sizeof(Chunk) + new_size));
+        ASSERT_NULL(moved, "Arena chunk allocation failure");
+        if (moved->prev) { moved->prev->next = moved; }
+        else { large = moved; }
+        if (moved->next) moved->next->prev = moved;
+        mem_track_resize(moved->size, new_size);
+        reserved_bytes += new_size - moved->size;
+        if (reserved_bytes > peak_bytes) peak_bytes = reserved_bytes;
+        moved->size = new_size;
+        moved->used = new_size;
+        return data(moved);
+    }
+
+    // NOTE: the old bytes stay in the arena until it is rolled back or freed
+    void *copy = alloc(new_size, align);
+    memcpy(copy, ptr, old_size);
+    return copy;
+}
+
+char *
+Arena::strndup(cstr src, const usize length)
+{
+    char *res = static_cast<char *>(alloc(length + 1, 1));
+    memcpy(res, src, length);
+    res[length] = '\0';
+    return res;
+}
+
+void
+Arena::release(Chunk *chunk)
+{
+    // one chunk is kept so a scope crossing a chunk boundary does not malloc every time
+    if (!spare && chunk->size == chunk_size)
+    {
+        chunk->prev = nullptr;
+        spare       = chunk;
+        return;
+    }
+    reserved_bytes -= sizeof(Chunk) + chunk->size;
+    free_chunk(chunk, sizeof(Chunk) + chunk->size);
+}
+
+ArenaMark
+Arena::mark()
+{
+    const ArenaMark saved = {current, at, floor, serial};
+    // allocations made before the mark must not grow over the rolled back bytes
+    floor = at;
+    return saved;
+}
+
+void
+Arena::rollback(const ArenaMark saved)
+{
+    while (current && current != saved.chunk)
+    {
+        Chunk *prev = current->prev;
+        release(current);
+        current = prev;
+    }
+    while (large && large->serial > saved.serial)
+    {
+        Chunk *next = large->next;
+        reserved_bytes -= sizeof(Chunk) + large->size;
+        free_chunk(large, sizeof(Chunk) + large->size);
+        large = next;
+    }
+    if (large) large->prev = nullptr;
+
+    if (current)
+    {
+        at  = saved.at;
+        end = data(current) + current->size;
+    }
+    else { at = end = nullptr; }
+    floor = saved.floor;
+}
+
+void
+Arena::reset()
+{
+    rollback(ArenaMark{nullptr, nullptr, nullptr, 0});
+}
+
+usize
+Arena::used() const
+{
+    usize bytes = current ? (usize)(at - data(current)) : 0;
+    for (const Chunk *chunk = current ? current->prev : nullptr; chunk; chunk = chunk->prev)
+        bytes += chunk->used;
+    for (const Chunk *chunk = large; chunk; chunk = chunk->next)
+        bytes += chunk->used;
+    return bytes;
+}
+
+void
+Arena::recycle()
+{
+    if (current) current->used = 0;
+    while (current)
+    {
+        Chunk *prev   = current->prev;
+        current->prev = spare;
+        spare         = current;
+        current       = prev;
+    }
+    while (large)
+    {
+        Chunk *next = large->next;
+        large->next = spare_large;
+        spare_large = large;
+        large       = next;
+    }
+    at = end = floor = nullptr;
+}
+
+} // namespace rotate
@@ -1,6 +1,6 @@
 #include "../include/common.hpp"
 
-#include "../fe/token.hpp"
+#include "../fe/token_stream.hpp"
 //* USEFUL COMMON UTILS FOR ROTATE-LANG
 
 namespace rotate
@@ -9,15 +9,40 @@ namespace rotate
 char *
 strndup(cstr src, const usize length)
 {
-    char *res = new char[length];
+    char *res = new char[length + 1];
     ASSERT_NULL(res, "failed mem allocation");
+    mem_track_alloc(length + 1);
     for (usize i = 0; i < length; ++i)
     {
         res[i] = src[i];
     }
+    res[length] = '\0';
     return res;
 }
 
+u64
+time_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+cstr
+stage_describe(const Stage stage)
+{
+    switch (stage)
+    {
+        case Stage::file: return "FILE READ";
+        case Stage::lexer: return "LEXER";
+        case Stage::parser: return "PARSER";
+        case Stage::tchecker: return "TYPE CHECKER";
+        case Stage::logger: return "LOGGER";
+        default: return "UNKNOWN";
+    }
+    return "UNKNOWN";
+}
+
 void
 log_stage(cstr str)
 {
@@ -61,10 +86,11 @@ log_info(cstr str)
 
 // NOTE: func definition in ./frontend/include/lexer.hpp
 void
-log_token(FILE *output, const Token tkn, cstr str)
+log_token(FILE *output, const TokenStream *tokens, const TknIdx i)
 {
-    fprintf(output, "[TOKEN]: idx: %u, len: %u, type: %s, val: `%.*s`\n", tkn.index, tkn.length,
-            tkn_type_describe(tkn.type), tkn.length, str + tkn.index);
+    const uint length = tokens->length(i);
+    fprintf(output, "[TOKEN]: idx: %u, len: %u, type: %s, val: `%.*s`\n", tokens->offset(i), length,
+            tkn_type_describe(tokens->type(i)), length, tokens->source() + tokens->offset(i));
 }
 
 uint
@@ -0,0 +1,95 @@
+#include "../include/digest.hpp"
+
+namespace rotate
+{
+
+static const u64 BLAKE2B_IV[8] = {
+    0x6a09e667f3bcc908ull, 0xbb67ae8584caa73bull, 0x3c6ef372fe94f82bull, 0xa54ff53a5f1d36f1ull,
+    0x510e527fade682d1ull, 0x9b05688c2b3e6c1full, 0x1f83d9abfb41bd6bull, 0x5be0cd19137e2179ull,
+};
+
+// message word order of every round, rounds 10 and 11 repeat rounds 0 and 1
+static const u8 BLAKE2B_SIGMA[12][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+};
+
+static inline u64
+rotr64(const u64 x, const uint n) noexcept
+{
+    return (x >> n) | (x << (64 - n));
+}
+
+#define BLAKE2B_G(a, b, c, d, x, y)                                                                \
+    do {                                                                                           \
+        v[a] = v[a] + v[b] + (x);                                                                  \
+        v[d] = rotr64(v[d] ^ v[a], 32);                                                            \
+        v[c] = v[c] + v[d];                                                                        \
+        v[b] = rotr64(v[b] ^ v[c], 24);                                                            \
+        v[a] = v[a] + v[b] + (y);                                                                  \
+        v[d] = rotr64(v[d] ^ v[a], 16);                                                            \
+        v[c] = v[c] + v[d];                                                                        \
+        v[b] = rotr64(v[b] ^ v[c], 63);                                                            \
+    } while (0)
+
+// `bytes` counts the input up to the end of this block
+static void
+compress(u64 h[8], const u8 block[128], const u64 bytes, const bool last) noexcept
+{
+    u64 m[16], v[16];
+    memcpy(m, block, sizeof(m));
+    for (uint i = 0; i < 8; i++)
+    {
+        v[i]     = h[i];
+        v[i + 8] = BLAKE2B_IV[i];
+    }
+    v[12] ^= bytes; // the counter is 128 bits, sources never need the high word
+    if (last) v[14] = ~v[14];
+
+    for (uint r = 0; r < 12; r++)
+    {
+        const u8 *s = BLAKE2B_SIGMA[r];
+        BLAKE2B_G(0, 4, 8, 12, m[s[0]], m[s[1]]);
+        BLAKE2B_G(1, 5, 9, 13, m[s[2]], m[s[3]]);
+        BLAKE2B_G(2, 6, 10, 14, m[s[4]], m[s[5]]);
+        BLAKE2B_G(3, 7, 11, 15, m[s[6]], m[s[7]]);
+        BLAKE2B_G(0, 5, 10, 15, m[s[8]], m[s[9]]);
+        BLAKE2B_G(1, 6, 11, 12, m[s[10]], m[s[11]]);
+        BLAKE2B_G(2, 7, 8, 13, m[s[12]], m[s[13]]);
+        BLAKE2B_G(3, 4, 9, 14, m[s[14]], m[s[15]]);
+    }
+    for (uint i = 0; i < 8; i++)
+        h[i] ^= v[i] ^ v[i + 8];
+}
+
+#undef BLAKE2B_G
+
+void
+digest(cstr data, const usize length, u8 out[DIGEST_BYTES]) noexcept
+{
+    u64 h[8];
+    memcpy(h, BLAKE2B_IV, sizeof(h));
+    h[0] ^= 0x01010000ull ^ DIGEST_BYTES; // fanout and depth 1, no key
+
+    // every full block but the last one, the last block (even empty) is padded
+    const u8 *in = reinterpret_cast<const u8 *>(data);
+    usize done   = 0;
+    for (; length - done > 128; done += 128)
+        compress(h, in + done, done + 128, false);
+    u8 block[128] = {0};
+    memcpy(block, in + done, length - done);
+    compress(h, block, length, true);
+    memcpy(out, h, DIGEST_BYTES);
+}
+
+} // namespace rotate
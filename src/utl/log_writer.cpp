@@ -0,0 +1,191 @@
+#include "../include/log_writer.hpp"
+#include "../include/mem_stats.hpp"
+
+#include <stdarg.h>
+
+namespace rotate
+{
+
+cstr
+log_format_extension(const LogFormat format)
+{
+    switch (format)
+    {
+        case LogFormat::org: return "org";
+        case LogFormat::json: return "jsonl";
+        case LogFormat::binary: return "bin";
+    }
+    return "log";
+}
+
+LogWriter::LogWriter(FILE *output)
+    : output(output), buffer(static_cast<char *>(malloc(LOG_BUFFER_SIZE)))
+{
+    ASSERT_NULL(buffer, "Log buffer allocation failure");
+    mem_track_alloc(LOG_BUFFER_SIZE);
+}
+
+LogWriter::~LogWriter()
+{
+    flush();
+    mem_track_free(LOG_BUFFER_SIZE);
+    free(buffer);
+}
+
+void
+LogWriter::drain()
+{
+    if (used && fwrite(buffer, 1, used, output) != used) failed = true;
+    used = 0;
+}
+
+u8
+LogWriter::flush()
+{
+    drain();
+    if (fflush(output) != 0) failed = true;
+    return failed ? FAILURE : SUCCESS;
+}
+
+// larger than what is left, the buffered part goes first
+void
+LogWriter::put_slow(cstr str, const usize length)
+{
+    drain();
+    if (length >= LOG_BUFFER_SIZE / 2)
+    {
+        if (fwrite(str, 1, length, output) != length) failed = true;
+        return;
+    }
+    memcpy(buffer, str, length);
+    used = length;
+}
+
+void
+LogWriter::put_uint(u64 value)
+{
+    static const char DIGIT_PAIRS[] = "00010203040506070809"
+                                      "10111213141516171819"
+                                      "20212223242526272829"
+                                      "30313233343536373839"
+                                      "40414243444546474849"
+                                      "50515253545556575859"
+                                      "60616263646566676869"
+                                      "70717273747576777879"
+                                      "80818283848586878889"
+                                      "90919293949596979899";
+    // written backwards from the end of a 20 digit field
+    char digits[20];
+    char *at = digits + sizeof(digits);
+    while (value > UINT32_MAX)
+    {
+        const uint pair = (uint)(value % 100) * 2;
+        value /= 100;
+        at -= 2;
+        at[0] = DIGIT_PAIRS[pair];
+        at[1] = DIGIT_PAIRS[pair + 1];
+    }
+    // the rest in 32 bits, cheaper to divide
+    u32 small = (u32)value;
+    while (small >= 100)
+    {
+        const u32 pair = (small % 100) * 2;
+        small /= 100;
+        at -= 2;
+        at[0] = DIGIT_PAIRS[pair];
+        at[1] = DIGIT_PAIRS[pair + 1];
+    }
+    if (small >= 10)
+    {
+        at -= 2;
+        at[0] = DIGIT_PAIRS[small * 2];
+        at[1] = DIGIT_PAIRS[small * 2 + 1];
+    }
+    else { *--at = (char)('0' + small); }
+
+    const usize length = (usize)(digits + sizeof(digits) - at);
+    memcpy(reserve(length), at, length);
+    used += length;
+}
+
+void
+LogWriter::put_float(const f64 value)
+{
+    char *at = reserve(32);
+    used += (usize)snprintf(at, 32, "%.17g", value);
+}
+
+void
+LogWriter::put_json(cstr str, const usize length)
+{
+    static const char HEX[] = "0123456789abcdef";
+    cstr end                = str + length;
+    while (str < end)
+    {
+        // the plain run up to the next character to escape
+        cstr run = str;
+        while (run < end && (u8)*run >= 0x20 && *run != '"' && *run != '\\')
+            run++;
+        put(str, (usize)(run - str));
+        if (run == end) break;
+
+        const u8 c   = (u8)*run;
+        char escaped = 0;
+        switch (c)
+        {
+            case '"':
+            case '\\': escaped = (char)c; break;
+            case '\n': escaped = 'n'; break;
+            case '\t': escaped = 't'; break;
+            case '\r': escaped = 'r'; break;
+            default: break;
+        }
+        char *at = reserve(6);
+        at[0]    = '\\';
+        if (escaped)
+        {
+            at[1] = escaped;
+            used += 2;
+        }
+        else
+        {
+            memcpy(at + 1, "u00", 3);
+            at[4] = HEX[c >> 4];
+            at[5] = HEX[c & 15];
+            used += 6;
+        }
+        str = run + 1;
+    }
+}
+
+void
+LogWriter::put_format(cstr format, ...)
+{
+    constexpr usize LINE = 1024;
+    char *at             = reserve(LINE);
+    va_list args;
+    va_start(args, format);
+    const int length = vsnprintf(at, LINE, format, args);
+    va_end(args);
+    if (length > 0) used += (usize)length < LINE ? (usize)length : LINE - 1;
+}
+
+void
+LogWriter::put_u32(const u32 value)
+{
+    char *at = reserve(4);
+    for (uint i = 0; i < 4; i++)
+        at[i] = (char)(value >> (8 * i));
+    used += 4;
+}
+
+void
+LogWriter::put_u64(const u64 value)
+{
+    char *at = reserve(8);
+    for (uint i = 0; i < 8; i++)
+        at[i] = (char)(value >> (8 * i));
+    used += 8;
+}
+
+} // namespace rotate
@@ -0,0 +1,95 @@
+#include "../include/mem_stats.hpp"
+#include "../include/common.hpp"
+
+namespace rotate
+{
+
+static StageMemory stage_memory[STAGE_COUNT];
+static thread_local u8 current_stage = (u8)Stage::unknown;
+// signed, untracked buffers may be freed through tracked paths
+static s64 live_bytes = 0;
+
+static inline StageMemory *
+running()
+{
+    return &stage_memory[current_stage];
+}
+
+static void
+raise_peak(StageMemory *stage, const s64 live)
+{
+    if (live <= 0) return;
+    usize peak = __atomic_load_n(&stage->peak, __ATOMIC_RELAXED);
+    while ((usize)live > peak &&
+           !__atomic_compare_exchange_n(&stage->peak, &peak, (usize)live, true, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED))
+    {
+    }
+}
+
+void
+mem_set_stage(const Stage stage)
+{
+    current_stage = (u8)stage;
+    // what earlier stages left allocated counts towards this one's peak
+    raise_peak(running(), __atomic_load_n(&live_bytes, __ATOMIC_RELAXED));
+}
+
+Stage
+mem_stage()
+{
+    return (Stage)current_stage;
+}
+
+void
+mem_track_alloc(const usize bytes)
+{
+    StageMemory *stage = running();
+    __atomic_fetch_add(&stage->allocations, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stage->allocated, bytes, __ATOMIC_RELAXED);
+    raise_peak(stage, __atomic_add_fetch(&live_bytes, (s64)bytes, __ATOMIC_RELAXED));
+}
+
+void
+mem_track_resize(const usize old_bytes, const usize new_bytes)
+{
+    if (new_bytes < old_bytes)
+    {
+        StageMemory *stage = running();
+        __atomic_fetch_add(&stage->freed, old_bytes - new_bytes, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&live_bytes, (s64)(old_bytes - new_bytes), __ATOMIC_RELAXED);
+        return;
+    }
+    mem_track_alloc(new_bytes - old_bytes);
+}
+
+void
+mem_track_free(const usize bytes)
+{
+    StageMemory *stage = running();
+    __atomic_fetch_add(&stage->frees, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stage->freed, bytes, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&live_bytes, (s64)bytes, __ATOMIC_RELAXED);
+}
+
+StageMemory
+mem_stage_stats(const Stage stage)
+{
+    StageMemory *counters = &stage_memory[(u8)stage];
+    StageMemory copy;
+    copy.allocations = __atomic_load_n(&counters->allocations, __ATOMIC_RELAXED);
+    copy.frees       = __atomic_load_n(&counters->frees, __ATOMIC_RELAXED);
+    copy.allocated   = __atomic_load_n(&counters->allocated, __ATOMIC_RELAXED);
+    copy.freed       = __atomic_load_n(&counters->freed, __ATOMIC_RELAXED);
+    copy.peak        = __atomic_load_n(&counters->peak, __ATOMIC_RELAXED);
+    return copy;
+}
+
+usize
+mem_live()
+{
+    const s64 live = __atomic_load_n(&live_bytes, __ATOMIC_RELAXED);
+    return live > 0 ? (usize)live : 0;
+}
+
+} // namespace rotate
@@ -0,0 +1,176 @@
+#include "../include/perf.hpp"
+#include "../include/common.hpp"
+
+#ifdef __linux__
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace rotate
+{
+
+static bool counting = false;
+static bool available[COUNTER_COUNT];
+static u64 stage_counts[STAGE_COUNT][COUNTER_COUNT];
+
+bool
+perf_counting()
+{
+    return counting;
+}
+
+bool
+perf_available(const Counter counter)
+{
+    return counting && available[(u8)counter];
+}
+
+void
+perf_add(const Stage stage, const u64 before[COUNTER_COUNT], const u64 after[COUNTER_COUNT])
+{
+    // a scaled (multiplexed) count is an estimate that can go back a little
+    u64 *counts = stage_counts[(u8)stage];
+    for (u8 i = 0; i < COUNTER_COUNT; i++)
+        if (after[i] > before[i])
+            __atomic_fetch_add(&counts[i], after[i] - before[i], __ATOMIC_RELAXED);
+}
+
+StageCounters
+stage_counters(const Stage stage)
+{
+    StageCounters counters;
+    for (u8 i = 0; i < COUNTER_COUNT; i++)
+        counters.value[i] = __atomic_load_n(&stage_counts[(u8)stage][i], __ATOMIC_RELAXED);
+    return counters;
+}
+
+#ifdef __linux__
+
+// the counters of one thread, closed when it exits
+struct ThreadCounters
+{
+    int fd[COUNTER_COUNT];
+    bool opened = false;
+
+    ~ThreadCounters()
+    {
+        if (!opened) return;
+        for (u8 i = 0; i < COUNTER_COUNT; i++)
+            if (fd[i] >= 0) close(fd[i]);
+    }
+};
+
+static thread_local ThreadCounters thread_counters;
+
+static int
+open_counter(const Counter counter)
+{
+    static const u32 L1D_READ_MISS = PERF_COUNT_HW_CACHE_L1D |
+                                     (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    static const u32 LLC_READ_MISS = PERF_COUNT_HW_CACHE_LL |
+                                     (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    switch (counter)
+    {
+        case Counter::cycles: attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+        case Counter::instructions: attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+        case Counter::branch_misses: attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+        case Counter::l1d_misses:
+            attr.type   = PERF_TYPE_HW_CACHE;
+            attr.config = L1D_READ_MISS;
+            break;
+        case Counter::llc_misses:
+            attr.type   = PERF_TYPE_HW_CACHE;
+            attr.config = LLC_READ_MISS;
+            break;
+    }
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.inherit        = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    // this thread (and the threads it starts) on any cpu
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void
+open_thread_counters()
+{
+    ThreadCounters *counters = &thread_counters;
+    for (u8 i = 0; i < COUNTER_COUNT; i++)
+        counters->fd[i] = available[i] ? open_counter((Counter)i) : -1;
+    counters->opened = true;
+}
+
+u8
+perf_start()
+{
+    if (counting) return SUCCESS;
+    ThreadCounters *counters = &thread_counters;
+    int error                = 0;
+    bool any                 = false;
+    for (u8 i = 0; i < COUNTER_COUNT; i++)
+    {
+        counters->fd[i] = open_counter((Counter)i);
+        available[i]    = counters->fd[i] >= 0;
+        if (!available[i]) error = errno;
+        any |= available[i];
+    }
+    counters->opened = true;
+    if (!any)
+    {
+        const bool denied = error == EACCES || error == EPERM;
+        fprintf(stderr, "[%sWARN%s] : Performance counters unavailable (%s)%s\n", LYELLOW, RESET,
+                strerror(error), denied ? ", see /proc/sys/kernel/perf_event_paranoid" : "");
+        return FAILURE;
+    }
+    counting = true;
+    return SUCCESS;
+}
+
+bool
+perf_read(u64 counts[COUNTER_COUNT])
+{
+    if (!counting) return false;
+    if (!thread_counters.opened) open_thread_counters();
+    for (u8 i = 0; i < COUNTER_COUNT; i++)
+    {
+        // value, time enabled, time running
+        u64 read_out[3] = {0, 0, 0};
+        const int fd    = thread_counters.fd[i];
+        if (fd < 0 || read(fd, read_out, sizeof(read_out)) != sizeof(read_out) || !read_out[2])
+        {
+            counts[i] = 0;
+            continue;
+        }
+        counts[i] = read_out[1] == read_out[2]
+                        ? read_out[0]
+                        : (u64)((f64)read_out[0] * (f64)read_out[1] / (f64)read_out[2]);
+    }
+    return true;
+}
+
+#else
+
+u8
+perf_start()
+{
+    log_warn("Performance counters are only supported on Linux");
+    return FAILURE;
+}
+
+bool
+perf_read(u64[COUNTER_COUNT])
+{
+    return false;
+}
+
+#endif
+
+} // namespace rotate
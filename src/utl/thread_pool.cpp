@@ -0,0 +1,118 @@
+#include "../include/thread_pool.hpp"
+#include "../include/mem_stats.hpp"
+
+#include <unistd.h>
+
+namespace rotate
+{
+
+ThreadPool::ThreadPool(const uint threads) : num_threads(threads < 1 ? 1 : threads)
+{
+    pthread_mutex_init(&lock, nullptr);
+    pthread_cond_init(&has_work, nullptr);
+    pthread_cond_init(&all_done, nullptr);
+    if (num_threads == 1) return;
+
+    q_capacity = 64;
+    queue      = static_cast<Task *>(malloc(sizeof(Task) * q_capacity));
+    ASSERT_NULL(queue, "ThreadPool queue allocation failure");
+
+    this->threads = static_cast<pthread_t *>(malloc(sizeof(pthread_t) * num_threads));
+    ASSERT_NULL(this->threads, "ThreadPool threads allocation failure");
+    for (uint i = 0; i < num_threads; i++)
+        ASSERT(pthread_create(&this->threads[i], nullptr, worker, this) == 0,
+               "ThreadPool failed to start a thread");
+}
+
+ThreadPool::~ThreadPool()
+{
+    if (threads)
+    {
+        pthread_mutex_lock(&lock);
+        stopping = true;
+        pthread_cond_broadcast(&has_work);
+        pthread_mutex_unlock(&lock);
+        for (uint i = 0; i < num_threads; i++)
+            pthread_join(threads[i], nullptr);
+        free(threads);
+    }
+    free(queue);
+    pthread_cond_destroy(&all_done);
+    pthread_cond_destroy(&has_work);
+    pthread_mutex_destroy(&lock);
+}
+
+void *
+ThreadPool::worker(void *ptr)
+{
+    ThreadPool *pool = static_cast<ThreadPool *>(ptr);
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (pool->q_count == 0 && !pool->stopping)
+            pthread_cond_wait(&pool->has_work, &pool->lock);
+        if (pool->q_count == 0 && pool->stopping) break;
+
+        const Task task = pool->queue[pool->q_head];
+        pool->q_head    = (pool->q_head + 1) % pool->q_capacity;
+        pool->q_count--;
+        pool->running++;
+        pthread_mutex_unlock(&pool->lock);
+
+        mem_set_stage(task.stage);
+        task.fn(task.arg);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->running--;
+        if (pool->q_count == 0 && pool->running == 0) pthread_cond_broadcast(&pool->all_done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return nullptr;
+}
+
+void
+ThreadPool::submit(TaskFn fn, void *arg)
+{
+    if (!threads)
+    {
+        fn(arg);
+        return;
+    }
+
+    pthread_mutex_lock(&lock);
+    if (q_count == q_capacity)
+    {
+        // grow and unwrap the ring
+        Task *bigger = static_cast<Task *>(malloc(sizeof(Task) * q_capacity * 2));
+        ASSERT_NULL(bigger, "ThreadPool queue resize");
+        for (uint i = 0; i < q_count; i++)
+            bigger[i] = queue[(q_head + i) % q_capacity];
+        free(queue);
+        queue = bigger;
+        q_head = 0;
+        q_capacity *= 2;
+    }
+    queue[(q_head + q_count) % q_capacity] = Task{fn, arg, mem_stage()};
+    q_count++;
+    pthread_cond_signal(&has_work);
+    pthread_mutex_unlock(&lock);
+}
+
+void
+ThreadPool::wait()
+{
+    if (!threads) return;
+    pthread_mutex_lock(&lock);
+    while (q_count != 0 || running != 0)
+        pthread_cond_wait(&all_done, &lock);
+    pthread_mutex_unlock(&lock);
+}
+
+uint
+hardware_threads() noexcept
+{
+    const long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n < 1 ? 1 : (uint)n;
+}
+
+} // namespace rotate
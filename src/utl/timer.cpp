@@ -0,0 +1,152 @@
+#include "../include/timer.hpp"
+#include "../include/arena.hpp"
+
+#include <pthread.h>
+
+namespace rotate
+{
+
+struct TraceEvent
+{
+    cstr name, category, detail;
+    u64 start, end;
+    uint tid;
+};
+
+static u64 stage_ns[STAGE_COUNT];
+static uint stage_runs[STAGE_COUNT];
+
+// the trace, allocated by `trace_start` and released by `trace_write`
+static bool trace_on                  = false;
+static u64 trace_origin               = 0;
+static pthread_mutex_t trace_lock     = PTHREAD_MUTEX_INITIALIZER;
+static Array<TraceEvent> *trace_queue = nullptr;
+static Arena *trace_strings           = nullptr;
+static uint last_tid                  = 0;
+static thread_local uint thread_tid   = 0; // 0 until the thread records an event
+
+StageTime
+stage_time(const Stage stage)
+{
+    return StageTime{__atomic_load_n(&stage_ns[(u8)stage], __ATOMIC_RELAXED),
+                     __atomic_load_n(&stage_runs[(u8)stage], __ATOMIC_RELAXED)};
+}
+
+void
+StageTimer::enter(const Stage next)
+{
+    u64 now_counts[COUNTER_COUNT];
+    const bool counted = perf_read(now_counts);
+    const u64 now      = time_ns();
+    if (current != Stage::unknown)
+    {
+        __atomic_fetch_add(&stage_ns[(u8)current], now - start, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stage_runs[(u8)current], 1, __ATOMIC_RELAXED);
+        if (counted) perf_add(current, counts, now_counts);
+        trace_event(stage_describe(current), "stage", file, start, now);
+    }
+    if (counted) memcpy(counts, now_counts, sizeof(counts));
+    current = next;
+    start   = now;
+}
+
+void
+trace_start()
+{
+    pthread_mutex_lock(&trace_lock);
+    if (!trace_queue)
+    {
+        trace_queue   = new Array<TraceEvent>(1024);
+        trace_strings = new Arena();
+        trace_origin  = time_ns();
+        thread_tid    = ++last_tid; // the main thread is the first row
+    }
+    pthread_mutex_unlock(&trace_lock);
+    __atomic_store_n(&trace_on, true, __ATOMIC_RELEASE);
+}
+
+bool
+tracing()
+{
+    return __atomic_load_n(&trace_on, __ATOMIC_ACQUIRE);
+}
+
+void
+trace_event(cstr name, cstr category, cstr detail, const u64 start, const u64 end)
+{
+    if (!tracing()) return;
+    pthread_mutex_lock(&trace_lock);
+    if (trace_queue)
+    {
+        if (!thread_tid) thread_tid = ++last_tid;
+        cstr copy = detail ? trace_strings->strndup(detail, strlen(detail)) : nullptr;
+        trace_queue->append(TraceEvent{name, category, copy, start, end, thread_tid});
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
+
+static void
+write_json_string(FILE *out, cstr str)
+{
+    fputc('"', out);
+    for (; *str; str++)
+    {
+        const u8 c = (u8)*str;
+        if (c == '"' || c == '\\') { fprintf(out, "\\%c", c); }
+        else if (c < 0x20) { fprintf(out, "\\u%04x", c); }
+        else { fputc(c, out); }
+    }
+    fputc('"', out);
+}
+
+// timestamps are microseconds from `trace_start`
+static f64
+trace_us(const u64 ns)
+{
+    return (f64)(ns - trace_origin) / 1000.0;
+}
+
+u8
+trace_write(cstr path)
+{
+    __atomic_store_n(&trace_on, false, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&trace_lock);
+    FILE *out = trace_queue ? fopen(path, "wb") : nullptr;
+    if (out)
+    {
+        fprintf(out, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [" NEWLINE);
+        for (uint tid = 1; tid <= last_tid; tid++)
+        {
+            fprintf(out,
+                    "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, "
+                    "\"args\": {\"name\": \"%s %u\"}}," NEWLINE,
+                    tid, tid == 1 ? "main" : "thread", tid);
+        }
+        for (usize i = 0; i < trace_queue->count(); i++)
+        {
+            const TraceEvent &e = (*trace_queue)[i];
+            fprintf(out,
+                    "%s{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, "
+                    "\"ts\": %.3f, \"dur\": %.3f",
+                    i ? "," NEWLINE : "", e.name, e.category, e.tid, trace_us(e.start),
+                    (f64)(e.end - e.start) / 1000.0);
+            if (e.detail)
+            {
+                fprintf(out, ", \"args\": {\"file\": ");
+                write_json_string(out, e.detail);
+                fputc('}', out);
+            }
+            fputc('}', out);
+        }
+        fprintf(out, NEWLINE "]}" NEWLINE);
+    }
+    const bool written = out && fclose(out) == 0;
+    delete trace_queue;
+    delete trace_strings;
+    trace_queue   = nullptr;
+    trace_strings = nullptr;
+    pthread_mutex_unlock(&trace_lock);
+    return written ? SUCCESS : FAILURE;
+}
+
+} // namespace rotate